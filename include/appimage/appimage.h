@@ -6,6 +6,7 @@ extern "C" {
 
 #include <unistd.h>
 #include <stdbool.h>
+#include <time.h>
 
 // Configuration header
 #include <appimage/config.h>
@@ -31,6 +32,35 @@ off_t appimage_get_payload_offset(char const* path);
 /* Check if a file is an AppImage. Returns the image type if it is, or -1 if it isn't */
 int appimage_get_type(const char* path, bool verbose);
 
+/* Format and stats of a file inspected by `appimage_scan_directory` or `appimage_scan_files`. <type> follows the
+ * `appimage_get_type` convention, <payload_offset> is -1 if the file is not an AppImage. */
+struct appimage_scan_result {
+    const char* path;
+    int type;
+    off_t size;
+    struct timespec mtime;
+    off_t payload_offset;
+};
+
+/* Receives the scan results. <result> is only valid during the call. Calls are never concurrent. */
+typedef void (*appimage_scan_callback)(const struct appimage_scan_result* result, void* user_data);
+
+/* Detect the format of the regular files contained in <dir_path> using <threads> worker threads, 0 means one per
+ * available core. Results are reported through <callback> as soon as they are ready, in no particular order.
+ *
+ * Returns false if the directory can't be read.
+ * */
+bool appimage_scan_directory(const char* dir_path, unsigned int threads, appimage_scan_callback callback,
+                             void* user_data);
+
+/* Detect the format of the files at <paths>, a NULL terminated list, using <threads> worker threads. A result is
+ * reported through <callback> for every path, files that can't be read are reported as invalid.
+ *
+ * Returns false on errors.
+ * */
+bool appimage_scan_files(const char* const* paths, unsigned int threads, appimage_scan_callback callback,
+                         void* user_data);
+
 /*
  * Finds the desktop file of a registered AppImage and returns the path
  * Returns NULL if the desktop file can't be found, which should only occur when the AppImage hasn't been registered yet
@@ -45,6 +75,14 @@ void appimage_extract_file_following_symlinks(const char* appimage_file_path, co
  * */
 bool appimage_read_file_into_buffer_following_symlinks(const char* appimage_file_path, const char* file_path, char** buffer, unsigned long* buf_size);
 
+/* Extract the whole AppImage payload into <target_dir>, which is created if it doesn't exist.
+ * Type 2 AppImages regular files are extracted in parallel using up to <threads> workers, 0 means one per
+ * available core.
+ *
+ * Returns true on success, false otherwise.
+ * */
+bool appimage_extract_all(const char* appimage_file_path, const char* target_dir, unsigned int threads);
+
 
 /* List files contained in the AppImage file.
  * Returns: a newly allocated char** ended at NULL. If no files ware found also is returned a {NULL}
@@ -56,6 +94,34 @@ char** appimage_list_files(const char* path);
 /* Releases memory of a string list (a.k.a. list of pointers to char arrays allocated in heap memory). */
 void appimage_string_list_free(char** list);
 
+/* AppImage metadata gathered in a single pass by `appimage_get_info`. Strings and string lists are NULL when the
+ * information is not available. String lists are ended at NULL. */
+struct appimage_info {
+    int type;
+    off_t payload_offset;
+    char* compression;
+    unsigned int block_size;
+    char* desktop_entry_path;
+    char* desktop_entry;
+    char** icon_paths;
+    char** mime_type_packages_paths;
+    char* appstream_metainfo_path;
+    char* appstream_metainfo;
+    bool has_update_information_section;
+    bool has_signature_section;
+};
+
+/* Gather the most commonly required metadata of the AppImage at <path> with a single payload traversal: format,
+ * payload offset, compression, block size, desktop entry, icons, mime type packages, AppStream metainfo and the
+ * presence of the update information and signature sections.
+ *
+ * Returns NULL on errors. You should ALWAYS take care of releasing the result using `appimage_info_free`.
+ * */
+struct appimage_info* appimage_get_info(const char* path);
+
+/* Releases the memory of an `appimage_info` struct. */
+void appimage_info_free(struct appimage_info* info);
+
 /*
  * Checks whether an AppImage's desktop file has set Terminal=true.
  *
@@ -63,6 +129,52 @@ void appimage_string_list_free(char** list);
  */
 int appimage_is_terminal_app(const char* path);
 
+/*
+ * Opaque handle to an opened AppImage. It keeps the format, the ELF headers, the payload file system context and the
+ * payload entries index alive between calls, so consecutive queries on the same AppImage don't repeat that work.
+ *
+ * A handle must not be used from several threads at the same time.
+ */
+struct appimage_handle;
+
+/* Open the AppImage at <path>. Returns NULL on errors. The handle must be released using `appimage_close`. */
+struct appimage_handle* appimage_open(const char* path);
+
+/* Release a handle returned by `appimage_open`. */
+void appimage_close(struct appimage_handle* handle);
+
+/* Handle based variant of `appimage_get_type`. */
+int appimage_handle_get_type(struct appimage_handle* handle);
+
+/* Handle based variant of `appimage_get_payload_offset`. */
+off_t appimage_handle_get_payload_offset(struct appimage_handle* handle);
+
+/* Handle based variant of `appimage_list_files`. */
+char** appimage_handle_list_files(struct appimage_handle* handle);
+
+/* Handle based variant of `appimage_read_file_into_buffer_following_symlinks`. */
+bool appimage_handle_read_file_into_buffer_following_symlinks(struct appimage_handle* handle, const char* file_path,
+                                                              char** buffer, unsigned long* buf_size);
+
+/* Handle based variant of `appimage_extract_file_following_symlinks`. */
+void appimage_handle_extract_file_following_symlinks(struct appimage_handle* handle, const char* file_path,
+                                                     const char* target_file_path);
+
+/* Handle based variant of `appimage_extract_all`. */
+bool appimage_handle_extract_all(struct appimage_handle* handle, const char* target_dir, unsigned int threads);
+
+/* Handle based variant of `appimage_get_info`. */
+struct appimage_info* appimage_handle_get_info(struct appimage_handle* handle);
+
+/* Handle based variant of `appimage_is_terminal_app`. */
+int appimage_handle_is_terminal_app(struct appimage_handle* handle);
+
+/* Handle based variant of `appimage_get_md5`. The md5 is computed once per handle. */
+char* appimage_handle_get_md5(struct appimage_handle* handle);
+
+/* Handle based variant of `appimage_registered_desktop_file_path`, using the md5 kept by the handle. */
+char* appimage_handle_registered_desktop_file_path(struct appimage_handle* handle, bool verbose);
+
 #ifdef LIBAPPIMAGE_DESKTOP_INTEGRATION_ENABLED
 /*
  * Checks whether an AppImage's desktop file has set X-AppImage-Version=false.
@@ -72,20 +184,32 @@ int appimage_is_terminal_app(const char* path);
  */
 int appimage_shall_not_be_integrated(const char* path);
 
+/* Handle based variant of `appimage_shall_not_be_integrated`. */
+int appimage_handle_shall_not_be_integrated(struct appimage_handle* handle);
+
 /*
  * Check whether an AppImage has been registered in the system
  */
 bool appimage_is_registered_in_system(const char* path);
 
+/* Handle based variant of `appimage_is_registered_in_system`. */
+bool appimage_handle_is_registered_in_system(struct appimage_handle* handle);
+
 /*
  * Register an AppImage in the system
  * Returns 0 on success, non-0 otherwise.
  */
 int appimage_register_in_system(const char *path, bool verbose);
 
+/* Handle based variant of `appimage_register_in_system`. */
+int appimage_handle_register_in_system(struct appimage_handle* handle, bool verbose);
+
 /* Unregister an AppImage in the system */
 int appimage_unregister_in_system(const char *path, bool verbose);
 
+/* Handle based variant of `appimage_unregister_in_system`. */
+int appimage_handle_unregister_in_system(struct appimage_handle* handle, bool verbose);
+
 
 #ifdef LIBAPPIMAGE_THUMBNAILER_ENABLED
 /*
@@ -94,6 +218,9 @@ int appimage_unregister_in_system(const char *path, bool verbose);
  * Returns true on success, false otherwise.
  */
 bool appimage_create_thumbnail(const char* appimage_file_path, bool verbose);
+
+/* Handle based variant of `appimage_create_thumbnail`. */
+bool appimage_handle_create_thumbnail(struct appimage_handle* handle, bool verbose);
 #endif // LIBAPPIMAGE_THUMBNAILER_ENABLED
 
 #endif // LIBAPPIMAGE_DESKTOP_INTEGRATION_ENABLED
@@ -12,6 +12,13 @@ extern "C" {
  */
 bool appimage_get_elf_section_offset_and_length(const char* fname, const char* section_name, unsigned long* offset, unsigned long* length);
 
+/*
+ * Return the offsets, and the lengths of the <count> ELF sections named in <section_names>. The file is mapped and its
+ * section headers are walked only once. The values of the sections that are not found are left untouched.
+ */
+bool appimage_get_elf_sections_offset_and_length(const char* fname, const char* const* section_names, size_t count,
+                                                 unsigned long* offsets, unsigned long* lengths);
+
 int appimage_print_hex(const char* fname, unsigned long offset, unsigned long length);
 int appimage_print_binary(const char* fname, unsigned long offset, unsigned long length);
 
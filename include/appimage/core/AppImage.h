@@ -7,10 +7,19 @@
 
 // local
 #include <appimage/core/AppImageFormat.h>
+#include <appimage/core/ExtractOptions.h>
+#include <appimage/core/IoBackend.h>
+#include <appimage/core/PayloadEntry.h>
 #include <appimage/core/PayloadIterator.h>
 #include <appimage/core/exceptions.h>
 
 namespace appimage {
+    namespace utils {
+        // forward declarations, mappings and ELF headers are implementation details
+        class MappedFile;
+        class ElfFile;
+    }
+
     namespace core {
         /**
          * An object of class <appimage> represents an existent AppImage file. Provides readonly methods to
@@ -25,6 +34,14 @@ namespace appimage {
              */
             explicit AppImage(const std::string& path);
 
+            /**
+             * Open the AppImage at <path> reading its contents by means of <ioBackend>.
+             * @param path
+             * @param ioBackend
+             * @throw AppImageError if something goes wrong
+             */
+            AppImage(const std::string& path, IoBackend ioBackend);
+
             /**
              * Creates an AppImage instance from <other> AppImage
              * @param other
@@ -65,6 +82,8 @@ namespace appimage {
             /**
              * Calculate the offset in the AppImage file where is located the payload file system.
              *
+             * The ELF headers are read only once, the result is shared by all the copies of this instance.
+             *
              * @return offset where the payload filesystem is located.
              */
             off_t getPayloadOffset() const;
@@ -76,6 +95,77 @@ namespace appimage {
              */
             PayloadIterator files() const;
 
+            /**
+             * Provides a one way iterator over the entries contained in the <subdir> directory, at any depth.
+             * Entries keep their full paths. On type 2 AppImages the traversal starts at the <subdir> inode,
+             * the rest of the payload is not visited.
+             *
+             * @param subdir directory path inside the payload
+             * @return a files_iterator instance
+             * @throw PayloadIteratorError if <subdir> is not a directory of a type 2 AppImage
+             * @throw AppImageError if something goes wrong
+             */
+            PayloadIterator files(const std::string& subdir) const;
+
+            /**
+             * Provides a one way iterator over the entries selected by <filter>. Entries that can't match are
+             * skipped by the traversal itself, see PayloadFilter for the details.
+             *
+             * @param filter
+             * @return a files_iterator instance
+             * @throw AppImageError if something goes wrong
+             */
+            PayloadIterator files(const PayloadFilter& filter) const;
+
+            /**
+             * Provides random access to the entry at <path> inside the AppImage payload. On type 2 AppImages
+             * the entry is resolved by means of directory lookups, without traversing the whole payload.
+             *
+             * Links are NOT resolved.
+             *
+             * Can be called from several threads, each of them gets entries backed by its own payload reader.
+             * An entry and the streams it returns must only be used on the thread that obtained it, debug builds
+             * assert it. Entries must not be handed over to other threads, reopen them there from their id.
+             *
+             * @param path entry path inside the payload
+             * @return entry at <path>
+             * @throw PayloadIteratorError if there is no entry at <path>
+             */
+            PayloadEntry lookup(const std::string& path) const;
+
+            /**
+             * Reopen an entry using the id obtained from a previous lookup. The threading rules of lookup() apply.
+             *
+             * @param id
+             * @return entry pointed by <id>
+             * @throw PayloadIteratorError if <id> doesn't point to a valid entry
+             */
+            PayloadEntry openEntry(PayloadEntryId id) const;
+
+            /**
+             * List the entries contained directly in the directory at <path>, without descending into its sub
+             * directories. Links are NOT resolved. On type 2 AppImages only the directory listing is read. The
+             * threading rules of lookup() apply.
+             *
+             * @param path directory path inside the payload, the payload root if empty
+             * @return entries of the directory, in the payload order
+             * @throw PayloadIteratorError if there is no directory at <path>
+             */
+            std::vector<PayloadEntry> listDirectory(const std::string& path) const;
+
+            /**
+             * Extract the whole AppImage payload into <targetDir>. The directory is created if it doesn't
+             * exist, files already there are overwritten.
+             *
+             * On type 2 AppImages the regular files are decompressed and written in parallel according to
+             * <options>. Type 1 AppImages are always extracted sequentially.
+             *
+             * @param targetDir
+             * @param options
+             * @throw AppImageError if something goes wrong
+             */
+            void extractAll(const std::string& targetDir, const ExtractOptions& options = ExtractOptions()) const;
+
             /**
              * Compare this to <rhs>
              * @param rhs
@@ -93,6 +183,19 @@ namespace appimage {
         private:
             class Private;
 
+            friend class PayloadIterator;
+            friend class AppImageInfo;
+
+            /**
+             * @return mapping of the AppImage file or nullptr if the MEMORY_MAPPED backend is not used
+             */
+            std::shared_ptr<utils::MappedFile> getMapping() const;
+
+            /**
+             * @return ELF headers and section table of the AppImage runtime, read on the first call
+             */
+            std::shared_ptr<const utils::ElfFile> getElf() const;
+
             std::shared_ptr<Private> d;   // opaque pointer
         };
     }
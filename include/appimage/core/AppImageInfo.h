@@ -0,0 +1,97 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// local
+#include <appimage/core/AppImage.h>
+#include <appimage/core/AppImageFormat.h>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Snapshot of the AppImage metadata most commonly required by integration tools, app stores and
+         * launchers. Everything is gathered on construction with a single payload traversal.
+         */
+        class AppImageInfo {
+        public:
+            /**
+             * Gather the metadata of <appImage>
+             * @param appImage
+             * @throw AppImageError if something goes wrong
+             */
+            explicit AppImageInfo(const AppImage& appImage);
+
+            /**
+             * @return AppImage format
+             */
+            AppImageFormat getFormat() const;
+
+            /**
+             * @return offset where the payload filesystem is located
+             */
+            off_t getPayloadOffset() const;
+
+            /**
+             * @return payload compression codec name ("gzip", "lzma", "lzo", "xz", "lz4" or "zstd"),
+             * an empty string for type 1 AppImages
+             */
+            const std::string& getCompression() const;
+
+            /**
+             * @return payload block size, 0 for type 1 AppImages
+             */
+            uint32_t getBlockSize() const;
+
+            /**
+             * @return path of the main desktop entry inside the payload, an empty string if missing
+             */
+            const std::string& getDesktopEntryPath() const;
+
+            /**
+             * @return contents of the main desktop entry, links are resolved
+             */
+            const std::string& getDesktopEntry() const;
+
+            /**
+             * @return paths of the icons under usr/share/icons matching the desktop entry Icon key, including the
+             * .DirIcon
+             */
+            const std::vector<std::string>& getIconPaths() const;
+
+            /**
+             * @return paths of the mime type packages inside the payload
+             */
+            const std::vector<std::string>& getMimeTypePackagesPaths() const;
+
+            /**
+             * @return path of the AppStream metainfo file, an empty string if missing
+             */
+            const std::string& getAppStreamMetainfoPath() const;
+
+            /**
+             * @return contents of the AppStream metainfo file, links are resolved
+             */
+            const std::string& getAppStreamMetainfo() const;
+
+            /**
+             * @return true if the runtime has the update information section (.upd_info)
+             */
+            bool hasUpdateInformationSection() const;
+
+            /**
+             * @return true if the runtime has the signature section (.sha256_sig)
+             */
+            bool hasSignatureSection() const;
+
+        private:
+            class Private;
+
+            std::shared_ptr<Private> d;   // opaque pointer
+        };
+    }
+}
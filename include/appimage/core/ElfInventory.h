@@ -0,0 +1,75 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// local
+#include <appimage/core/AppImage.h>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Settings of an ElfInventory
+         */
+        struct ElfInventoryOptions {
+            // Number of worker threads, 0 means one per available core
+            unsigned int threads = 0;
+        };
+
+        /**
+         * Dynamic linking data of an ELF file bundled in an AppImage
+         */
+        struct BundledElf {
+            // path inside the payload
+            std::string path;
+
+            // e_machine field of the ELF header, see the EM_* values of elf.h
+            uint16_t machine = 0;
+
+            // ELFCLASS64 file
+            bool is64Bit = false;
+
+            bool littleEndian = false;
+
+            // DT_SONAME entry, empty if missing
+            std::string soname;
+
+            // DT_NEEDED entries, in the dynamic section order
+            std::vector<std::string> needed;
+
+            // contents of the GNU build id note as an hex string, empty if missing
+            std::string buildId;
+        };
+
+        /**
+         * Lists the ELF files bundled in the library directories of AppImages without extracting them.
+         *
+         * Only the ELF header, the program headers, the dynamic segment strings and the notes of each file
+         * are read, by means of PayloadEntry::readRange. On type 2 AppImages that means decompressing a few
+         * blocks of every file instead of the whole file. Files are inspected in parallel by a pool of worker
+         * threads, each of them with its own payload reader.
+         */
+        class ElfInventory {
+        public:
+            explicit ElfInventory(const ElfInventoryOptions& options = ElfInventoryOptions());
+
+            /**
+             * List the ELF files contained in the usr/lib* directories of <appImage> (i.e.: usr/lib,
+             * usr/lib64 or usr/libexec), at any depth. Links are not followed, the files they point to are
+             * listed by their own path. Other files are skipped.
+             * @param appImage
+             * @return files sorted by path, empty if there are no library directories
+             * @throw AppImageError if the payload can't be read
+             */
+            std::vector<BundledElf> list(const AppImage& appImage) const;
+
+        private:
+            class Private;
+
+            std::shared_ptr<Private> d;
+        };
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <ctime>
+#include <sys/types.h>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Metadata of a payload entry, similar to the stat(2) results. Allows to plan the reads and the
+         * extractions without touching the entries contents.
+         */
+        struct EntryStat {
+            // size of the entry contents in bytes, 0 if it's not a REGULAR entry
+            uint64_t size = 0;
+
+            // file type and permissions
+            mode_t mode = 0;
+
+            struct timespec mtime = {};
+
+            uid_t uid = 0;
+
+            gid_t gid = 0;
+
+            // inode number inside the payload file system
+            uint64_t inode = 0;
+
+            uint64_t nlink = 0;
+
+            // number of 512 bytes blocks required to store the entry contents
+            uint64_t blocks = 0;
+        };
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// system
+#include <string>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Order in which the regular files are handed to the extraction workers
+         */
+        enum class ExtractOrder {
+            // Same order in which the files are stored in the payload
+            PAYLOAD,
+
+            // Largest files first, keeps the workers busy until the end when a few files dominate the payload size
+            LARGEST_FIRST,
+        };
+
+        /**
+         * Settings of a payload extraction
+         */
+        struct ExtractOptions {
+            // Number of worker threads, 0 means one per available core
+            unsigned int threads = 0;
+
+            ExtractOrder order = ExtractOrder::LARGEST_FIRST;
+
+            // Hand the small files to a background writer, based on io_uring when the kernel supports it. Keeps
+            // the decompression busy when the open and close calls are slow, i.e.: on NFS or with many tiny files
+            bool asyncWrites = false;
+
+            // Number of decompressed blocks of a large file that may wait to be written while the next ones are
+            // decompressed, 0 decompresses and writes on the same thread
+            unsigned int pipelineDepth = 4;
+
+            // Directory of a content addressed store shared by many extractions, empty to disable it. The regular
+            // files of type 2 payloads are written once into the store, keyed by the md5 sum of their contents,
+            // and the targets are created as links to them. Extracting again an AppImage that was stored before
+            // doesn't decompress the files whose contents are in the store already. Type 1 payloads ignore it
+            std::string contentStorePath;
+
+            // Create the targets as reflinks (copy on write clones) of the stored files instead of hard links, so
+            // they can be modified without altering the store. Files are copied when the file system doesn't
+            // support reflinks
+            bool contentStoreReflinks = false;
+        };
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace appimage {
+    namespace core {
+        /**
+         * Determines how the AppImage file contents are read
+         */
+        enum class IoBackend {
+            // Every component reads the file through its own file descriptor
+            FILE_DESCRIPTOR,
+
+            // The file is mapped once into memory and shared by all the readers. Data and fragment blocks of
+            // type 2 payloads are decompressed straight from the mapping, saving a read system call per block.
+            // The squashfs metadata is still read through a file descriptor.
+            MEMORY_MAPPED,
+        };
+    }
+}
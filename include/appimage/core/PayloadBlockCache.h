@@ -0,0 +1,59 @@
+#pragma once
+
+// system
+#include <cstddef>
+#include <cstdint>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Process-wide cache of decompressed payload blocks.
+         *
+         * Type 2 AppImages payload blocks are kept in memory after being decompressed, so reading the same
+         * file again (from another PayloadIterator, ResourcesExtractor or AppImage instance) doesn't require
+         * decompressing them once more. Blocks are identified by the AppImage file device, inode and
+         * modification time therefore modified files will never be served stale data.
+         *
+         * The least recently used blocks are dropped when the memory budget is exceeded. All the methods are
+         * thread safe.
+         */
+        class PayloadBlockCache {
+        public:
+            /**
+             * Cache usage counters
+             */
+            struct Statistics {
+                uint64_t hits = 0;
+                uint64_t misses = 0;
+                uint64_t evictions = 0;
+
+                // bytes currently held by the cache
+                size_t size = 0;
+
+                // maximum amount of bytes the cache is allowed to hold
+                size_t budget = 0;
+            };
+
+            /**
+             * Set the maximum amount of memory the cache can hold. Setting it to 0 disables the cache.
+             * @param bytes
+             */
+            static void setMemoryBudget(size_t bytes);
+
+            /**
+             * @return maximum amount of memory the cache can hold
+             */
+            static size_t getMemoryBudget();
+
+            /**
+             * @return current cache usage counters
+             */
+            static Statistics getStatistics();
+
+            /**
+             * Drop all the cached blocks and reset the counters
+             */
+            static void clear();
+        };
+    }
+}
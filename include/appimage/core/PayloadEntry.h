@@ -0,0 +1,140 @@
+#pragma once
+
+// system
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// local
+#include <appimage/core/EntryStat.h>
+#include <appimage/core/PayloadEntryType.h>
+
+namespace appimage {
+    namespace core {
+        // Forward declaration, the readers implementations are kept private
+        class PayloadReader;
+
+        /**
+         * Stable identifier of an entry inside the AppImage payload. It can be used to reopen the entry
+         * later on by means of AppImage::openEntry without looking up its path again.
+         *
+         * Ids are only meaningful for the AppImage file they were obtained from.
+         */
+        typedef uint64_t PayloadEntryId;
+
+        /**
+         * A PayloadEntry object provides random access to a single file contained in the AppImage payload.
+         * Instances are obtained by means of AppImage::lookup or AppImage::openEntry.
+         *
+         * Unlike PayloadIterator, the entry contents can be read as many times as required.
+         *
+         * Entries are backed by the payload reader of the thread that obtained them, readers are not thread
+         * safe. An entry, its copies and the streams it returns must only be used on that thread, debug builds
+         * assert it. Other threads must obtain their own entry, i.e.: by means of AppImage::openEntry.
+         */
+        class PayloadEntry {
+        public:
+            /**
+             * @return stable id of the entry
+             */
+            PayloadEntryId id() const;
+
+            /**
+             * @return entry path inside the AppImage payload. Will be empty if the entry was opened
+             * from its id.
+             */
+            const std::string& path() const;
+
+            /**
+             * @return the type of the entry.
+             */
+            PayloadEntryType type() const;
+
+            /**
+             * @return file link path if it's a LINK type entry. Otherwise returns an empty string.
+             */
+            const std::string& linkTarget() const;
+
+            /**
+             * @return size of the entry contents in bytes, 0 if it's not a REGULAR entry
+             */
+            uint64_t size() const;
+
+            /**
+             * @return entry mode as in stat(2) st_mode
+             */
+            mode_t mode() const;
+
+            /**
+             * @return entry metadata, read along with the entry itself
+             */
+            const EntryStat& stat() const;
+
+            /**
+             * Read the entry contents. Links are NOT resolved.
+             *
+             * IMPORTANT: The returned istream becomes invalid after read() is called again or the
+             * entry is destroyed, don't try to "reuse" it.
+             *
+             * The returned istream is seekable, seekg() only decompresses the data block holding the new
+             * position.
+             *
+             * @throw PayloadIteratorError if the entry is not of REGULAR type
+             * @return entry contents stream
+             */
+            std::istream& read();
+
+            /**
+             * Read up to <size> bytes of the entry contents starting at <offset> into <buffer>, as pread(2)
+             * does. Only the data blocks holding the requested range are decompressed, which makes reading
+             * the headers or trailers of big files cheap. Links are NOT resolved.
+             *
+             * The streams returned by read() are not affected.
+             *
+             * @param offset position in the entry contents
+             * @param buffer
+             * @param size
+             * @throw PayloadIteratorError if the entry is not of REGULAR type
+             * @throw IOError if the entry contents can't be read
+             * @return number of bytes read, less than <size> only if the end of the entry is reached
+             */
+            size_t readRange(uint64_t offset, char* buffer, size_t size);
+
+        private:
+            friend class AppImage;
+
+            class Private;
+
+            std::shared_ptr<Private> d;
+
+            /**
+             * Look up the entry at <path> using <reader>
+             * @throw PayloadIteratorError if there is no entry at <path>
+             */
+            PayloadEntry(const std::shared_ptr<PayloadReader>& reader, const std::string& path);
+
+            /**
+             * Open the entry with the given <id> using <reader>
+             * @throw PayloadIteratorError if <id> doesn't point to a valid entry
+             */
+            PayloadEntry(const std::shared_ptr<PayloadReader>& reader, PayloadEntryId id);
+
+            /**
+             * Create an entry from private data already resolved
+             * @param d private data of the entry
+             */
+            explicit PayloadEntry(Private* d);
+
+            /**
+             * List the entries contained directly in the directory at <path> using <reader>
+             * @throw PayloadIteratorError if there is no directory at <path>
+             */
+            static std::vector<PayloadEntry> listDirectory(const std::shared_ptr<PayloadReader>& reader,
+                                                           const std::string& path);
+        };
+    }
+}
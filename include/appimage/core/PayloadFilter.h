@@ -0,0 +1,124 @@
+#pragma once
+
+// system
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// local
+#include <appimage/core/PayloadEntryType.h>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Selects the payload entries reported by a PayloadIterator.
+         *
+         * The criteria are evaluated by the traversal itself, entries that don't match are skipped before their
+         * inodes or link targets are read. On type 2 AppImages the directories that can't contain any match are
+         * not visited at all. An entry is reported if:
+         *
+         * - its depth doesn't exceed the maximum depth, root entries have depth 1,
+         * - it matches any of the glob patterns or prefixes, when there are any,
+         * - the predicate accepts it, when there is one,
+         * - the directory predicate accepts each of its parent directories, when there is one.
+         *
+         * A default constructed filter reports every entry.
+         */
+        class PayloadFilter {
+        public:
+            using Predicate = std::function<bool(std::string_view path, PayloadEntryType type)>;
+
+            using DirectoryPredicate = std::function<bool(std::string_view dirPath)>;
+
+            /**
+             * Report the entries whose path matches <pattern> as in fnmatch(3) with FNM_PATHNAME, therefore
+             * wildcards don't match the "/" separator. Example: "*.desktop" matches only the desktop files
+             * placed at the payload root.
+             * @param pattern
+             * @return this filter
+             */
+            PayloadFilter& addGlob(const std::string& pattern);
+
+            /**
+             * Report the entries whose path starts with <prefix>. Example: "usr/share/mime/packages/".
+             * @param prefix
+             * @return this filter
+             */
+            PayloadFilter& addPrefix(const std::string& prefix);
+
+            /**
+             * Report only the entries placed at most <depth> levels below the payload root, 0 means unlimited.
+             * @param depth
+             * @return this filter
+             */
+            PayloadFilter& setMaxDepth(unsigned int depth);
+
+            /**
+             * Report only the entries accepted by <predicate>. It's called after the other criteria are
+             * satisfied and it can't prevent the directories contents from being visited.
+             * @param predicate
+             * @return this filter
+             */
+            PayloadFilter& setPredicate(Predicate predicate);
+
+            /**
+             * Visit only the contents of the directories accepted by <predicate>.
+             * @param predicate
+             * @return this filter
+             */
+            PayloadFilter& setDirectoryPredicate(DirectoryPredicate predicate);
+
+            /**
+             * @return true if the filter reports every entry, false otherwise
+             */
+            bool isEmpty() const;
+
+            /**
+             * Check the criteria that apply to the entry itself, its parent directories are not considered.
+             * @param path
+             * @param type
+             * @return true if the entry at <path> shall be reported, false otherwise
+             */
+            bool matches(std::string_view path, PayloadEntryType type) const;
+
+            /**
+             * @param dirPath
+             * @return false if no entry below <dirPath> can be reported, true otherwise
+             */
+            bool canDescend(std::string_view dirPath) const;
+
+            /**
+             * Check whether the contents of every parent directory of <path> can be reported. Allows to
+             * apply the filter to traversals that can't skip directories.
+             * @param path
+             * @return true if canDescend() accepts all the parent directories of <path>, false otherwise
+             */
+            bool isReachable(std::string_view path) const;
+
+        private:
+            struct Glob {
+                std::string pattern;
+
+                // pattern split in path components, used to find the directories that may contain matches
+                std::vector<std::string> components;
+            };
+
+            std::vector<Glob> globs;
+            std::vector<std::string> prefixes;
+            unsigned int maxDepth = 0;
+            Predicate predicate;
+            DirectoryPredicate directoryPredicate;
+
+            /**
+             * @return true if <path> matches any glob pattern or prefix or if there are none, false otherwise
+             */
+            bool matchesPatterns(std::string_view path) const;
+
+            /**
+             * @return true if entries below <dirPath> may match any glob pattern or prefix, false otherwise
+             */
+            bool patternsCanDescend(std::string_view dirPath) const;
+        };
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// system
+#include <cstddef>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Process-wide settings of the persistent payload indexes.
+         *
+         * When enabled, the payload entries indexes built to look up the AppImages resources (i.e.: by the desktop
+         * integration or the thumbnailer) are stored under $XDG_CACHE_HOME/libappimage/payload-index. Later
+         * lookups on the same AppImage file load them instead of traversing the payload again. The cache is
+         * disabled by default, the indexes are then kept in memory only.
+         *
+         * There is one index per AppImage file device and inode, modified files replace their index. The least
+         * recently used indexes are removed when the cache holds more than getMaxFiles() of them. All the methods
+         * are thread safe.
+         */
+        class PayloadIndexCache {
+        public:
+            /**
+             * Allow the payload indexes to be stored in and loaded from the cache directory
+             * @param enabled
+             */
+            static void setEnabled(bool enabled);
+
+            /**
+             * @return true if the payload indexes are stored in the cache directory
+             */
+            static bool isEnabled();
+
+            /**
+             * Set the maximum number of indexes kept in the cache directory, 256 by default
+             * @param count
+             */
+            static void setMaxFiles(size_t count);
+
+            /**
+             * @return maximum number of indexes kept in the cache directory
+             */
+            static size_t getMaxFiles();
+
+            /**
+             * Remove every index stored in the cache directory
+             */
+            static void clear();
+        };
+    }
+}
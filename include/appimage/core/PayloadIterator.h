@@ -3,9 +3,14 @@
 // system
 #include <memory>
 #include <iterator>
+#include <string>
+#include <string_view>
 
 // local
+#include <appimage/core/EntryStat.h>
+#include <appimage/core/ExtractOptions.h>
 #include <appimage/core/PayloadEntryType.h>
+#include <appimage/core/PayloadFilter.h>
 
 namespace appimage {
     namespace core {
@@ -30,6 +35,32 @@ namespace appimage {
              */
             explicit PayloadIterator(const AppImage& appImage);
 
+            /**
+             * Create a FilesIterator over the entries contained in the <subdir> directory of <appImage>, at any
+             * depth. Entries keep their full paths, <subdir> itself is not reported.
+             *
+             * On type 2 AppImages the traversal starts at the <subdir> inode so the rest of the payload is never
+             * read. Type 1 payloads start at <subdir> too unless they lack Rock Ridge extensions, those can only
+             * be read sequentially and the other entries are skipped.
+             *
+             * @param appImage
+             * @param subdir directory path relative to the payload root, the root itself if empty
+             * @throw PayloadIteratorError if <subdir> isn't a directory of a type 2 AppImage
+             * @throw AppImageReadError in case of error
+             */
+            PayloadIterator(const AppImage& appImage, const std::string& subdir);
+
+            /**
+             * Create a FilesIterator over the entries of <appImage> selected by <filter>. The filter is
+             * evaluated while traversing, on type 2 AppImages the directories that can't contain any match
+             * are not visited.
+             *
+             * @param appImage
+             * @param filter
+             * @throw AppImageReadError in case of error
+             */
+            PayloadIterator(const AppImage& appImage, const PayloadFilter& filter);
+
             // Creating copies of this object is not allowed
             PayloadIterator(PayloadIterator& other) = delete;
 
@@ -52,11 +83,30 @@ namespace appimage {
              */
             std::string path();
 
+            /**
+             * Non-copying variant of path(). The view becomes invalid after next is called.
+             * @return file path pointed by the iterator
+             */
+            std::string_view pathView();
+
             /**
              * @return file link path if it's a LINK type file. Otherwise returns an empty string.
              */
             std::string linkTarget();
 
+            /**
+             * Non-copying variant of linkTarget(). The view becomes invalid after next is called.
+             * @return file link path if it's a LINK type file. Otherwise returns an empty string.
+             */
+            std::string_view linkTargetView();
+
+            /**
+             * Read the metadata of the current file without touching its contents. Allows to size the buffers
+             * or to sort the work before reading the file.
+             * @return current file metadata, an empty stat if the end of the traversal was reached
+             */
+            EntryStat stat();
+
             /**
              * Extracts the file to the <target> path. Supports raw files, symlinks and directories.
              * Parent target dir is created if not exists.
@@ -67,14 +117,18 @@ namespace appimage {
              *
              *  @throw AppImageError if called on a PayloadEntry of UNKNOWN Type
              * @param target
+             * @param options only the pipeline depth is used, large files are decompressed and written
+             * concurrently
              */
-            void extractTo(const std::string& target);
+            void extractTo(const std::string& target, const ExtractOptions& options = ExtractOptions());
 
             /**
              * Read file content. Symbolic links will be resolved.
              *
              * IMPORTANT:
              * - The returned istream becomes invalid after next is called, don't try to "reuse" it.
+             * - The istream is seekable on type 2 AppImages only, type 1 payloads are read sequentially. Use
+             *  AppImage::lookup and PayloadEntry::readRange to read parts of a file of any AppImage.
              * - Due to implementation restrictions you can call read() or extractTo() a given entry
              *  only once. Additional call will throw a PayloadIteratorError.
              *
@@ -98,7 +152,7 @@ namespace appimage {
             bool operator!=(const PayloadIterator& other) const;
 
             /**
-             * @return file path pointed by the iterator
+             * @return file path pointed by the iterator, see pathView() for a non-copying variant
              */
             std::string operator*();
 
@@ -116,6 +170,9 @@ namespace appimage {
 
             /**
              * Represent the end of the iterator. Will  always point to an invalid iterator.
+             *
+             * The end state is created on the first call and shared by the following ones, so comparing
+             * against end() on every loop iteration doesn't allocate.
              * @return invalid file_iterator
              */
             PayloadIterator end();
@@ -126,10 +183,16 @@ namespace appimage {
             std::shared_ptr<Private> d;
 
             /**
-             * Constructor used to create special representations of an iterator like the end state.
+             * Constructor used to create special representations of an iterator like the begin state.
              * @param private data of the iterator
              */
             explicit PayloadIterator(Private* d);
+
+            /**
+             * Constructor used to share the end state between iterators.
+             * @param private data of the iterator
+             */
+            explicit PayloadIterator(std::shared_ptr<Private> d);
         };
     }
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// local
+#include <appimage/core/AppImageFormat.h>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Settings of a Scanner
+         */
+        struct ScanOptions {
+            // Number of worker threads, 0 means one per available core
+            unsigned int threads = 0;
+
+            // Files smaller than this are reported as INVALID without being opened
+            uint64_t minimumSize = 4096;
+
+            // Report files without any executable bit as INVALID without opening them
+            bool executableOnly = false;
+        };
+
+        /**
+         * Format and stats of a scanned file
+         */
+        struct ScanResult {
+            std::string path;
+
+            AppImageFormat format = AppImageFormat::INVALID;
+
+            uint64_t size = 0;
+
+            struct timespec mtime = {};
+
+            // offset of the payload file system, -1 if the file is not an AppImage
+            off_t payloadOffset = -1;
+        };
+
+        /**
+         * Detects the format of many files at once.
+         *
+         * Files are inspected in parallel by a pool of worker threads. Each of them is first checked using
+         * the statx() results, regular files that pass the size and executable bits filters are then read
+         * with a single small pread(). Only the files that look like ELF executables require a larger read
+         * and only the AppImages have their ELF section headers read to find the payload offset.
+         *
+         * Results are reported through a callback as soon as they are ready, therefore in no particular
+         * order. Callback calls are serialized, they never run concurrently.
+         */
+        class Scanner {
+        public:
+            using Callback = std::function<void(const ScanResult& result)>;
+
+            explicit Scanner(const ScanOptions& options = ScanOptions());
+
+            /**
+             * Scan the regular files (and the symlinks to regular files) contained in <dirPath>. Sub
+             * directories are not visited.
+             * @param dirPath
+             * @param callback
+             * @throw FileSystemError if the directory can't be read
+             * @throw any exception raised by <callback>, the scan is interrupted
+             */
+            void scanDirectory(const std::string& dirPath, const Callback& callback) const;
+
+            /**
+             * Scan the files at <paths>. Exactly one result is reported for each path, paths that can't be
+             * read or that aren't regular files are reported as INVALID.
+             * @param paths
+             * @param callback
+             * @throw any exception raised by <callback>, the scan is interrupted
+             */
+            void scanFiles(const std::vector<std::string>& paths, const Callback& callback) const;
+
+        private:
+            class Private;
+
+            std::shared_ptr<Private> d;
+        };
+    }
+}
@@ -79,6 +79,13 @@ namespace appimage {
              */
             std::vector<std::string> getMimeTypePackagesPaths() const;
 
+            /**
+             * Read from the entries index, the payload is not traversed again.
+             *
+             * @return paths of all the payload entries, sorted
+             */
+            std::vector<std::string> getEntriesPaths() const;
+
         private:
             class Priv;
             std::shared_ptr<Priv> d;
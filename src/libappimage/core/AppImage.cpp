@@ -1,12 +1,21 @@
 // system
 #include <iostream>
 #include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
 
 
 // local
 #include "appimage/core/AppImage.h"
 #include "utils/MagicBytesChecker.h"
 #include "utils/ElfFile.h"
+#include "utils/MappedFile.h"
+#include "core/impl/PayloadReaderType1.h"
+#include "core/impl/PayloadReaderType2.h"
+#include "core/impl/ExtractorType1.h"
+#include "core/impl/ExtractorType2.h"
+#include "core/impl/FormatDetection.h"
 
 namespace appimage {
     namespace core {
@@ -20,13 +29,31 @@ namespace appimage {
             std::string path;
             AppImageFormat format = AppImageFormat::INVALID;
 
-            explicit Private(const std::string& path);
+            // Shared mapping of the whole file, only set when the MEMORY_MAPPED backend is used
+            std::shared_ptr<utils::MappedFile> mapping;
+
+            // Shared by all the entries obtained from this AppImage on the same thread, created on demand. Readers
+            // are not thread safe, each thread gets its own
+            std::map<std::thread::id, std::shared_ptr<PayloadReader>> readers;
+            std::mutex readersMutex;
+
+            // ELF headers and section table, read once on demand
+            std::shared_ptr<utils::ElfFile> elf;
+            std::mutex elfMutex;
+
+            Private(const std::string& path, IoBackend ioBackend);
 
             static AppImageFormat getFormat(const std::string& path);
 
+            std::shared_ptr<PayloadReader> getReader(const AppImage& appImage);
+
+            std::shared_ptr<utils::ElfFile> getElf();
         };
 
-        AppImage::AppImage(const std::string& path) : d(new Private(path)) {
+        AppImage::AppImage(const std::string& path) : d(new Private(path, IoBackend::FILE_DESCRIPTOR)) {
+        }
+
+        AppImage::AppImage(const std::string& path, IoBackend ioBackend) : d(new Private(path, ioBackend)) {
         }
 
         const std::string& AppImage::getPath() const {
@@ -41,8 +68,15 @@ namespace appimage {
             return Private::getFormat(path);
         }
 
-        AppImage::Private::Private(const std::string& path) : path(path) {
-            format = getFormat(path);
+        AppImage::Private::Private(const std::string& path, IoBackend ioBackend) : path(path) {
+            if (ioBackend == IoBackend::MEMORY_MAPPED) {
+                mapping = std::make_shared<utils::MappedFile>(path);
+
+                utils::MagicBytesChecker magicBytesChecker(mapping->data(), mapping->size());
+                format = impl::detectFormat(magicBytesChecker, path);
+            } else {
+                format = getFormat(path);
+            }
 
             if (format == AppImageFormat::INVALID)
                 throw core::AppImageError("Unknown AppImage format: " + path); // FIXME: This should not be an error, and should not be printed unless in debug mode
@@ -51,21 +85,48 @@ namespace appimage {
         AppImageFormat AppImage::Private::getFormat(const std::string& path) {
             utils::MagicBytesChecker magicBytesChecker(path);
 
-            if (!magicBytesChecker.hasElfSignature())
-                return AppImageFormat::INVALID;
+            return impl::detectFormat(magicBytesChecker, path);
+        }
 
-            if (magicBytesChecker.hasAppImageType1Signature())
-                return AppImageFormat::TYPE_1;
+        std::shared_ptr<PayloadReader> AppImage::Private::getReader(const AppImage& appImage) {
+            std::lock_guard<std::mutex> lock(readersMutex);
+
+            auto& reader = readers[std::this_thread::get_id()];
+            if (!reader) {
+                // drop the readers no entry holds anymore, their threads may be gone
+                for (auto itr = readers.begin(); itr != readers.end();) {
+                    if (itr->second && itr->second.use_count() == 1)
+                        itr = readers.erase(itr);
+                    else
+                        ++itr;
+                }
+
+                switch (format) {
+                    case AppImageFormat::TYPE_1:
+                        reader.reset(new impl::PayloadReaderType1(path));
+                        break;
+                    case AppImageFormat::TYPE_2:
+                        reader.reset(new impl::PayloadReaderType2(path, appImage.getPayloadOffset(), mapping));
+                        break;
+                    default:
+                        throw AppImageError("Unsupported AppImage format: " + path);
+                }
+            }
 
-            if (magicBytesChecker.hasAppImageType2Signature())
-                return AppImageFormat::TYPE_2;
+            return reader;
+        }
 
-            if (magicBytesChecker.hasIso9660Signature()) {
-                std::cerr << "WARNING: " << path << " seems to be a Type 1 AppImage without magic bytes." << std::endl;
-                return AppImageFormat::TYPE_1;
+        std::shared_ptr<utils::ElfFile> AppImage::Private::getElf() {
+            std::lock_guard<std::mutex> lock(elfMutex);
+
+            if (!elf) {
+                if (mapping)
+                    elf = std::make_shared<utils::ElfFile>(mapping->data(), mapping->size());
+                else
+                    elf = std::make_shared<utils::ElfFile>(path);
             }
 
-            return AppImageFormat::INVALID;
+            return elf;
         }
 
         AppImage::~AppImage() = default;
@@ -74,10 +135,49 @@ namespace appimage {
             return PayloadIterator(*this);
         }
 
+        PayloadIterator AppImage::files(const std::string& subdir) const {
+            return PayloadIterator(*this, subdir);
+        }
+
+        PayloadIterator AppImage::files(const PayloadFilter& filter) const {
+            return PayloadIterator(*this, filter);
+        }
+
+        PayloadEntry AppImage::lookup(const std::string& path) const {
+            return PayloadEntry(d->getReader(*this), path);
+        }
+
+        PayloadEntry AppImage::openEntry(PayloadEntryId id) const {
+            return PayloadEntry(d->getReader(*this), id);
+        }
+
+        std::vector<PayloadEntry> AppImage::listDirectory(const std::string& path) const {
+            return PayloadEntry::listDirectory(d->getReader(*this), path);
+        }
+
+        void AppImage::extractAll(const std::string& targetDir, const ExtractOptions& options) const {
+            switch (d->format) {
+                case AppImageFormat::TYPE_1:
+                    impl::ExtractorType1(d->path).extractAll(targetDir, options);
+                    break;
+                case AppImageFormat::TYPE_2:
+                    impl::ExtractorType2(d->path, getPayloadOffset(), d->mapping).extractAll(targetDir, options);
+                    break;
+                default:
+                    throw AppImageError("Unsupported AppImage format: " + d->path);
+            }
+        }
+
         off_t AppImage::getPayloadOffset() const {
-            utils::ElfFile elf(d->path);
+            return d->getElf()->getSize();
+        }
+
+        std::shared_ptr<const utils::ElfFile> AppImage::getElf() const {
+            return d->getElf();
+        }
 
-            return elf.getSize();
+        std::shared_ptr<utils::MappedFile> AppImage::getMapping() const {
+            return d->mapping;
         }
 
         bool AppImage::operator==(const AppImage& rhs) const {
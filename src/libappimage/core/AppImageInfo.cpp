@@ -0,0 +1,294 @@
+// system
+#include <iterator>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+
+// libraries
+#include <XdgUtils/DesktopEntry/DesktopEntry.h>
+
+// local
+#include <appimage/core/AppImageInfo.h>
+#include <appimage/core/exceptions.h>
+#include <appimage/core/PayloadFilter.h>
+#include "utils/resources_extractor/ResourcePaths.h"
+#include "utils/ElfFile.h"
+
+namespace appimage {
+    namespace core {
+        namespace {
+            // Links chains longer than this are considered loops
+            constexpr int MAX_LINK_JUMPS = 16;
+
+            // squashfs superblock fields, see squashfs_fs.h
+            constexpr uint32_t SQUASHFS_MAGIC = 0x73717368;
+            constexpr size_t SUPERBLOCK_BLOCK_SIZE_OFFSET = 12;
+            constexpr size_t SUPERBLOCK_COMPRESSION_OFFSET = 20;
+
+            uint32_t readLittleEndian32(const unsigned char* data) {
+                return (uint32_t) data[0] | (uint32_t) data[1] << 8 | (uint32_t) data[2] << 16 |
+                       (uint32_t) data[3] << 24;
+            }
+
+            std::string compressionName(uint16_t id) {
+                switch (id) {
+                    case 1:
+                        return "gzip";
+                    case 2:
+                        return "lzma";
+                    case 3:
+                        return "lzo";
+                    case 4:
+                        return "xz";
+                    case 5:
+                        return "lz4";
+                    case 6:
+                        return "zstd";
+                    default:
+                        return "unknown";
+                }
+            }
+
+            /**
+             * Entries that may hold integration resources: the files at the payload root and the contents of
+             * the well known resource directories. The rest of the payload is not visited.
+             */
+            PayloadFilter resourcesFilter() {
+                PayloadFilter filter;
+                filter.addGlob("*")
+                    .addPrefix("usr/share/icons/")
+                    .addPrefix("usr/share/mime/packages/")
+                    .addPrefix("usr/share/metainfo/")
+                    .addPrefix("usr/share/appdata/")
+                    .setPredicate([](std::string_view, PayloadEntryType type) {
+                        return type != PayloadEntryType::DIR;
+                    });
+
+                return filter;
+            }
+
+            /**
+             * Map a link target to a payload path, following the PayloadEntriesCache convention
+             */
+            std::string linkTargetToPath(const std::string& target) {
+                std::string::size_type begin = 0;
+                while (begin < target.size() && (target[begin] == '/' || target.compare(begin, 2, "./") == 0))
+                    begin += target[begin] == '/' ? 1 : 2;
+
+                return target.substr(begin);
+            }
+
+            /**
+             * A payload file whose contents are required. If the file is a link its target is read instead,
+             * either when the traversal reaches it or at the end by means of a lookup.
+             */
+            struct ResourceSlot {
+                std::string path;
+                std::string targetPath;
+                std::string contents;
+                bool loaded = false;
+
+                bool isSet() const {
+                    return !path.empty();
+                }
+
+                /**
+                 * Claim the slot for the current entry of <itr> if it's still free
+                 */
+                void claim(PayloadIterator& itr) {
+                    if (isSet())
+                        return;
+
+                    path = itr.path();
+                    if (itr.type() == PayloadEntryType::LINK) {
+                        targetPath = linkTargetToPath(itr.linkTarget());
+                    } else {
+                        targetPath = path;
+                        load(itr);
+                    }
+                }
+
+                /**
+                 * Read the current entry of <itr> if it's the one the slot is waiting for
+                 */
+                void offer(PayloadIterator& itr) {
+                    if (isSet() && !loaded && itr.type() == PayloadEntryType::REGULAR && itr.path() == targetPath)
+                        load(itr);
+                }
+
+                /**
+                 * Resolve the pending links by means of random access lookups
+                 */
+                void finish(const AppImage& appImage) {
+                    if (!isSet() || loaded)
+                        return;
+
+                    auto entryPath = targetPath;
+                    for (int i = 0; i < MAX_LINK_JUMPS; ++i) {
+                        auto entry = appImage.lookup(entryPath);
+                        if (entry.type() != PayloadEntryType::LINK) {
+                            contents.assign(std::istreambuf_iterator<char>(entry.read()),
+                                            std::istreambuf_iterator<char>());
+                            loaded = true;
+                            return;
+                        }
+
+                        entryPath = linkTargetToPath(entry.linkTarget());
+                    }
+
+                    throw PayloadIteratorError("Loop found: " + path);
+                }
+
+            private:
+                void load(PayloadIterator& itr) {
+                    contents.assign(std::istreambuf_iterator<char>(itr.read()), std::istreambuf_iterator<char>());
+                    loaded = true;
+                }
+            };
+        }
+
+        /**
+         * Implementation of the opaque pointer patter for the AppImageInfo class
+         */
+        class AppImageInfo::Private {
+        public:
+            AppImageFormat format = AppImageFormat::INVALID;
+            off_t payloadOffset = 0;
+            std::string compression;
+            uint32_t blockSize = 0;
+            std::vector<std::string> iconPaths;
+            std::vector<std::string> mimeTypePackagesPaths;
+            ResourceSlot desktopEntry;
+            ResourceSlot appStreamMetainfo;
+            bool updateInformationSection = false;
+            bool signatureSection = false;
+
+            explicit Private(const AppImage& appImage) : format(appImage.getFormat()),
+                                                         payloadOffset(appImage.getPayloadOffset()) {
+                if (format == AppImageFormat::TYPE_2)
+                    readSuperblock(appImage.getPath());
+
+                readSections(*appImage.getElf());
+                readPayload(appImage);
+            }
+
+        private:
+            void readSuperblock(const std::string& path) {
+                unsigned char superblock[SUPERBLOCK_COMPRESSION_OFFSET + 2];
+
+                int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd == -1)
+                    throw FileSystemError("Unable to open file: " + path);
+
+                auto bytesRead = pread(fd, superblock, sizeof(superblock), payloadOffset);
+                close(fd);
+
+                if (bytesRead != (ssize_t) sizeof(superblock) || readLittleEndian32(superblock) != SQUASHFS_MAGIC)
+                    throw IOError("Invalid squashfs superblock: " + path);
+
+                blockSize = readLittleEndian32(superblock + SUPERBLOCK_BLOCK_SIZE_OFFSET);
+                compression = compressionName((uint16_t) (superblock[SUPERBLOCK_COMPRESSION_OFFSET] |
+                                                          superblock[SUPERBLOCK_COMPRESSION_OFFSET + 1] << 8));
+            }
+
+            void readSections(const utils::ElfFile& elf) {
+                utils::ElfFile::Section section;
+                updateInformationSection = elf.findSection(".upd_info", section);
+                signatureSection = elf.findSection(".sha256_sig", section);
+            }
+
+            void readPayload(const AppImage& appImage) {
+                std::vector<std::string> iconCandidates;
+
+                for (auto itr = appImage.files(resourcesFilter()); itr != itr.end(); ++itr) {
+                    const auto& path = itr.path();
+                    if (utils::resource_paths::isMainDesktopFile(path))
+                        desktopEntry.claim(itr);
+                    else if (utils::resource_paths::isAppStreamMetainfoFile(path))
+                        appStreamMetainfo.claim(itr);
+                    else if (utils::resource_paths::isMimeFile(path))
+                        mimeTypePackagesPaths.emplace_back(path);
+                    else if (utils::resource_paths::isIconFile(path) || path == ".DirIcon")
+                        iconCandidates.emplace_back(path);
+
+                    desktopEntry.offer(itr);
+                    appStreamMetainfo.offer(itr);
+                }
+
+                desktopEntry.finish(appImage);
+                appStreamMetainfo.finish(appImage);
+
+                filterIcons(iconCandidates);
+            }
+
+            /**
+             * Keep only the icons matching the desktop entry Icon key, all of them if the key is missing
+             */
+            void filterIcons(const std::vector<std::string>& iconCandidates) {
+                std::string iconName;
+                if (desktopEntry.loaded) {
+                    try {
+                        XdgUtils::DesktopEntry::DesktopEntry entry(desktopEntry.contents);
+                        iconName = entry.get("Desktop Entry/Icon");
+                    } catch (const std::runtime_error&) {
+                        // malformed desktop entries are reported as they are, icons are not filtered
+                    }
+                }
+
+                for (const auto& path : iconCandidates)
+                    if (iconName.empty() || path == ".DirIcon" || path.find(iconName) != std::string::npos)
+                        iconPaths.emplace_back(path);
+            }
+        };
+
+        AppImageInfo::AppImageInfo(const AppImage& appImage) : d(new Private(appImage)) {}
+
+        AppImageFormat AppImageInfo::getFormat() const {
+            return d->format;
+        }
+
+        off_t AppImageInfo::getPayloadOffset() const {
+            return d->payloadOffset;
+        }
+
+        const std::string& AppImageInfo::getCompression() const {
+            return d->compression;
+        }
+
+        uint32_t AppImageInfo::getBlockSize() const {
+            return d->blockSize;
+        }
+
+        const std::string& AppImageInfo::getDesktopEntryPath() const {
+            return d->desktopEntry.path;
+        }
+
+        const std::string& AppImageInfo::getDesktopEntry() const {
+            return d->desktopEntry.contents;
+        }
+
+        const std::vector<std::string>& AppImageInfo::getIconPaths() const {
+            return d->iconPaths;
+        }
+
+        const std::vector<std::string>& AppImageInfo::getMimeTypePackagesPaths() const {
+            return d->mimeTypePackagesPaths;
+        }
+
+        const std::string& AppImageInfo::getAppStreamMetainfoPath() const {
+            return d->appStreamMetainfo.path;
+        }
+
+        const std::string& AppImageInfo::getAppStreamMetainfo() const {
+            return d->appStreamMetainfo.contents;
+        }
+
+        bool AppImageInfo::hasUpdateInformationSection() const {
+            return d->updateInformationSection;
+        }
+
+        bool AppImageInfo::hasSignatureSection() const {
+            return d->signatureSection;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+// system
+#include <algorithm>
+
+// local
+#include <appimage/core/ElfInventory.h>
+#include <appimage/core/exceptions.h>
+#include "utils/ElfFile.h"
+#include "utils/WorkerPool.h"
+
+namespace appimage {
+    namespace core {
+        namespace {
+            // Prefix of the names of the library directories inside usr
+            constexpr char LIBRARY_DIRS_PREFIX[] = "lib";
+
+            struct ElfJob {
+                PayloadEntryId id;
+                std::string path;
+            };
+
+            bool isLibraryDir(const PayloadEntry& entry) {
+                if (entry.type() != PayloadEntryType::DIR)
+                    return false;
+
+                const auto name = entry.path().substr(entry.path().rfind('/') + 1);
+                return name.compare(0, sizeof(LIBRARY_DIRS_PREFIX) - 1, LIBRARY_DIRS_PREFIX) == 0;
+            }
+
+            /**
+             * Collect the regular files contained in the directory at <path>, at any depth
+             */
+            void collectFiles(const AppImage& appImage, const std::string& path, std::vector<ElfJob>& jobs) {
+                std::vector<std::string> pendingDirs = {path};
+                while (!pendingDirs.empty()) {
+                    const auto dirPath = pendingDirs.back();
+                    pendingDirs.pop_back();
+
+                    for (const auto& entry : appImage.listDirectory(dirPath)) {
+                        if (entry.type() == PayloadEntryType::DIR)
+                            pendingDirs.emplace_back(entry.path());
+                        else if (entry.type() == PayloadEntryType::REGULAR && entry.size() >= EI_NIDENT)
+                            jobs.push_back({entry.id(), entry.path()});
+                    }
+                }
+            }
+        }
+
+        class ElfInventory::Private {
+        public:
+            ElfInventoryOptions options;
+
+            explicit Private(const ElfInventoryOptions& options) : options(options) {}
+        };
+
+        ElfInventory::ElfInventory(const ElfInventoryOptions& options) : d(new Private(options)) {}
+
+        std::vector<BundledElf> ElfInventory::list(const AppImage& appImage) const {
+            std::vector<PayloadEntry> usrEntries;
+            try {
+                usrEntries = appImage.listDirectory("usr");
+            } catch (const PayloadIteratorError&) {
+                return {};
+            }
+
+            std::vector<ElfJob> jobs;
+            for (const auto& entry : usrEntries) {
+                if (isLibraryDir(entry))
+                    collectFiles(appImage, entry.path(), jobs);
+            }
+
+            std::vector<BundledElf> files(jobs.size());
+            std::vector<char> isElf(jobs.size(), false);
+
+            // readers are not thread safe, worker 0 is the calling thread and it can use the given instance
+            utils::WorkerPool pool(d->options.threads);
+            std::vector<std::unique_ptr<AppImage>> workerAppImages(pool.size());
+
+            pool.run(jobs.size(), [&](unsigned int worker, size_t jobId) {
+                const AppImage* workerAppImage = &appImage;
+                if (worker != 0) {
+                    if (!workerAppImages[worker])
+                        workerAppImages[worker].reset(new AppImage(appImage.getPath()));
+
+                    workerAppImage = workerAppImages[worker].get();
+                }
+
+                auto entry = workerAppImage->openEntry(jobs[jobId].id);
+
+                utils::ElfFile::DynamicInfo info;
+                isElf[jobId] = utils::ElfFile::readDynamicInfo([&entry](uint64_t offset, char* buffer, size_t size) {
+                    return entry.readRange(offset, buffer, size);
+                }, info);
+
+                if (!isElf[jobId])
+                    return;
+
+                auto& file = files[jobId];
+                file.path = jobs[jobId].path;
+                file.machine = info.machine;
+                file.is64Bit = info.elfClass == ELFCLASS64;
+                file.littleEndian = info.littleEndian;
+                file.soname = std::move(info.soname);
+                file.needed = std::move(info.needed);
+                file.buildId = std::move(info.buildId);
+            });
+
+            std::vector<BundledElf> result;
+            for (size_t i = 0; i < files.size(); ++i) {
+                if (isElf[i])
+                    result.emplace_back(std::move(files[i]));
+            }
+
+            std::sort(result.begin(), result.end(),
+                      [](const BundledElf& a, const BundledElf& b) { return a.path < b.path; });
+
+            return result;
+        }
+    }
+}
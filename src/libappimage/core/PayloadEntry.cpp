@@ -0,0 +1,126 @@
+// system
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+// local
+#include <appimage/core/PayloadEntry.h>
+#include <appimage/core/exceptions.h>
+#include "core/PayloadReader.h"
+#include "core/impl/PayloadIStream.h"
+
+namespace appimage {
+    namespace core {
+        /**
+         * @brief Representation of the private state of the entry.
+         *
+         * Holds a reference to the PayloadReader that created the entry in order to keep it alive while
+         * the entry is used. The reader belongs to the thread that obtained the entry, see AppImage::lookup.
+         */
+        class PayloadEntry::Private {
+        public:
+            std::shared_ptr<PayloadReader> reader;
+            PayloadReader::Entry entry;
+
+#ifndef NDEBUG
+            // readers are not thread safe, only the thread that obtained the entry may use it
+            std::thread::id ownerThread = std::this_thread::get_id();
+#endif
+
+            impl::PayloadIStream entryIStream;
+            std::unique_ptr<std::streambuf> entryStreambuf;
+
+            // kept between readRange calls, separated from the one used by read()
+            std::unique_ptr<std::streambuf> rangeStreambuf;
+
+            explicit Private(std::shared_ptr<PayloadReader> reader) : reader(std::move(reader)) {}
+
+            std::istream& read() {
+                assert(ownerThread == std::this_thread::get_id() && "PayloadEntry used from another thread");
+
+                // create a new streambuf for reading the entry
+                auto tmpBuffer = reader->read(entry);
+
+                // replace buffer in the istream
+                entryIStream.rdbuf(tmpBuffer.get());
+                entryIStream.clear();
+
+                // replace and drop the old buffer
+                entryStreambuf = std::move(tmpBuffer);
+
+                return entryIStream;
+            }
+
+            size_t readRange(uint64_t offset, char* buffer, size_t size) {
+                assert(ownerThread == std::this_thread::get_id() && "PayloadEntry used from another thread");
+
+                if (entry.type != PayloadEntryType::REGULAR)
+                    throw PayloadIteratorError("Not a regular file: " + entry.path);
+
+                if (offset >= entry.stat.size)
+                    return 0;
+
+                size = (size_t) std::min<uint64_t>(size, entry.stat.size - offset);
+
+                if (!rangeStreambuf)
+                    rangeStreambuf = reader->read(entry);
+
+                const auto position = rangeStreambuf->pubseekpos((std::streamoff) offset, std::ios_base::in);
+                if (position == std::streampos(std::streamoff(-1)))
+                    throw IOError("Unable to seek in " + entry.path);
+
+                return (size_t) rangeStreambuf->sgetn(buffer, (std::streamsize) size);
+            }
+        };
+
+        PayloadEntry::PayloadEntry(const std::shared_ptr<PayloadReader>& reader, const std::string& path)
+            : d(new Private(reader)) {
+            if (!reader->lookup(path, d->entry))
+                throw PayloadIteratorError("Entry doesn't exists: " + path);
+        }
+
+        PayloadEntry::PayloadEntry(const std::shared_ptr<PayloadReader>& reader, PayloadEntryId id)
+            : d(new Private(reader)) {
+            d->entry = reader->open(id);
+        }
+
+        PayloadEntry::PayloadEntry(PayloadEntry::Private* d) : d(d) {}
+
+        std::vector<PayloadEntry> PayloadEntry::listDirectory(const std::shared_ptr<PayloadReader>& reader,
+                                                              const std::string& path) {
+            std::vector<PayloadReader::Entry> entries;
+            if (!reader->list(path, entries))
+                throw PayloadIteratorError("Directory doesn't exists: " + path);
+
+            std::vector<PayloadEntry> result;
+            result.reserve(entries.size());
+            for (auto& entry : entries) {
+                auto priv = new Private(reader);
+                priv->entry = std::move(entry);
+                result.emplace_back(PayloadEntry(priv));
+            }
+
+            return result;
+        }
+
+        PayloadEntryId PayloadEntry::id() const { return d->entry.id; }
+
+        const std::string& PayloadEntry::path() const { return d->entry.path; }
+
+        PayloadEntryType PayloadEntry::type() const { return d->entry.type; }
+
+        const std::string& PayloadEntry::linkTarget() const { return d->entry.linkTarget; }
+
+        uint64_t PayloadEntry::size() const { return d->entry.stat.size; }
+
+        mode_t PayloadEntry::mode() const { return d->entry.stat.mode; }
+
+        const EntryStat& PayloadEntry::stat() const { return d->entry.stat; }
+
+        std::istream& PayloadEntry::read() { return d->read(); }
+
+        size_t PayloadEntry::readRange(uint64_t offset, char* buffer, size_t size) {
+            return d->readRange(offset, buffer, size);
+        }
+    }
+}
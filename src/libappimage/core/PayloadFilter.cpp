@@ -0,0 +1,156 @@
+// system
+#include <algorithm>
+#include <fnmatch.h>
+
+// local
+#include <appimage/core/PayloadFilter.h>
+
+namespace appimage {
+    namespace core {
+        namespace {
+            /**
+             * @return number of components of <path>, 0 for the payload root
+             */
+            unsigned int pathDepth(std::string_view path) {
+                if (path.empty())
+                    return 0;
+
+                return (unsigned int) std::count(path.begin(), path.end(), '/') + 1;
+            }
+
+            bool startsWith(std::string_view str, std::string_view prefix) {
+                return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
+            }
+        }
+
+        PayloadFilter& PayloadFilter::addGlob(const std::string& pattern) {
+            Glob glob;
+            glob.pattern = pattern;
+
+            std::string::size_type begin = 0;
+            while (begin <= pattern.size()) {
+                auto end = pattern.find('/', begin);
+                if (end == std::string::npos)
+                    end = pattern.size();
+
+                glob.components.emplace_back(pattern.substr(begin, end - begin));
+                begin = end + 1;
+            }
+
+            globs.emplace_back(std::move(glob));
+            return *this;
+        }
+
+        PayloadFilter& PayloadFilter::addPrefix(const std::string& prefix) {
+            prefixes.emplace_back(prefix);
+            return *this;
+        }
+
+        PayloadFilter& PayloadFilter::setMaxDepth(unsigned int depth) {
+            maxDepth = depth;
+            return *this;
+        }
+
+        PayloadFilter& PayloadFilter::setPredicate(PayloadFilter::Predicate predicate) {
+            this->predicate = std::move(predicate);
+            return *this;
+        }
+
+        PayloadFilter& PayloadFilter::setDirectoryPredicate(PayloadFilter::DirectoryPredicate predicate) {
+            directoryPredicate = std::move(predicate);
+            return *this;
+        }
+
+        bool PayloadFilter::isEmpty() const {
+            return globs.empty() && prefixes.empty() && maxDepth == 0 && !predicate && !directoryPredicate;
+        }
+
+        bool PayloadFilter::matches(std::string_view path, PayloadEntryType type) const {
+            if (maxDepth != 0 && pathDepth(path) > maxDepth)
+                return false;
+
+            if (!matchesPatterns(path))
+                return false;
+
+            return !predicate || predicate(path, type);
+        }
+
+        bool PayloadFilter::canDescend(std::string_view dirPath) const {
+            // the payload root is always visited
+            if (dirPath.empty())
+                return true;
+
+            if (maxDepth != 0 && pathDepth(dirPath) >= maxDepth)
+                return false;
+
+            if (!patternsCanDescend(dirPath))
+                return false;
+
+            return !directoryPredicate || directoryPredicate(dirPath);
+        }
+
+        bool PayloadFilter::isReachable(std::string_view path) const {
+            for (auto end = path.find('/'); end != std::string_view::npos; end = path.find('/', end + 1))
+                if (!canDescend(path.substr(0, end)))
+                    return false;
+
+            return true;
+        }
+
+        bool PayloadFilter::matchesPatterns(std::string_view path) const {
+            if (globs.empty() && prefixes.empty())
+                return true;
+
+            for (const auto& prefix : prefixes)
+                if (startsWith(path, prefix))
+                    return true;
+
+            if (globs.empty())
+                return false;
+
+            // fnmatch requires a NUL terminated string
+            const std::string pathStr(path);
+            for (const auto& glob : globs)
+                if (fnmatch(glob.pattern.c_str(), pathStr.c_str(), FNM_PATHNAME) == 0)
+                    return true;
+
+            return false;
+        }
+
+        bool PayloadFilter::patternsCanDescend(std::string_view dirPath) const {
+            if (globs.empty() && prefixes.empty())
+                return true;
+
+            // entries below the dir and the prefix overlap if one starts with the other
+            for (const auto& prefix : prefixes) {
+                if (startsWith(dirPath, prefix) ||
+                    (startsWith(prefix, dirPath) && prefix.size() > dirPath.size() && prefix[dirPath.size()] == '/'))
+                    return true;
+            }
+
+            std::string component;
+            for (const auto& glob : globs) {
+                // the entries below the dir have more components than the dir itself
+                if (glob.components.size() <= pathDepth(dirPath))
+                    continue;
+
+                bool matching = true;
+                std::string_view::size_type begin = 0;
+                for (size_t i = 0; matching && begin <= dirPath.size(); ++i) {
+                    auto end = dirPath.find('/', begin);
+                    if (end == std::string_view::npos)
+                        end = dirPath.size();
+
+                    component.assign(dirPath.substr(begin, end - begin));
+                    matching = fnmatch(glob.components[i].c_str(), component.c_str(), 0) == 0;
+                    begin = end + 1;
+                }
+
+                if (matching)
+                    return true;
+            }
+
+            return false;
+        }
+    }
+}
@@ -0,0 +1,404 @@
+// system
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// libraries
+#include <XdgUtils/BaseDir/BaseDir.h>
+
+// local
+#include <appimage/core/exceptions.h>
+#include <appimage/core/PayloadIndexCache.h>
+#include "core/impl/TraversalType1.h"
+#include "core/impl/TraversalType2.h"
+#include "utils/MappedFile.h"
+#include "PayloadIndex.h"
+
+namespace {
+    constexpr char INDEX_MAGIC[8] = {'A', 'I', 'P', 'I', 'N', 'D', 'E', 'X'};
+
+    // Must be increased on every change of the index file layout or of the entries ids
+    constexpr uint32_t INDEX_VERSION = 2;
+
+    constexpr char INDEX_FILE_EXTENSION[] = ".idx";
+
+    // PayloadIndexCache settings
+    std::atomic<bool> cacheEnabled{false};
+    std::atomic<size_t> cacheMaxFiles{256};
+
+    /**
+     * Identifies the AppImage file an index was built from
+     */
+    struct Fingerprint {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        uint64_t fileSize = 0;
+        int64_t mtime = 0;
+        int64_t payloadOffset = 0;
+
+        bool operator==(const Fingerprint& other) const {
+            return device == other.device && inode == other.inode && fileSize == other.fileSize &&
+                   mtime == other.mtime && payloadOffset == other.payloadOffset;
+        }
+    };
+
+    /*
+     * Index file layout, all the values are stored in the host byte order:
+     *
+     * Header
+     * Record[entriesCount] sorted by path
+     * strings blob, referenced by the records
+     */
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t entriesCount;
+        Fingerprint fingerprint;
+        uint64_t stringsSize;
+    };
+
+    struct Record {
+        uint64_t id;
+        uint64_t size;
+        uint32_t pathOffset;
+        uint32_t pathSize;
+        uint32_t linkOffset;
+        uint32_t linkSize;
+        uint32_t mode;
+        int32_t type;
+    };
+
+    static_assert(sizeof(Header) == 64, "Unexpected index header size");
+    static_assert(sizeof(Record) == 40, "Unexpected index record size");
+
+    Fingerprint readFingerprint(const appimage::core::AppImage& appImage) {
+        struct stat st = {};
+        if (stat(appImage.getPath().c_str(), &st) != 0)
+            throw appimage::core::FileSystemError("Unable to stat file: " + appImage.getPath());
+
+        Fingerprint fingerprint;
+        fingerprint.device = st.st_dev;
+        fingerprint.inode = st.st_ino;
+        fingerprint.fileSize = (uint64_t) st.st_size;
+        fingerprint.mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        fingerprint.payloadOffset = appImage.getPayloadOffset();
+        return fingerprint;
+    }
+}
+
+namespace appimage {
+    namespace core {
+        class PayloadIndex::Private {
+        public:
+            // index file mapping, set when the index was loaded from the cache
+            std::unique_ptr<utils::MappedFile> mapping;
+
+            // index data, set when the index couldn't be loaded from the cache
+            std::vector<char> buffer;
+
+            const Header* header = nullptr;
+            const Record* records = nullptr;
+            const char* strings = nullptr;
+
+            bool loadedFromCache = false;
+
+            Private(const AppImage& appImage, bool persistent) {
+                const auto fingerprint = readFingerprint(appImage);
+
+                std::string indexPath;
+                if (persistent) {
+                    indexPath = getIndexPath(fingerprint);
+                    loadedFromCache = loadFile(indexPath, fingerprint);
+                }
+
+                if (!loadedFromCache) {
+                    buffer = build(appImage, fingerprint);
+                    if (!load(buffer.data(), buffer.size(), fingerprint))
+                        throw AppImageError("Unable to build the payload index: " + appImage.getPath());
+
+                    if (persistent)
+                        store(indexPath, buffer);
+                }
+            }
+
+            Entry getEntry(size_t index) const {
+                const auto& record = records[index];
+
+                Entry entry;
+                entry.path = std::string_view(strings + record.pathOffset, record.pathSize);
+                entry.type = (PayloadEntryType) record.type;
+                entry.linkTarget = std::string_view(strings + record.linkOffset, record.linkSize);
+                entry.size = record.size;
+                entry.id = record.id;
+                entry.mode = record.mode;
+                return entry;
+            }
+
+            std::string_view getPath(const Record& record) const {
+                return std::string_view(strings + record.pathOffset, record.pathSize);
+            }
+
+        private:
+            static std::string getIndexPath(const Fingerprint& fingerprint) {
+                return getCacheDir() + "/" + std::to_string(fingerprint.device) + "-" +
+                       std::to_string(fingerprint.inode) + INDEX_FILE_EXTENSION;
+            }
+
+            bool loadFile(const std::string& indexPath, const Fingerprint& fingerprint) {
+                if (access(indexPath.c_str(), R_OK) != 0)
+                    return false;
+
+                try {
+                    std::unique_ptr<utils::MappedFile> indexMapping(new utils::MappedFile(indexPath));
+                    if (!load(indexMapping->data(), indexMapping->size(), fingerprint))
+                        return false;
+
+                    mapping = std::move(indexMapping);
+
+                    // the modification time tells the least recently used indexes apart, errors are ignored
+                    utimensat(AT_FDCWD, indexPath.c_str(), nullptr, 0);
+                    return true;
+                } catch (const IOError&) {
+                    return false;
+                }
+            }
+
+            /**
+             * Point the header, records and strings at <data> after validating its contents
+             * @return true if <data> holds a valid index for <fingerprint>, false otherwise
+             */
+            bool load(const char* data, size_t size, const Fingerprint& fingerprint) {
+                if (data == nullptr || size < sizeof(Header))
+                    return false;
+
+                auto dataHeader = reinterpret_cast<const Header*>(data);
+                if (memcmp(dataHeader->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+                    dataHeader->version != INDEX_VERSION || !(dataHeader->fingerprint == fingerprint))
+                    return false;
+
+                const uint64_t recordsSize = (uint64_t) dataHeader->entriesCount * sizeof(Record);
+                if (sizeof(Header) + recordsSize + dataHeader->stringsSize != size)
+                    return false;
+
+                auto dataRecords = reinterpret_cast<const Record*>(data + sizeof(Header));
+                for (uint32_t i = 0; i < dataHeader->entriesCount; ++i) {
+                    const auto& record = dataRecords[i];
+                    if ((uint64_t) record.pathOffset + record.pathSize > dataHeader->stringsSize ||
+                        (uint64_t) record.linkOffset + record.linkSize > dataHeader->stringsSize)
+                        return false;
+                }
+
+                header = dataHeader;
+                records = dataRecords;
+                strings = data + sizeof(Header) + recordsSize;
+                return true;
+            }
+
+            /**
+             * Traverse the payload and serialize its entries
+             * @return index data
+             */
+            static std::vector<char> build(const AppImage& appImage, const Fingerprint& fingerprint) {
+                std::unique_ptr<Traversal> traversal;
+                switch (appImage.getFormat()) {
+                    case AppImageFormat::TYPE_1:
+                        traversal.reset(new impl::TraversalType1(appImage.getPath()));
+                        break;
+                    case AppImageFormat::TYPE_2:
+                        traversal.reset(new impl::TraversalType2(appImage.getPath(), fingerprint.payloadOffset,
+                                                                 nullptr));
+                        break;
+                    default:
+                        throw AppImageError("Unsupported AppImage format: " + appImage.getPath());
+                }
+
+                std::string stringsBlob;
+                std::map<std::string, Record> sortedRecords;
+                for (; !traversal->isCompleted(); traversal->next()) {
+                    const auto& path = traversal->getEntryPath();
+
+                    // directories may be visited twice
+                    if (path.empty() || sortedRecords.find(path) != sortedRecords.end())
+                        continue;
+
+                    Record record = {};
+                    record.id = traversal->getEntryId();
+                    record.size = traversal->getEntrySize();
+                    record.mode = traversal->getEntryMode();
+                    record.type = (int32_t) traversal->getEntryType();
+
+                    record.pathOffset = (uint32_t) stringsBlob.size();
+                    record.pathSize = (uint32_t) path.size();
+                    stringsBlob += path;
+
+                    const auto& linkTarget = traversal->getEntryLinkTarget();
+                    record.linkOffset = (uint32_t) stringsBlob.size();
+                    record.linkSize = (uint32_t) linkTarget.size();
+                    stringsBlob += linkTarget;
+
+                    sortedRecords.emplace(path, record);
+                }
+
+                Header indexHeader = {};
+                memcpy(indexHeader.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+                indexHeader.version = INDEX_VERSION;
+                indexHeader.entriesCount = (uint32_t) sortedRecords.size();
+                indexHeader.fingerprint = fingerprint;
+                indexHeader.stringsSize = stringsBlob.size();
+
+                std::vector<char> data;
+                data.reserve(sizeof(Header) + sortedRecords.size() * sizeof(Record) + stringsBlob.size());
+
+                auto append = [&data](const void* src, size_t size) {
+                    data.insert(data.end(), (const char*) src, (const char*) src + size);
+                };
+
+                append(&indexHeader, sizeof(indexHeader));
+                for (const auto& item : sortedRecords)
+                    append(&item.second, sizeof(Record));
+                append(stringsBlob.data(), stringsBlob.size());
+
+                return data;
+            }
+
+            /**
+             * Write <data> at <indexPath>. The file is replaced atomically so concurrent readers never
+             * see a partial index. Errors are ignored, the index is just not persisted.
+             */
+            static void store(const std::string& indexPath, const std::vector<char>& data) {
+                std::error_code error;
+                std::filesystem::create_directories(std::filesystem::path(indexPath).parent_path(), error);
+                if (error)
+                    return;
+
+                // unique per writer, other threads or processes may be storing the same index
+                std::string tmpPath = indexPath + ".tmp.XXXXXX";
+                const int fd = mkostemp(&tmpPath[0], O_CLOEXEC);
+                if (fd == -1)
+                    return;
+
+                const char* remaining = data.data();
+                size_t remainingSize = data.size();
+                while (remainingSize > 0) {
+                    const auto written = write(fd, remaining, remainingSize);
+                    if (written < 0 && errno == EINTR)
+                        continue;
+
+                    if (written < 0)
+                        break;
+
+                    remaining += written;
+                    remainingSize -= (size_t) written;
+                }
+
+                // the file is readable only by its owner, as created by mkostemp
+                if (close(fd) != 0 || remainingSize > 0) {
+                    unlink(tmpPath.c_str());
+                    return;
+                }
+
+                if (rename(tmpPath.c_str(), indexPath.c_str()) != 0) {
+                    unlink(tmpPath.c_str());
+                    return;
+                }
+
+                evict(std::filesystem::path(indexPath).parent_path());
+            }
+
+            /**
+             * Remove the least recently used indexes stored in <cacheDir> beyond the PayloadIndexCache limit.
+             * Errors are ignored, other processes may be removing the same files.
+             */
+            static void evict(const std::filesystem::path& cacheDir) {
+                std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> indexFiles;
+
+                std::error_code error;
+                for (std::filesystem::directory_iterator itr(cacheDir, error), end; !error && itr != end;
+                     itr.increment(error)) {
+                    if (itr->path().extension() != INDEX_FILE_EXTENSION)
+                        continue;
+
+                    const auto lastWriteTime = itr->last_write_time(error);
+                    if (!error)
+                        indexFiles.emplace_back(lastWriteTime, itr->path());
+                }
+
+                const size_t maxFiles = cacheMaxFiles;
+                if (indexFiles.size() <= maxFiles)
+                    return;
+
+                std::sort(indexFiles.begin(), indexFiles.end());
+                for (size_t i = 0; i < indexFiles.size() - maxFiles; ++i)
+                    std::filesystem::remove(indexFiles[i].second, error);
+            }
+        };
+
+        PayloadIndex::PayloadIndex(const AppImage& appImage, bool persistent)
+            : d(new Private(appImage, persistent)) {}
+
+        PayloadIndex::~PayloadIndex() = default;
+
+        size_t PayloadIndex::size() const {
+            return d->header->entriesCount;
+        }
+
+        PayloadIndex::Entry PayloadIndex::operator[](size_t index) const {
+            return d->getEntry(index);
+        }
+
+        bool PayloadIndex::find(std::string_view path, PayloadIndex::Entry& entry) const {
+            const auto begin = d->records;
+            const auto end = d->records + d->header->entriesCount;
+
+            auto itr = std::lower_bound(begin, end, path, [this](const Record& record, std::string_view value) {
+                return d->getPath(record) < value;
+            });
+
+            if (itr == end || d->getPath(*itr) != path)
+                return false;
+
+            entry = d->getEntry((size_t) (itr - begin));
+            return true;
+        }
+
+        bool PayloadIndex::isLoadedFromCache() const {
+            return d->loadedFromCache;
+        }
+
+        std::string PayloadIndex::getCacheDir() {
+            return XdgUtils::BaseDir::XdgCacheHome() + "/libappimage/payload-index";
+        }
+
+        void PayloadIndexCache::setEnabled(bool enabled) {
+            cacheEnabled = enabled;
+        }
+
+        bool PayloadIndexCache::isEnabled() {
+            return cacheEnabled;
+        }
+
+        void PayloadIndexCache::setMaxFiles(size_t count) {
+            cacheMaxFiles = count;
+        }
+
+        size_t PayloadIndexCache::getMaxFiles() {
+            return cacheMaxFiles;
+        }
+
+        void PayloadIndexCache::clear() {
+            std::error_code error;
+            for (std::filesystem::directory_iterator itr(PayloadIndex::getCacheDir(), error), end;
+                 !error && itr != end; itr.increment(error)) {
+                if (itr->path().extension() == INDEX_FILE_EXTENSION)
+                    std::filesystem::remove(itr->path(), error);
+            }
+        }
+    }
+}
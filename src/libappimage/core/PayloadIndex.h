@@ -0,0 +1,95 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+// local
+#include <appimage/core/AppImage.h>
+#include <appimage/core/PayloadEntry.h>
+#include <appimage/core/PayloadEntryType.h>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Sorted index of the entries contained in an AppImage payload: paths, types, link targets, sizes
+         * and entry ids.
+         *
+         * The index is built with a single traversal. Persistent indexes are stored in a compact binary file
+         * under $XDG_CACHE_HOME/libappimage/payload-index, later instances for the same AppImage map that file
+         * instead of traversing the payload again. Index files are keyed by the AppImage device, inode, size,
+         * modification time and payload offset, so modified files are always indexed again. The least recently
+         * used files are removed beyond the PayloadIndexCache limit.
+         *
+         * If the cache directory is not writable the index is kept in memory only.
+         */
+        class PayloadIndex {
+        public:
+            /**
+             * Indexed entry. Strings point into the index data and remain valid as long as the index is alive.
+             */
+            struct Entry {
+                std::string_view path;
+                PayloadEntryType type = PayloadEntryType::UNKNOWN;
+                std::string_view linkTarget;
+                uint64_t size = 0;
+                PayloadEntryId id = 0;
+                mode_t mode = 0;
+            };
+
+            /**
+             * Load the index of <appImage> from the cache or build it if missing or outdated.
+             * @param appImage
+             * @param persistent whether the index should be loaded from and stored into the cache directory, callers
+             * should follow PayloadIndexCache::isEnabled()
+             * @throw AppImageError if the payload can't be traversed
+             */
+            explicit PayloadIndex(const AppImage& appImage, bool persistent = false);
+
+            // Creating copies of this object is not allowed
+            PayloadIndex(PayloadIndex& other) = delete;
+
+            // Creating copies of this object is not allowed
+            PayloadIndex& operator=(PayloadIndex& other) = delete;
+
+            ~PayloadIndex();
+
+            /**
+             * @return number of entries
+             */
+            size_t size() const;
+
+            /**
+             * @param index
+             * @return entry at <index>, entries are sorted by path
+             */
+            Entry operator[](size_t index) const;
+
+            /**
+             * Find the entry at <path> by means of a binary search
+             * @param path
+             * @param entry will be filled with the entry data if found
+             * @return true if the entry was found, false otherwise
+             */
+            bool find(std::string_view path, Entry& entry) const;
+
+            /**
+             * @return true if the index was read from the cache directory instead of traversing the payload
+             */
+            bool isLoadedFromCache() const;
+
+            /**
+             * @return directory where the index files are stored
+             */
+            static std::string getCacheDir();
+
+        private:
+            class Private;
+
+            std::unique_ptr<Private> d;
+        };
+    }
+}
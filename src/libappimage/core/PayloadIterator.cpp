@@ -16,7 +16,8 @@ namespace appimage {
          * A Traversal class is used to traverse the files and directories inside the AppImage payload. The required
          * Traversal derivative is instantiated on demand by the constructor.
          *
-         * The "end state" of the iterator is represented by a nullptr traversal.
+         * The "end state" of the iterator is represented by a nullptr traversal. It's created once per iterator
+         * and shared by the iterators returned by end(), comparing against them is a pair of pointer checks.
          *
          * The major part of this class methods are proxies over the Traversal class. Therefore they behave the same. If
          * the traversal reach the "end state" those methods will return a default value to keep the integrity of the
@@ -25,34 +26,56 @@ namespace appimage {
         class PayloadIterator::Private {
             AppImage appImage;
 
-            // to be used by the read method when the end of the traversal is reached
-            std::stringstream emptyStream;
+            // payload directory at which the traversal starts, empty for the payload root
+            std::string subdir;
+
+            // entries to be reported
+            PayloadFilter filter;
+
+            // to be used by the read method when the end of the traversal is reached, created on demand
+            std::unique_ptr<std::stringstream> emptyStream;
 
             // Real Traversal implementation
             std::shared_ptr<Traversal> traversal;
 
             // flags whether a the current entry contents has been read or not
             bool entryDataConsumed = false;
+
+            // shared "end state", created on demand
+            std::shared_ptr<Private> endPrivate;
         public:
             /**
              * Initialized the Private class with required traversal derivative if <atEnd> is false.
              * @param appImage
+             * @param subdir
+             * @param filter
              * @param atEnd determine if a end state iterator should be created
              */
-            explicit Private(const AppImage& appImage, bool atEnd = false) : appImage(appImage) {
+            Private(const AppImage& appImage, const std::string& subdir, const PayloadFilter& filter,
+                    bool atEnd = false)
+                : appImage(appImage), subdir(subdir), filter(filter) {
                 // only initialize if the iterator is not in the "end state"
-                if (!atEnd) {
-                    switch (appImage.getFormat()) {
-                        case AppImageFormat::TYPE_1:
-                            traversal = std::shared_ptr<Traversal>(new impl::TraversalType1(appImage.getPath()));
-                            break;
-                        case AppImageFormat::TYPE_2:
-                            traversal = std::shared_ptr<Traversal>(new impl::TraversalType2(appImage.getPath()));
-                            break;
-                        default:
-                            break;
-                    }
+                if (atEnd)
+                    return;
+
+                switch (appImage.getFormat()) {
+                    case AppImageFormat::TYPE_1:
+                        traversal = std::shared_ptr<Traversal>(new impl::TraversalType1(appImage.getPath(), subdir,
+                                                                                         filter));
+                        break;
+                    case AppImageFormat::TYPE_2:
+                        traversal = std::shared_ptr<Traversal>(new impl::TraversalType2(appImage.getPath(),
+                                                                                         appImage.getPayloadOffset(),
+                                                                                         appImage.getMapping(),
+                                                                                         subdir, filter));
+                        break;
+                    default:
+                        break;
                 }
+
+                // empty traversals start at the "end state"
+                if (traversal && traversal->isCompleted())
+                    traversal.reset();
             }
 
             // Creating copies of this object is not allowed
@@ -63,11 +86,15 @@ namespace appimage {
 
             // Move constructor
             Private(PayloadIterator::Private&& other) noexcept : appImage(other.appImage),
+                                                                 subdir(std::move(other.subdir)),
+                                                                 filter(std::move(other.filter)),
                                                                  traversal(other.traversal) {}
 
             // Move assignment operator
             PayloadIterator::Private& operator=(PayloadIterator::Private&& other) noexcept {
                 appImage = other.appImage;
+                subdir = std::move(other.subdir);
+                filter = std::move(other.filter);
                 traversal = other.traversal;
                 return *this;
             }
@@ -86,7 +113,7 @@ namespace appimage {
                 return !(rhs == *this);
             }
 
-            bool isCompleted() { return traversal == nullptr; }
+            bool isCompleted() const { return traversal == nullptr; }
 
             void next() {
                 // move forward only if we haven't reached the end
@@ -104,18 +131,22 @@ namespace appimage {
 
             PayloadEntryType type() { return isCompleted() ? PayloadEntryType::UNKNOWN : traversal->getEntryType(); }
 
-            std::string entryName() { return isCompleted() ? std::string() : traversal->getEntryPath(); }
+            const std::string& entryName() { return isCompleted() ? emptyString() : traversal->getEntryPath(); }
+
+            std::string_view entryNameView() { return isCompleted() ? emptyString() : traversal->getEntryPathView(); }
 
-            std::string entryLink() { return isCompleted() ? std::string() : traversal->getEntryLinkTarget(); }
+            const std::string& entryLink() { return isCompleted() ? emptyString() : traversal->getEntryLinkTarget(); }
 
-            void extractTo(const std::string& target) {
+            EntryStat stat() { return isCompleted() ? EntryStat() : traversal->getEntryStat(); }
+
+            void extractTo(const std::string& target, const ExtractOptions& options) {
                 // Enforce ONE PASS restriction
                 if (entryDataConsumed)
                     throw PayloadIteratorError("Entry data consumed");
                 else
                     entryDataConsumed = true;
 
-                if (!isCompleted()) traversal->extract(target);
+                if (!isCompleted()) traversal->extract(target, options);
             }
 
             std::istream& read() {
@@ -125,15 +156,39 @@ namespace appimage {
                 else
                     entryDataConsumed = true;
 
-                return isCompleted() ? emptyStream : traversal->read();
+                if (!isCompleted())
+                    return traversal->read();
+
+                if (!emptyStream)
+                    emptyStream.reset(new std::stringstream());
+
+                return *emptyStream;
             }
 
-            Private* beginState() { return new Private(appImage); }
+            Private* beginState() { return new Private(appImage, subdir, filter); }
 
-            Private* endState() { return new Private(appImage, true); }
+            const std::shared_ptr<Private>& endState() {
+                if (!endPrivate)
+                    endPrivate = std::make_shared<Private>(appImage, subdir, filter, true);
+
+                return endPrivate;
+            }
+
+        private:
+            static const std::string& emptyString() {
+                static const std::string empty;
+                return empty;
+            }
         };
 
-        PayloadIterator::PayloadIterator(const AppImage& appImage) : d(new Private(appImage)) {}
+        PayloadIterator::PayloadIterator(const AppImage& appImage)
+            : d(new Private(appImage, std::string(), PayloadFilter())) {}
+
+        PayloadIterator::PayloadIterator(const AppImage& appImage, const std::string& subdir)
+            : d(new Private(appImage, subdir, PayloadFilter())) {}
+
+        PayloadIterator::PayloadIterator(const AppImage& appImage, const PayloadFilter& filter)
+            : d(new Private(appImage, std::string(), filter)) {}
 
         PayloadIterator::PayloadIterator(PayloadIterator&& other) noexcept { d = other.d; }
 
@@ -146,9 +201,17 @@ namespace appimage {
 
         std::string PayloadIterator::path() { return d->entryName(); }
 
+        std::string_view PayloadIterator::pathView() { return d->entryNameView(); }
+
         std::string PayloadIterator::linkTarget() { return d->entryLink(); }
 
-        void PayloadIterator::extractTo(const std::string& target) { d->extractTo(target); }
+        std::string_view PayloadIterator::linkTargetView() { return d->entryLink(); }
+
+        EntryStat PayloadIterator::stat() { return d->stat(); }
+
+        void PayloadIterator::extractTo(const std::string& target, const ExtractOptions& options) {
+            d->extractTo(target, options);
+        }
 
         std::istream& PayloadIterator::read() { return d->read(); }
 
@@ -167,6 +230,8 @@ namespace appimage {
 
         PayloadIterator::PayloadIterator(PayloadIterator::Private* d) : d(d) {}
 
+        PayloadIterator::PayloadIterator(std::shared_ptr<PayloadIterator::Private> d) : d(std::move(d)) {}
+
         bool PayloadIterator::operator==(const PayloadIterator& other) const { return *d == *(other.d); }
 
         bool PayloadIterator::operator!=(const PayloadIterator& other) const { return !(other == *this); }
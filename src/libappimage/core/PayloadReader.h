@@ -0,0 +1,73 @@
+#pragma once
+
+// system
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// local
+#include <appimage/core/EntryStat.h>
+#include <appimage/core/PayloadEntry.h>
+#include <appimage/core/PayloadEntryType.h>
+
+namespace appimage {
+    namespace core {
+        /**
+         * Abstract representation of random access operations over an AppImage payload. Serves as
+         * extension point for the <PayloadEntry> class. Unlike Traversal it allows to reach a given
+         * entry without visiting the ones before it.
+         *
+         * Implementations are NOT thread safe.
+         */
+        class PayloadReader {
+        public:
+            /**
+             * Plain description of a payload entry
+             */
+            struct Entry {
+                PayloadEntryId id = 0;
+                std::string path;
+                PayloadEntryType type = PayloadEntryType::UNKNOWN;
+                std::string linkTarget;
+                EntryStat stat;
+            };
+
+            virtual ~PayloadReader() = default;
+
+            /**
+             * Resolve <path> inside the payload.
+             * @param path
+             * @param entry will be filled with the entry data if found
+             * @return true if the entry was found, false otherwise
+             */
+            virtual bool lookup(const std::string& path, Entry& entry) = 0;
+
+            /**
+             * Reopen the entry with the given <id>.
+             * @param id
+             * @return entry data
+             * @throw PayloadIteratorError if <id> doesn't point to a valid entry
+             */
+            virtual Entry open(PayloadEntryId id) = 0;
+
+            /**
+             * List the entries contained directly in the directory at <path>, sub directories contents are
+             * not included. Links are NOT resolved.
+             * @param path
+             * @param entries will be filled with the directory entries if found
+             * @return true if the directory was found, false otherwise
+             * @throw PayloadIteratorError if <path> is not a directory
+             */
+            virtual bool list(const std::string& path, std::vector<Entry>& entries) = 0;
+
+            /**
+             * Create a streambuf to read the contents of <entry>. The streambuf remains valid as long as
+             * the reader is alive.
+             * @param entry
+             * @return entry contents streambuf
+             */
+            virtual std::unique_ptr<std::streambuf> read(const Entry& entry) = 0;
+        };
+    }
+}
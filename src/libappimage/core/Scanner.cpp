@@ -0,0 +1,189 @@
+// system
+#include <array>
+#include <cerrno>
+#include <mutex>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// local
+#include <appimage/core/Scanner.h>
+#include <appimage/core/exceptions.h>
+#include "core/impl/FormatDetection.h"
+#include "utils/ElfFile.h"
+#include "utils/MagicBytesChecker.h"
+#include "utils/WorkerPool.h"
+
+namespace appimage {
+    namespace core {
+        namespace {
+            // Covers the ELF magic and the AppImage type bytes, enough to classify most files
+            constexpr size_t HEADER_SIZE = 4096;
+
+            struct FileStats {
+                mode_t mode = 0;
+                uint64_t size = 0;
+                struct timespec mtime = {};
+            };
+
+            /**
+             * Stat <name> relative to <dirFd> following symlinks. statx() is used when available as it
+             * allows to skip the attributes synchronization on network file systems.
+             * @return true on success, false otherwise
+             */
+            bool statFile(int dirFd, const char* name, FileStats& stats) {
+#ifdef STATX_BASIC_STATS
+                struct statx stx = {};
+                if (statx(dirFd, name, AT_STATX_DONT_SYNC, STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME,
+                          &stx) == 0) {
+                    stats.mode = stx.stx_mode;
+                    stats.size = stx.stx_size;
+                    stats.mtime.tv_sec = stx.stx_mtime.tv_sec;
+                    stats.mtime.tv_nsec = stx.stx_mtime.tv_nsec;
+                    return true;
+                }
+
+                if (errno != ENOSYS)
+                    return false;
+#endif
+                struct stat st = {};
+                if (fstatat(dirFd, name, &st, 0) != 0)
+                    return false;
+
+                stats.mode = st.st_mode;
+                stats.size = (uint64_t) st.st_size;
+                stats.mtime = st.st_mtim;
+                return true;
+            }
+
+            size_t readHeader(int fd, char* buffer, size_t size) {
+                size_t bytesRead = 0;
+                while (bytesRead < size) {
+                    auto ret = pread(fd, buffer + bytesRead, size - bytesRead, (off_t) bytesRead);
+                    if (ret < 0 && errno == EINTR)
+                        continue;
+
+                    if (ret <= 0)
+                        break;
+
+                    bytesRead += (size_t) ret;
+                }
+
+                return bytesRead;
+            }
+
+            AppImageFormat readFormat(int fd, const std::string& path) {
+                std::array<char, HEADER_SIZE> header = {};
+                const auto headerSize = readHeader(fd, header.data(), header.size());
+
+                utils::MagicBytesChecker headerChecker(header.data(), headerSize);
+                if (!headerChecker.hasElfSignature() || headerChecker.hasAppImageType1Signature() ||
+                    headerChecker.hasAppImageType2Signature())
+                    return impl::detectFormat(headerChecker, path);
+
+                // ELF files without magic bytes can still be type 1 AppImages, that requires the ISO 9660
+                // signatures which are found further
+                return impl::detectFormat(utils::MagicBytesChecker(fd), path);
+            }
+        }
+
+        /**
+         * Implementation of the opaque pointer patter for the Scanner class
+         */
+        class Scanner::Private {
+        public:
+            ScanOptions options;
+
+            explicit Private(const ScanOptions& options) : options(options) {}
+
+            /**
+             * Fill <result> with the stats and format of the file <name> relative to <dirFd>
+             * @return false if <name> is not a regular file, true otherwise
+             */
+            bool inspect(int dirFd, const char* name, ScanResult& result) const {
+                FileStats stats;
+                if (!statFile(dirFd, name, stats) || !S_ISREG(stats.mode))
+                    return false;
+
+                result.size = stats.size;
+                result.mtime = stats.mtime;
+
+                if (stats.size < options.minimumSize || (options.executableOnly && (stats.mode & 0111) == 0))
+                    return true;
+
+                int fd = openat(dirFd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+                if (fd == -1)
+                    return true;
+
+                result.format = readFormat(fd, result.path);
+                close(fd);
+
+                if (result.format != AppImageFormat::INVALID)
+                    result.payloadOffset = utils::ElfFile(result.path).getSize();
+
+                return true;
+            }
+
+            /**
+             * Run <inspectJob> for every job and report its result if required
+             */
+            void run(size_t jobsCount, const Callback& callback,
+                     const std::function<bool(size_t job, ScanResult& result)>& inspectJob) const {
+                std::mutex callbackMutex;
+
+                utils::WorkerPool pool(options.threads);
+                pool.run(jobsCount, [&](unsigned int, size_t job) {
+                    ScanResult result;
+                    if (!inspectJob(job, result))
+                        return;
+
+                    std::lock_guard<std::mutex> lock(callbackMutex);
+                    callback(result);
+                });
+            }
+        };
+
+        Scanner::Scanner(const ScanOptions& options) : d(new Private(options)) {}
+
+        void Scanner::scanDirectory(const std::string& dirPath, const Scanner::Callback& callback) const {
+            DIR* dir = opendir(dirPath.c_str());
+            if (dir == nullptr)
+                throw FileSystemError("Unable to open directory: " + dirPath);
+
+            std::vector<std::string> names;
+            try {
+                errno = 0;
+                while (auto entry = readdir(dir)) {
+                    // other types are discarded after following the links
+                    if (entry->d_type == DT_REG || entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+                        names.emplace_back(entry->d_name);
+                }
+
+                if (errno != 0)
+                    throw FileSystemError("Unable to read directory: " + dirPath);
+
+                const int dirFd = dirfd(dir);
+                d->run(names.size(), callback, [&](size_t job, ScanResult& result) {
+                    result.path = dirPath + "/" + names[job];
+                    return d->inspect(dirFd, names[job].c_str(), result);
+                });
+            } catch (...) {
+                closedir(dir);
+                throw;
+            }
+
+            closedir(dir);
+        }
+
+        void Scanner::scanFiles(const std::vector<std::string>& paths, const Scanner::Callback& callback) const {
+            d->run(paths.size(), callback, [&](size_t job, ScanResult& result) {
+                result.path = paths[job];
+
+                // files that can't be inspected are reported anyway
+                d->inspect(AT_FDCWD, paths[job].c_str(), result);
+                return true;
+            });
+        }
+    }
+}
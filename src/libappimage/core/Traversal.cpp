@@ -3,6 +3,10 @@
 #include "Traversal.h"
 namespace appimage {
     namespace core {
+        std::string_view Traversal::getEntryPathView() const {
+            return getEntryPath();
+        }
+
         bool Traversal::operator==(const Traversal& rhs) const {
             return getEntryPath() == rhs.getEntryPath() &&
                    getEntryType() == rhs.getEntryType() &&
@@ -1,9 +1,15 @@
 #pragma once
 
 // system
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <sys/types.h>
 
 // local
+#include <appimage/core/EntryStat.h>
+#include <appimage/core/ExtractOptions.h>
+#include <appimage/core/PayloadEntry.h>
 #include <appimage/core/PayloadEntryType.h>
 
 namespace appimage {
@@ -16,6 +22,9 @@ namespace appimage {
          * - SINGLE WAY: can't go backwards only forward.
          * - ONE PASS: A new instance is required to re-traverse the AppImage.
          * - NO ORDER: There is no warranty that the traversal will follow a given order.
+         *
+         * Implementations may read the entries data on demand, callers that only need the entries paths and
+         * types should not request anything else.
          */
         class Traversal {
         public:
@@ -32,24 +41,51 @@ namespace appimage {
             /**
              * @return name of the file entry inside the AppImage
              */
-            virtual std::string getEntryPath() const = 0;
+            virtual const std::string& getEntryPath() const = 0;
+
+            /**
+             * Non-copying variant of getEntryPath(). The view becomes invalid when next() is called.
+             * @return name of the file entry inside the AppImage
+             */
+            virtual std::string_view getEntryPathView() const;
 
             /**
              * @return the target link of the current entry if it's of type LINK. Otherwise return an empty string.
              */
-            virtual std::string getEntryLinkTarget() const = 0;
+            virtual const std::string& getEntryLinkTarget() const = 0;
 
             /**
              * @return the type of the current entry.
              */
             virtual PayloadEntryType getEntryType() const = 0;
 
+            /**
+             * @return id of the current entry, it can be used to reopen the entry by means of a PayloadReader.
+             */
+            virtual PayloadEntryId getEntryId() const = 0;
+
+            /**
+             * @return size in bytes of the current entry if it's a regular file. Otherwise return 0.
+             */
+            virtual uint64_t getEntrySize() const = 0;
+
+            /**
+             * @return the file type and permissions of the current entry.
+             */
+            virtual mode_t getEntryMode() const = 0;
+
+            /**
+             * @return metadata of the current entry, an empty stat if the end of the traversal was reached
+             */
+            virtual EntryStat getEntryStat() const = 0;
+
             /**
              * Extracts the file to the <target> path. Supports raw files, symlinks and directories.
              * Parent target dir is created if not exists.
              * @param target path the file should be extracted
+             * @param options only the pipeline depth is used
              */
-            virtual void extract(const std::string& target) = 0;
+            virtual void extract(const std::string& target, const ExtractOptions& options) = 0;
 
             /**
              * Read file content.
@@ -0,0 +1,179 @@
+// system
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <sys/stat.h>
+
+// local
+#include "appimage/core/exceptions.h"
+#include "BlockCache.h"
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+namespace {
+    // Default memory budget of the process wide cache
+    constexpr size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    inline void hashCombine(size_t& seed, size_t value) {
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+}
+
+BlockCache::ImageId BlockCache::ImageId::fromFd(int fd) {
+    ImageId id;
+
+    // a zeroed id would be shared by every unidentified image and mix up their blocks
+    struct stat st = {};
+    if (fstat(fd, &st) != 0)
+        throw IOError(std::string("fstat error: ") + strerror(errno));
+
+    id.device = st.st_dev;
+    id.inode = st.st_ino;
+    id.mtime = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+
+    return id;
+}
+
+bool BlockCache::ImageId::operator==(const BlockCache::ImageId& other) const {
+    return device == other.device && inode == other.inode && mtime == other.mtime;
+}
+
+bool BlockCache::Key::operator==(const BlockCache::Key& other) const {
+    return image == other.image && entryId == other.entryId && offset == other.offset;
+}
+
+size_t BlockCache::KeyHash::operator()(const BlockCache::Key& key) const {
+    size_t seed = std::hash<uint64_t>()(key.image.device);
+    hashCombine(seed, std::hash<uint64_t>()(key.image.inode));
+    hashCombine(seed, std::hash<int64_t>()(key.image.mtime));
+    hashCombine(seed, std::hash<uint64_t>()(key.entryId));
+    hashCombine(seed, std::hash<uint64_t>()(key.offset));
+    return seed;
+}
+
+BlockCache& BlockCache::instance() {
+    static BlockCache cache(DEFAULT_BUDGET);
+    return cache;
+}
+
+BlockCache::BlockCache(size_t budget) : budget(budget) {}
+
+BlockCache::Block BlockCache::get(const BlockCache::Key& key) {
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto itr = shard.index.find(key);
+    if (itr == shard.index.end()) {
+        ++misses;
+        return nullptr;
+    }
+
+    // mark as most recently used
+    shard.lru.splice(shard.lru.begin(), shard.lru, itr->second);
+    ++hits;
+
+    return itr->second->second;
+}
+
+void BlockCache::put(const BlockCache::Key& key, const BlockCache::Block& block) {
+    const size_t shardBudget = budget / SHARDS_COUNT;
+    if (!block || block->size() > shardBudget)
+        return;
+
+    auto& shard = shardFor(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto itr = shard.index.find(key);
+    if (itr != shard.index.end()) {
+        shard.size -= itr->second->second->size();
+        shard.lru.erase(itr->second);
+        shard.index.erase(itr);
+    }
+
+    shard.lru.emplace_front(key, block);
+    shard.index[key] = shard.lru.begin();
+    shard.size += block->size();
+
+    evictions += shard.shrink(shardBudget);
+}
+
+void BlockCache::setBudget(size_t newBudget) {
+    budget = newBudget;
+
+    const size_t shardBudget = newBudget / SHARDS_COUNT;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        evictions += shard.shrink(shardBudget);
+    }
+}
+
+size_t BlockCache::getBudget() const {
+    return budget;
+}
+
+bool BlockCache::isEnabled() const {
+    return budget > 0;
+}
+
+PayloadBlockCache::Statistics BlockCache::getStatistics() const {
+    PayloadBlockCache::Statistics statistics;
+    statistics.hits = hits;
+    statistics.misses = misses;
+    statistics.evictions = evictions;
+    statistics.budget = budget;
+
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        statistics.size += shard.size;
+    }
+
+    return statistics;
+}
+
+void BlockCache::clear() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.lru.clear();
+        shard.index.clear();
+        shard.size = 0;
+    }
+
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+BlockCache::Shard& BlockCache::shardFor(const BlockCache::Key& key) {
+    return shards[KeyHash()(key) % SHARDS_COUNT];
+}
+
+uint64_t BlockCache::Shard::shrink(size_t shardBudget) {
+    uint64_t dropped = 0;
+
+    while (size > shardBudget && !lru.empty()) {
+        auto& last = lru.back();
+        size -= last.second->size();
+        index.erase(last.first);
+        lru.pop_back();
+        ++dropped;
+    }
+
+    return dropped;
+}
+
+void PayloadBlockCache::setMemoryBudget(size_t bytes) {
+    BlockCache::instance().setBudget(bytes);
+}
+
+size_t PayloadBlockCache::getMemoryBudget() {
+    return BlockCache::instance().getBudget();
+}
+
+PayloadBlockCache::Statistics PayloadBlockCache::getStatistics() {
+    return BlockCache::instance().getStatistics();
+}
+
+void PayloadBlockCache::clear() {
+    BlockCache::instance().clear();
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+// system
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+// local
+#include <appimage/core/PayloadBlockCache.h>
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Thread safe LRU cache of decompressed payload blocks, shared by the whole process.
+             *
+             * To reduce the contention between concurrent readers the cache is split into shards, each one
+             * with its own lock and an equal part of the memory budget. Blocks are handed out as shared
+             * pointers so readers don't have to hold any lock while using them.
+             */
+            class BlockCache {
+            public:
+                /**
+                 * Identifies an AppImage file. Changes on the file modification time invalidate the cached blocks.
+                 */
+                struct ImageId {
+                    dev_t device = 0;
+                    ino_t inode = 0;
+                    int64_t mtime = 0;
+
+                    /**
+                     * @param fd opened AppImage file
+                     * @return id of the file pointed by <fd>
+                     * @throw IOError if the file can't be stat'ed
+                     */
+                    static ImageId fromFd(int fd);
+
+                    bool operator==(const ImageId& other) const;
+                };
+
+                /**
+                 * Identifies a block of a payload entry
+                 */
+                struct Key {
+                    ImageId image;
+                    uint64_t entryId = 0;
+                    uint64_t offset = 0;
+
+                    bool operator==(const Key& other) const;
+                };
+
+                typedef std::shared_ptr<const std::vector<char>> Block;
+
+                /**
+                 * @return the process wide cache instance
+                 */
+                static BlockCache& instance();
+
+                explicit BlockCache(size_t budget);
+
+                // Creating copies of this object is not allowed
+                BlockCache(BlockCache& other) = delete;
+
+                // Creating copies of this object is not allowed
+                BlockCache& operator=(BlockCache& other) = delete;
+
+                /**
+                 * @param key
+                 * @return the cached block or nullptr if missing
+                 */
+                Block get(const Key& key);
+
+                /**
+                 * Store <block> in the cache, evicting the least recently used blocks if required.
+                 * @param key
+                 * @param block
+                 */
+                void put(const Key& key, const Block& block);
+
+                void setBudget(size_t budget);
+
+                size_t getBudget() const;
+
+                /**
+                 * @return true if blocks can be stored in the cache
+                 */
+                bool isEnabled() const;
+
+                PayloadBlockCache::Statistics getStatistics() const;
+
+                void clear();
+
+            private:
+                struct KeyHash {
+                    size_t operator()(const Key& key) const;
+                };
+
+                struct Shard {
+                    typedef std::list<std::pair<Key, Block>> LruList;
+
+                    mutable std::mutex mutex;
+                    LruList lru;
+                    std::unordered_map<Key, LruList::iterator, KeyHash> index;
+                    size_t size = 0;
+
+                    /**
+                     * Drop blocks until the size fits into <budget>. Requires the mutex to be held.
+                     * @return number of dropped blocks
+                     */
+                    uint64_t shrink(size_t budget);
+                };
+
+                static constexpr size_t SHARDS_COUNT = 16;
+
+                std::array<Shard, SHARDS_COUNT> shards;
+                std::atomic<size_t> budget;
+                std::atomic<uint64_t> hits{0};
+                std::atomic<uint64_t> misses{0};
+                std::atomic<uint64_t> evictions{0};
+
+                Shard& shardFor(const Key& key);
+            };
+        }
+    }
+}
@@ -0,0 +1,84 @@
+// system
+#include <cerrno>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// local
+#include "appimage/core/exceptions.h"
+#include "utils/AsyncFileWriter.h"
+#include "TraversalType1.h"
+#include "ExtractorType1.h"
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+namespace {
+    // Largest file handed to the AsyncFileWriter, bigger ones are extracted by the traversal
+    constexpr uint64_t ASYNC_WRITE_MAX_SIZE = 256 * 1024;
+}
+
+ExtractorType1::ExtractorType1(const std::string& path) : path(path) {}
+
+void ExtractorType1::extractAll(const std::string& targetDir, const ExtractOptions& options) {
+    std::filesystem::create_directories(targetDir);
+
+    std::unique_ptr<appimage::utils::AsyncFileWriter> writer;
+    if (options.asyncWrites)
+        writer.reset(new appimage::utils::AsyncFileWriter());
+
+    // ISO 9660 entries are not sorted, the parent directories of the files written in the background are
+    // created once they are found missing
+    std::set<std::string> createdDirs = {targetDir};
+
+    for (TraversalType1 traversal(path); !traversal.isCompleted(); traversal.next()) {
+        const std::string target = targetDir + "/" + traversal.getEntryPath();
+
+        switch (traversal.getEntryType()) {
+            case PayloadEntryType::DIR:
+                std::filesystem::create_directories(target);
+                createdDirs.insert(target);
+                break;
+
+            case PayloadEntryType::REGULAR: {
+                // copying within the kernel beats reading and writing the data in the background
+                const auto size = traversal.getEntryStat().size;
+                if (!writer || size > ASYNC_WRITE_MAX_SIZE || traversal.isEntryCopyable()) {
+                    traversal.extract(target, options);
+                    break;
+                }
+
+                const auto parentDir = std::filesystem::path(target).parent_path().string();
+                if (createdDirs.insert(parentDir).second)
+                    std::filesystem::create_directories(parentDir);
+
+                std::vector<char> data(size);
+                if (!traversal.read().read(data.data(), (std::streamsize) size))
+                    throw IOError("Unable to read the data of " + target);
+
+                // same permissions given by TraversalType1::extract
+                writer->write(target, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH, std::move(data));
+                break;
+            }
+
+            case PayloadEntryType::LINK: {
+                int ret = unlink(target.c_str());
+                if (ret != 0 && errno != ENOENT)
+                    throw IOError("unlink error at " + target);
+
+                if (symlink(traversal.getEntryLinkTarget().c_str(), target.c_str()) != 0)
+                    throw IOError("symlink error at " + target);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    if (writer)
+        writer->finish();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// system
+#include <string>
+
+// local
+#include <appimage/core/ExtractOptions.h>
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Extracts the whole payload of type 1 AppImages. It's based on libarchive.
+             *
+             * libarchive can only read ISO 9660 images sequentially, therefore the extraction is performed
+             * in a single pass on the calling thread and the threads and order options are ignored. With
+             * ExtractOptions::asyncWrites the small files are written in the background while the next entries
+             * are read.
+             */
+            class ExtractorType1 {
+            public:
+                /**
+                 * @param path AppImage file path
+                 */
+                explicit ExtractorType1(const std::string& path);
+
+                /**
+                 * Extract the whole payload into <targetDir>, which is created if it doesn't exist.
+                 * @param targetDir
+                 * @param options
+                 * @throw IOError, FileSystemError if something goes wrong
+                 */
+                void extractAll(const std::string& targetDir, const ExtractOptions& options);
+
+            private:
+                std::string path;
+            };
+        }
+    }
+}
@@ -0,0 +1,329 @@
+/*
+ * NOTE ON SQUASHFUSE:
+ * It wasn't designed originally as a library and its headers are somehow broken.
+ * Therefore they must be kept confined.
+ *
+ * keep squashfuse includes on top to avoid _POSIX_C_SOURCE redefinition warning
+*/
+extern "C" {
+#include <squashfuse.h>
+#include <squashfs_fs.h>
+}
+
+// system
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// local
+#include "appimage/core/exceptions.h"
+#include "utils/AsyncFileWriter.h"
+#include "utils/ContentStore.h"
+#include "utils/WorkerPool.h"
+#include "BlockCache.h"
+#include "SquashfsFileWriter.h"
+#include "StreambufType2.h"
+#include "ExtractorType2.h"
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+namespace {
+    // Largest file handed to the AsyncFileWriter, bigger ones are written directly by the workers
+    constexpr uint64_t ASYNC_WRITE_MAX_SIZE = 256 * 1024;
+
+    /**
+     * Owns a squashfuse context, one is required per thread as they are not thread safe.
+     */
+    class SquashfsImage {
+    public:
+        SquashfsImage(const std::string& path, off_t offset, std::shared_ptr<appimage::utils::MappedFile> mapping)
+            : mapping(std::move(mapping)) {
+            if (offset < 0)
+                throw IOError("get_elf_size error");
+
+            if (sqfs_open_image(&fs, path.c_str(), (size_t) offset) != SQFS_OK)
+                throw IOError("sqfs_open_image error: " + path);
+
+            try {
+                imageId = BlockCache::ImageId::fromFd(fs.fd);
+            } catch (...) {
+                sqfs_destroy(&fs);
+                throw;
+            }
+        }
+
+        ~SquashfsImage() {
+            sqfs_destroy(&fs);
+        }
+
+        // Creating copies of this object is not allowed
+        SquashfsImage(SquashfsImage& other) = delete;
+
+        // Creating copies of this object is not allowed
+        SquashfsImage& operator=(SquashfsImage& other) = delete;
+
+        sqfs_inode getInode(sqfs_inode_id inodeId) {
+            sqfs_inode inode;
+            if (sqfs_inode_get(&fs, &inode, inodeId) != SQFS_OK)
+                throw IOError("sqfs_inode_get error");
+
+            return inode;
+        }
+
+        std::string readLink(sqfs_inode& inode) {
+            size_t size;
+            if (sqfs_readlink(&fs, &inode, nullptr, &size) != SQFS_OK)
+                throw IOError("sqfs_readlink error");
+
+            std::vector<char> buf(size);
+            if (sqfs_readlink(&fs, &inode, buf.data(), &size) != SQFS_OK)
+                throw IOError("sqfs_readlink error");
+
+            // If the returned string is not NULL terminated a buffer overflow may occur, creating the string
+            // this way prevents it
+            return std::string(buf.data(), buf.data() + size - 1);
+        }
+
+        /**
+         * Write the contents of the file pointed by <inodeId> at <target>, sparse blocks become holes
+         * @param inodeId
+         * @param target
+         * @param buffer transfer buffer
+         * @param pipelineDepth
+         */
+        void extractFile(sqfs_inode_id inodeId, const std::string& target, std::vector<char>& buffer,
+                         unsigned int pipelineDepth) {
+            auto inode = getInode(inodeId);
+
+            int fd = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            if (fd == -1)
+                throw FileSystemError("Unable to open file: " + target);
+
+            try {
+                writeFileContents(&fs, inode, inodeId, imageId, mapping, fd, buffer, target, pipelineDepth);
+
+                // set file stats
+                fchmod(fd, inode.base.mode & 07777);
+            } catch (...) {
+                close(fd);
+                throw;
+            }
+
+            if (close(fd) != 0)
+                throw IOError("close error at " + target);
+        }
+
+        /**
+         * Decompress the contents of the file pointed by <inodeId> in memory and hand them to <writer>
+         * @param inodeId
+         * @param target
+         * @param writer
+         */
+        void extractFile(sqfs_inode_id inodeId, const std::string& target, appimage::utils::AsyncFileWriter& writer) {
+            auto inode = getInode(inodeId);
+            std::vector<char> data(inode.xtra.reg.file_size);
+
+            StreambufType2 streambuf(&fs, &inode, inodeId, imageId, false, mapping);
+            if (streambuf.sgetn(data.data(), (std::streamsize) data.size()) != (std::streamsize) data.size())
+                throw IOError("Unable to read the data of " + target);
+
+            writer.write(target, inode.base.mode, std::move(data));
+        }
+
+        /**
+         * Create <target> from the copy of the file pointed by <inodeId> kept in <store>, the file is decompressed
+         * into the store first when it's not there
+         * @param inodeId
+         * @param target
+         * @param store
+         * @param sourceId id of the image file in <store>
+         */
+        void storeFile(sqfs_inode_id inodeId, const std::string& target, appimage::utils::ContentStore& store,
+                       const std::string& sourceId) {
+            auto inode = getInode(inodeId);
+            if (store.linkStored(sourceId, inodeId, inode.xtra.reg.file_size, target))
+                return;
+
+            StreambufType2 streambuf(&fs, &inode, inodeId, imageId, false, mapping);
+            store.store(sourceId, inodeId, inode.xtra.reg.file_size, inode.base.mode, streambuf, target);
+        }
+
+        struct sqfs fs = {};
+        BlockCache::ImageId imageId;
+        std::shared_ptr<appimage::utils::MappedFile> mapping;
+    };
+
+    /**
+     * Regular file waiting to be extracted
+     */
+    struct FileJob {
+        sqfs_inode_id inodeId;
+        uint64_t size;
+        std::string target;
+    };
+
+    /**
+     * Regular file sharing its inode with a file already scheduled for extraction
+     */
+    struct HardLinkJob {
+        std::string source;
+        std::string target;
+    };
+
+    void createSymlink(const std::string& linkTarget, const std::string& target) {
+        int ret = unlink(target.c_str());
+        if (ret != 0 && errno != ENOENT)
+            throw IOError("unlink error at " + target);
+
+        ret = symlink(linkTarget.c_str(), target.c_str());
+        if (ret != 0)
+            throw IOError("symlink error at " + target);
+    }
+
+    void createDir(const std::string& target) {
+        if (mkdir(target.c_str(), 0755) == -1 && errno != EEXIST)
+            throw FileSystemError("mkdir error at " + target);
+    }
+}
+
+ExtractorType2::ExtractorType2(const std::string& path, off_t offset,
+                               std::shared_ptr<appimage::utils::MappedFile> mapping)
+    : path(path), offset(offset), mapping(std::move(mapping)) {}
+
+void ExtractorType2::extractAll(const std::string& targetDir, const ExtractOptions& options) {
+    std::filesystem::create_directories(targetDir);
+
+    SquashfsImage image(path, offset, mapping);
+
+    // the data blocks are consumed mostly in order, let the kernel read ahead aggressively
+    if (mapping)
+        mapping->advise(utils::MappedFile::Access::SEQUENTIAL, offset);
+
+    std::vector<FileJob> jobs;
+    std::vector<HardLinkJob> hardLinkJobs;
+
+    // first target of the inodes having more than one link
+    std::map<sqfs_inode_id, std::string> linkedInodes;
+
+    // Walk the metadata once, the traversal follows a DFS pattern so parent directories are always
+    // created before their contents.
+    sqfs_traverse trv = {};
+    if (sqfs_traverse_open(&trv, &image.fs, sqfs_inode_root(&image.fs)) != SQFS_OK)
+        throw IOError("sqfs_traverse_open error");
+
+    try {
+        sqfs_err err = SQFS_OK;
+        while (sqfs_traverse_next(&trv, &err)) {
+            // directories are visited a second time when they are left
+            if (trv.dir_end)
+                continue;
+
+            const std::string target = targetDir + "/" + trv.path;
+            switch (trv.entry.type) {
+                case SQUASHFS_DIR_TYPE:
+                case SQUASHFS_LDIR_TYPE:
+                    createDir(target);
+                    break;
+
+                case SQUASHFS_REG_TYPE:
+                case SQUASHFS_LREG_TYPE: {
+                    auto inode = image.getInode(trv.entry.inode);
+
+                    // hard links share the inode, its contents are written only once
+                    if (inode.nlink > 1) {
+                        auto inserted = linkedInodes.emplace(trv.entry.inode, target);
+                        if (!inserted.second) {
+                            hardLinkJobs.push_back({inserted.first->second, target});
+                            break;
+                        }
+                    }
+
+                    jobs.push_back({trv.entry.inode, inode.xtra.reg.file_size, target});
+                    break;
+                }
+
+                case SQUASHFS_SYMLINK_TYPE:
+                case SQUASHFS_LSYMLINK_TYPE: {
+                    auto inode = image.getInode(trv.entry.inode);
+                    createSymlink(image.readLink(inode), target);
+                    break;
+                }
+
+                default:
+                    // devices, fifos and sockets are not part of the extraction
+                    break;
+            }
+        }
+
+        if (err != SQFS_OK)
+            throw IOError("sqfs_traverse_next error");
+    } catch (...) {
+        sqfs_traverse_close(&trv);
+        throw;
+    }
+    sqfs_traverse_close(&trv);
+
+    if (options.order == ExtractOrder::LARGEST_FIRST)
+        std::stable_sort(jobs.begin(), jobs.end(),
+                         [](const FileJob& a, const FileJob& b) { return a.size > b.size; });
+
+    utils::WorkerPool pool(options.threads);
+
+    // the store writes the files itself, they aren't handed to the background writer
+    std::unique_ptr<utils::ContentStore> store;
+    std::string sourceId;
+    if (!options.contentStorePath.empty()) {
+        const auto linkMode = options.contentStoreReflinks ? utils::ContentStore::LinkMode::REFLINK
+                                                           : utils::ContentStore::LinkMode::HARD_LINK;
+        store.reset(new utils::ContentStore(options.contentStorePath, linkMode));
+        sourceId = utils::ContentStore::sourceId(image.fs.fd);
+    }
+
+    std::unique_ptr<utils::AsyncFileWriter> writer;
+    if (options.asyncWrites && !store)
+        writer.reset(new utils::AsyncFileWriter());
+
+    // worker 0 is the calling thread, it can reuse the image opened for the traversal
+    std::vector<std::unique_ptr<SquashfsImage>> workerImages(pool.size());
+    std::vector<std::vector<char>> workerBuffers(pool.size());
+
+    pool.run(jobs.size(), [&](unsigned int worker, size_t jobId) {
+        auto& buffer = workerBuffers[worker];
+
+        SquashfsImage* workerImage = &image;
+        if (worker != 0) {
+            if (!workerImages[worker])
+                workerImages[worker].reset(new SquashfsImage(path, offset, mapping));
+
+            workerImage = workerImages[worker].get();
+        }
+
+        const auto& job = jobs[jobId];
+        if (store)
+            workerImage->storeFile(job.inodeId, job.target, *store, sourceId);
+        else if (writer && job.size <= ASYNC_WRITE_MAX_SIZE)
+            workerImage->extractFile(job.inodeId, job.target, *writer);
+        else
+            workerImage->extractFile(job.inodeId, job.target, buffer, options.pipelineDepth);
+    });
+
+    // the link sources exist once all the files are written
+    if (writer)
+        writer->finish();
+
+    for (const auto& job : hardLinkJobs)
+        createHardLink(job.source, job.target);
+
+    if (store)
+        store->save();
+
+    if (mapping)
+        mapping->advise(utils::MappedFile::Access::NORMAL, offset);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// system
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+// local
+#include <appimage/core/ExtractOptions.h>
+#include "utils/MappedFile.h"
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Extracts the whole payload of type 2 AppImages. It's based on squashfuse.
+             *
+             * The metadata is walked once on the calling thread, directories and symlinks are created right
+             * away and the regular files are collected into a jobs list. Then the files are written by a
+             * WorkerPool, each worker owns a squashfs context so blocks can be decompressed in parallel.
+             *
+             * Sparse blocks are left as holes in the extracted files. Files sharing an inode are written once,
+             * the others are created as hard links to it at the end.
+             *
+             * With ExtractOptions::asyncWrites the small files are decompressed in memory and handed to an
+             * AsyncFileWriter, so the workers don't wait on the target file system.
+             */
+            class ExtractorType2 {
+            public:
+                /**
+                 * @param path AppImage file path
+                 * @param offset payload offset
+                 * @param mapping optional mapping of the whole file, used to read the data blocks
+                 */
+                ExtractorType2(const std::string& path, off_t offset,
+                               std::shared_ptr<utils::MappedFile> mapping = nullptr);
+
+                /**
+                 * Extract the whole payload into <targetDir>, which is created if it doesn't exist.
+                 * @param targetDir
+                 * @param options
+                 * @throw IOError, FileSystemError if something goes wrong
+                 */
+                void extractAll(const std::string& targetDir, const ExtractOptions& options);
+
+            private:
+                std::string path;
+                off_t offset;
+                std::shared_ptr<utils::MappedFile> mapping;
+            };
+        }
+    }
+}
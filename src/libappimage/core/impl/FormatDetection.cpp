@@ -0,0 +1,30 @@
+// system
+#include <iostream>
+
+// local
+#include "FormatDetection.h"
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            AppImageFormat detectFormat(const utils::MagicBytesChecker& magicBytesChecker, const std::string& path) {
+                if (!magicBytesChecker.hasElfSignature())
+                    return AppImageFormat::INVALID;
+
+                if (magicBytesChecker.hasAppImageType1Signature())
+                    return AppImageFormat::TYPE_1;
+
+                if (magicBytesChecker.hasAppImageType2Signature())
+                    return AppImageFormat::TYPE_2;
+
+                if (magicBytesChecker.hasIso9660Signature()) {
+                    std::cerr << "WARNING: " << path << " seems to be a Type 1 AppImage without magic bytes."
+                              << std::endl;
+                    return AppImageFormat::TYPE_1;
+                }
+
+                return AppImageFormat::INVALID;
+            }
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// system
+#include <string>
+
+// local
+#include <appimage/core/AppImageFormat.h>
+#include "utils/MagicBytesChecker.h"
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Guess the AppImage format from the signatures found by <magicBytesChecker>
+             * @param magicBytesChecker
+             * @param path file path, only used in diagnostic messages
+             * @return AppImage format, INVALID if the signatures don't match any known format
+             */
+            AppImageFormat detectFormat(const utils::MagicBytesChecker& magicBytesChecker, const std::string& path);
+        }
+    }
+}
@@ -0,0 +1,604 @@
+// system
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <map>
+#include <set>
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+}
+
+// local
+#include "appimage/core/exceptions.h"
+#include "Iso9660Index.h"
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+namespace {
+    constexpr uint64_t SECTOR_SIZE = 2048;
+
+    // volume descriptors start after the system area, where type 1 AppImages keep their runtime
+    constexpr uint64_t VOLUME_DESCRIPTORS_OFFSET = 16 * SECTOR_SIZE;
+
+    // stop looking for the primary volume descriptor after this many descriptors
+    constexpr unsigned int MAX_VOLUME_DESCRIPTORS = 64;
+
+    constexpr uint8_t VD_TYPE_PRIMARY = 1;
+    constexpr uint8_t VD_TYPE_TERMINATOR = 255;
+    constexpr size_t PVD_BLOCK_SIZE_OFFSET = 128;
+    constexpr size_t PVD_ROOT_RECORD_OFFSET = 156;
+
+    // directory record layout
+    constexpr size_t DR_MIN_SIZE = 34;
+    constexpr size_t DR_EXT_ATTR_LENGTH = 1;
+    constexpr size_t DR_LOCATION = 2;
+    constexpr size_t DR_DATA_LENGTH = 10;
+    constexpr size_t DR_RECORDING_DATE = 18;
+    constexpr size_t DR_FLAGS = 25;
+    constexpr size_t DR_NAME_LENGTH = 32;
+    constexpr size_t DR_NAME = 33;
+
+    constexpr uint8_t DR_FLAG_DIRECTORY = 0x02;
+    constexpr uint8_t DR_FLAG_MULTI_EXTENT = 0x80;
+
+    // deeper directories are considered malformed, libarchive uses the same limit
+    constexpr unsigned int MAX_DEPTH = 1000;
+
+    // continuation areas followed per directory record
+    constexpr unsigned int MAX_CONTINUATIONS = 16;
+
+    uint16_t readLE16(const uint8_t* data) {
+        return (uint16_t) (data[0] | (data[1] << 8));
+    }
+
+    uint32_t readLE32(const uint8_t* data) {
+        return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) |
+               ((uint32_t) data[3] << 24);
+    }
+
+    /**
+     * Decode the 7 bytes dates of the directory records and the short Rock Ridge timestamps
+     */
+    timespec readShortDate(const uint8_t* data) {
+        struct tm time = {};
+        time.tm_year = data[0];
+        time.tm_mon = data[1] - 1;
+        time.tm_mday = data[2];
+        time.tm_hour = data[3];
+        time.tm_min = data[4];
+        time.tm_sec = data[5];
+
+        // the offset from GMT is given in 15 minutes intervals
+        const auto gmtOffset = (int8_t) data[6];
+        return {timegm(&time) - gmtOffset * 15 * 60, 0};
+    }
+
+    /**
+     * Decode the 17 bytes dates made of ASCII digits, used by Rock Ridge timestamps in long form
+     */
+    timespec readLongDate(const uint8_t* data) {
+        auto number = [data](size_t offset, size_t length) {
+            int value = 0;
+            for (size_t i = offset; i < offset + length; ++i)
+                value = value * 10 + (data[i] >= '0' && data[i] <= '9' ? data[i] - '0' : 0);
+            return value;
+        };
+
+        struct tm time = {};
+        time.tm_year = number(0, 4) - 1900;
+        time.tm_mon = number(4, 2) - 1;
+        time.tm_mday = number(6, 2);
+        time.tm_hour = number(8, 2);
+        time.tm_min = number(10, 2);
+        time.tm_sec = number(12, 2);
+
+        const auto gmtOffset = (int8_t) data[16];
+        return {timegm(&time) - gmtOffset * 15 * 60, number(14, 2) * 10000000L};
+    }
+
+    /**
+     * Remove the version suffix and the trailing dot of plain ISO 9660 file identifiers
+     */
+    std::string readIsoName(const uint8_t* data, size_t size) {
+        std::string name(reinterpret_cast<const char*>(data), size);
+
+        auto separator = name.rfind(';');
+        if (separator != std::string::npos)
+            name.erase(separator);
+
+        if (!name.empty() && name.back() == '.')
+            name.pop_back();
+
+        return name;
+    }
+
+    /**
+     * Rock Ridge attributes of a directory record
+     */
+    struct RockRidgeEntry {
+        bool hasAttributes = false;
+        mode_t mode = 0;
+        uint32_t nlink = 1;
+        uint32_t uid = 0;
+        uint32_t gid = 0;
+        bool hasSerial = false;
+        uint32_t serial = 0;
+
+        bool hasName = false;
+        std::string name;
+
+        bool hasSymlink = false;
+        std::string symlink;
+
+        // the last symlink component continues in the next SL entry
+        bool symlinkContinues = false;
+
+        bool hasMtime = false;
+        timespec mtime = {};
+
+        // the entry is a directory moved to the "rr_moved" directory, reported at its original place
+        bool relocated = false;
+
+        // location of the relocated directory this entry stands for
+        bool hasChildLink = false;
+        uint32_t childLink = 0;
+
+        // the contents are compressed with zisofs, the size of the uncompressed contents
+        bool zisofs = false;
+        uint32_t zisofsSize = 0;
+    };
+
+    void appendSymlinkComponents(const uint8_t* data, size_t size, RockRidgeEntry& entry) {
+        size_t position = 0;
+        while (position + 2 <= size) {
+            const uint8_t flags = data[position];
+            const uint8_t length = data[position + 1];
+            if (position + 2 + length > size)
+                break;
+
+            std::string component;
+            if (flags & 0x02)
+                component = ".";
+            else if (flags & 0x04)
+                component = "..";
+            else if (!(flags & 0x08))
+                component.assign(reinterpret_cast<const char*>(data + position + 2), length);
+
+            // components are separated by a "/" unless the previous one continues in this one
+            if (entry.hasSymlink && !entry.symlinkContinues &&
+                (entry.symlink.empty() || entry.symlink.back() != '/'))
+                entry.symlink += '/';
+
+            if (flags & 0x08)
+                entry.symlink = "/";
+            else
+                entry.symlink += component;
+
+            entry.hasSymlink = true;
+            entry.symlinkContinues = (flags & 0x01) != 0;
+            position += 2 + length;
+        }
+    }
+
+    void parseTimestamps(const uint8_t* data, size_t size, RockRidgeEntry& entry) {
+        if (size < 5)
+            return;
+
+        const uint8_t flags = data[4];
+        const size_t timestampSize = (flags & 0x80) ? 17 : 7;
+
+        // creation, modification, access, attributes, backup, expiration and effective times follow in order
+        size_t position = 5;
+        for (uint8_t bit = 0x01; bit < 0x80; bit <<= 1) {
+            if (!(flags & bit))
+                continue;
+
+            if (position + timestampSize > size)
+                return;
+
+            if (bit == 0x02) {
+                entry.mtime = timestampSize == 17 ? readLongDate(data + position) : readShortDate(data + position);
+                entry.hasMtime = true;
+            }
+
+            position += timestampSize;
+        }
+    }
+}
+
+class Iso9660Index::Private {
+public:
+    explicit Private(const std::string& path) {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            throw IOError("Unable to open file: " + path);
+
+        try {
+            parse();
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+    }
+
+    ~Private() {
+        close(fd);
+    }
+
+    size_t readAt(uint64_t offset, char* buffer, size_t size) const {
+        while (true) {
+            auto bytesRead = pread(fd, buffer, size, (off_t) offset);
+            if (bytesRead >= 0)
+                return (size_t) bytesRead;
+
+            if (errno != EINTR)
+                throw IOError("ISO 9660 image read error");
+        }
+    }
+
+    std::vector<Node> nodes;
+    std::unordered_map<std::string, PayloadEntryId> pathIds;
+    int fd = -1;
+
+private:
+    uint64_t blockSize = SECTOR_SIZE;
+
+    // bytes to skip at the beginning of every System Use area
+    size_t suspSkip = 0;
+
+    // locations of the directories already parsed, protects against loops made with relocations
+    std::set<uint32_t> parsedDirectories;
+
+    std::vector<uint8_t> readExactly(uint64_t offset, size_t size) const {
+        std::vector<uint8_t> data(size);
+
+        size_t position = 0;
+        while (position < size) {
+            auto bytesRead = readAt(offset + position, reinterpret_cast<char*>(data.data()) + position,
+                                    size - position);
+            if (bytesRead == 0)
+                throw IOError("Truncated ISO 9660 image");
+
+            position += bytesRead;
+        }
+
+        return data;
+    }
+
+    void parse() {
+        std::vector<uint8_t> rootRecord;
+
+        for (unsigned int i = 0; i < MAX_VOLUME_DESCRIPTORS && rootRecord.empty(); ++i) {
+            const auto descriptor = readExactly(VOLUME_DESCRIPTORS_OFFSET + i * SECTOR_SIZE, SECTOR_SIZE);
+            if (std::string(reinterpret_cast<const char*>(descriptor.data() + 1), 5) != "CD001")
+                throw IOError("Not an ISO 9660 image");
+
+            if (descriptor[0] == VD_TYPE_TERMINATOR)
+                break;
+
+            if (descriptor[0] == VD_TYPE_PRIMARY) {
+                blockSize = readLE16(descriptor.data() + PVD_BLOCK_SIZE_OFFSET);
+                rootRecord.assign(descriptor.begin() + PVD_ROOT_RECORD_OFFSET,
+                                  descriptor.begin() + PVD_ROOT_RECORD_OFFSET + DR_MIN_SIZE);
+            }
+        }
+
+        if (rootRecord.empty())
+            throw IOError("Missing ISO 9660 primary volume descriptor");
+
+        if (blockSize == 0 || blockSize > SECTOR_SIZE)
+            throw IOError("Invalid ISO 9660 logical block size");
+
+        Node root;
+        root.type = PayloadEntryType::DIR;
+        root.stat.mode = S_IFDIR | 0755;
+        root.stat.nlink = 2;
+        root.stat.mtime = readShortDate(rootRecord.data() + DR_RECORDING_DATE);
+        nodes.emplace_back(std::move(root));
+        pathIds.emplace("", 0);
+
+        const auto rootLocation = readLE32(rootRecord.data() + DR_LOCATION);
+        const auto rootSize = readLE32(rootRecord.data() + DR_DATA_LENGTH);
+
+        detectSusp(rootLocation);
+        parseDirectory(0, rootLocation, rootSize, 0);
+        resolveHardLinks();
+    }
+
+    /**
+     * Look for the SP entry in the System Use area of the root "." record. Without it there are no Rock Ridge
+     * names, libarchive would then read the Joliet ones and the entries wouldn't match.
+     * @throw IOError if it's missing
+     */
+    void detectSusp(uint32_t rootLocation) {
+        const auto sector = readExactly(rootLocation * blockSize, blockSize);
+        const size_t recordSize = sector[0];
+        if (recordSize < DR_MIN_SIZE || recordSize > sector.size())
+            throw IOError("Invalid ISO 9660 root directory");
+
+        // the name of the "." record is a single byte, so there is no padding byte
+        const size_t systemUse = DR_NAME + 1;
+        if (recordSize >= systemUse + 7 && sector[systemUse] == 'S' && sector[systemUse + 1] == 'P' &&
+            sector[systemUse + 4] == 0xBE && sector[systemUse + 5] == 0xEF) {
+            suspSkip = sector[systemUse + 6];
+            return;
+        }
+
+        throw IOError("ISO 9660 image without Rock Ridge extensions");
+    }
+
+    void parseSystemUse(const uint8_t* data, size_t size, RockRidgeEntry& entry) const {
+        std::vector<uint8_t> continuation;
+
+        for (unsigned int continuations = 0; ; ++continuations) {
+            uint32_t nextBlock = 0, nextOffset = 0, nextSize = 0;
+
+            while (size >= 4) {
+                const uint8_t length = data[2];
+                if (length < 4 || length > size)
+                    break;
+
+                const std::string signature(reinterpret_cast<const char*>(data), 2);
+                if (signature == "ST") {
+                    break;
+                } else if (signature == "CE" && length >= 28) {
+                    nextBlock = readLE32(data + 4);
+                    nextOffset = readLE32(data + 12);
+                    nextSize = readLE32(data + 20);
+                } else if (signature == "PX" && length >= 36) {
+                    entry.hasAttributes = true;
+                    entry.mode = readLE32(data + 4);
+                    entry.nlink = readLE32(data + 12);
+                    entry.uid = readLE32(data + 20);
+                    entry.gid = readLE32(data + 28);
+                    if (length >= 44) {
+                        entry.hasSerial = true;
+                        entry.serial = readLE32(data + 36);
+                    }
+                } else if (signature == "NM" && length >= 5) {
+                    // the current and parent directory flags are only used by "." and "..", which are skipped
+                    entry.hasName = true;
+                    entry.name.append(reinterpret_cast<const char*>(data + 5), length - 5);
+                } else if (signature == "SL" && length >= 5) {
+                    appendSymlinkComponents(data + 5, length - 5, entry);
+                } else if (signature == "TF") {
+                    parseTimestamps(data, length, entry);
+                } else if (signature == "RE") {
+                    entry.relocated = true;
+                } else if (signature == "CL" && length >= 12) {
+                    entry.hasChildLink = true;
+                    entry.childLink = readLE32(data + 4);
+                } else if (signature == "ZF" && length >= 16) {
+                    if (data[4] != 'p' || data[5] != 'z')
+                        throw IOError("Unsupported ISO 9660 compression algorithm");
+
+                    entry.zisofs = true;
+                    entry.zisofsSize = readLE32(data + 8);
+                }
+
+                data += length;
+                size -= length;
+            }
+
+            if (nextSize == 0 || continuations >= MAX_CONTINUATIONS || nextSize > blockSize ||
+                nextOffset >= blockSize)
+                return;
+
+            continuation = readExactly(nextBlock * blockSize + nextOffset, nextSize);
+            data = continuation.data();
+            size = continuation.size();
+        }
+    }
+
+    /**
+     * @return size of the directory at <location>, read from its "." record
+     */
+    uint32_t readDirectorySize(uint32_t location) const {
+        const auto sector = readExactly(location * blockSize, blockSize);
+        if (sector[0] < DR_MIN_SIZE)
+            throw IOError("Invalid ISO 9660 relocated directory");
+
+        return readLE32(sector.data() + DR_DATA_LENGTH);
+    }
+
+    void parseDirectory(PayloadEntryId dirId, uint32_t location, uint32_t size, unsigned int depth) {
+        if (depth > MAX_DEPTH)
+            throw IOError("ISO 9660 directories nested too deeply");
+
+        if (!parsedDirectories.insert(location).second)
+            throw IOError("ISO 9660 directory loop");
+
+        const auto data = readExactly(location * blockSize, size);
+
+        // extents of a file spanning several records, all but the last one have the multi extent flag
+        std::vector<Extent> pendingExtents;
+
+        size_t position = 0;
+        while (position < data.size()) {
+            const size_t recordSize = data[position];
+
+            // records don't cross the blocks boundaries, the rest of the block is padding
+            if (recordSize == 0) {
+                position = (position / blockSize + 1) * blockSize;
+                continue;
+            }
+
+            if (recordSize < DR_MIN_SIZE || position + recordSize > data.size())
+                throw IOError("Invalid ISO 9660 directory record");
+
+            const uint8_t* record = data.data() + position;
+            position += recordSize;
+
+            const size_t nameLength = record[DR_NAME_LENGTH];
+            if (DR_NAME + nameLength > recordSize)
+                throw IOError("Invalid ISO 9660 directory record");
+
+            // skip "." and ".."
+            if (nameLength == 1 && (record[DR_NAME] == 0 || record[DR_NAME] == 1))
+                continue;
+
+            RockRidgeEntry rockRidge;
+            const size_t systemUse = DR_NAME + nameLength + (nameLength % 2 == 0 ? 1 : 0) + suspSkip;
+            if (systemUse < recordSize)
+                parseSystemUse(record + systemUse, recordSize - systemUse, rockRidge);
+
+            const uint8_t flags = record[DR_FLAGS];
+            const uint64_t dataOffset = ((uint64_t) readLE32(record + DR_LOCATION) + record[DR_EXT_ATTR_LENGTH]) *
+                                        blockSize;
+            const uint32_t dataSize = readLE32(record + DR_DATA_LENGTH);
+
+            if (flags & DR_FLAG_MULTI_EXTENT) {
+                pendingExtents.push_back({dataOffset, dataSize});
+                continue;
+            }
+
+            std::vector<Extent> extents;
+            extents.swap(pendingExtents);
+            extents.push_back({dataOffset, dataSize});
+
+            if (rockRidge.relocated)
+                continue;
+
+            const std::string name = rockRidge.hasName ? rockRidge.name : readIsoName(record + DR_NAME, nameLength);
+            if (name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos)
+                continue;
+
+            // the relocated directories are reported at their original place
+            if (dirId == 0 && (name == "rr_moved" || name == ".rr_moved"))
+                continue;
+
+            const bool isDir = (flags & DR_FLAG_DIRECTORY) || rockRidge.hasChildLink;
+
+            Node node;
+            node.id = nodes.size();
+            node.path = dirId == 0 ? name : nodes[dirId].path + "/" + name;
+
+            if (rockRidge.hasSymlink || (rockRidge.hasAttributes && S_ISLNK(rockRidge.mode))) {
+                node.type = PayloadEntryType::LINK;
+                node.linkTarget = rockRidge.symlink;
+            } else if (isDir) {
+                node.type = PayloadEntryType::DIR;
+            } else if (!rockRidge.hasAttributes || S_ISREG(rockRidge.mode)) {
+                node.type = PayloadEntryType::REGULAR;
+                node.extents = std::move(extents);
+                node.zisofs = rockRidge.zisofs;
+            }
+
+            fillStat(node, rockRidge, record);
+
+            const auto id = node.id;
+            pathIds.emplace(node.path, id);
+            nodes.emplace_back(std::move(node));
+            nodes[dirId].children.push_back(id);
+
+            if (nodes[id].type == PayloadEntryType::DIR) {
+                const auto dirLocation = rockRidge.hasChildLink ? rockRidge.childLink : readLE32(record + DR_LOCATION);
+                const auto dirSize = rockRidge.hasChildLink ? readDirectorySize(dirLocation) : dataSize;
+                parseDirectory(id, dirLocation, dirSize, depth + 1);
+            }
+        }
+    }
+
+    void fillStat(Node& node, const RockRidgeEntry& rockRidge, const uint8_t* record) const {
+        auto& stat = node.stat;
+
+        if (rockRidge.hasAttributes) {
+            stat.mode = rockRidge.mode;
+            stat.nlink = rockRidge.nlink;
+            stat.uid = rockRidge.uid;
+            stat.gid = rockRidge.gid;
+        } else {
+            switch (node.type) {
+                case PayloadEntryType::DIR:
+                    stat.mode = S_IFDIR | 0755;
+                    stat.nlink = 2;
+                    break;
+                case PayloadEntryType::LINK:
+                    stat.mode = S_IFLNK | 0777;
+                    stat.nlink = 1;
+                    break;
+                default:
+                    stat.mode = S_IFREG | 0644;
+                    stat.nlink = 1;
+            }
+        }
+
+        stat.mtime = rockRidge.hasMtime ? rockRidge.mtime : readShortDate(record + DR_RECORDING_DATE);
+        stat.inode = rockRidge.hasSerial ? rockRidge.serial : readLE32(record + DR_LOCATION);
+
+        for (const auto& extent : node.extents)
+            stat.size += extent.size;
+
+        if (node.zisofs)
+            stat.size = rockRidge.zisofsSize;
+
+        stat.blocks = (stat.size + 511) / 512;
+    }
+
+    /**
+     * Report the regular files sharing their contents with a previous one as links to it
+     */
+    void resolveHardLinks() {
+        std::map<std::string, PayloadEntryId> sortedPaths;
+        for (const auto& node : nodes)
+            if (node.type == PayloadEntryType::REGULAR && node.stat.size > 0)
+                sortedPaths.emplace(node.path, node.id);
+
+        std::map<uint64_t, PayloadEntryId> owners;
+        for (const auto& item : sortedPaths) {
+            auto& node = nodes[item.second];
+
+            auto inserted = owners.emplace(node.extents.front().offset, node.id);
+            if (inserted.second)
+                continue;
+
+            node.type = PayloadEntryType::LINK;
+            node.linkTarget = nodes[inserted.first->second].path;
+            node.extents.clear();
+            node.zisofs = false;
+            node.stat.size = 0;
+        }
+    }
+};
+
+Iso9660Index::Iso9660Index(const std::string& path) : d(new Private(path)) {}
+
+Iso9660Index::~Iso9660Index() = default;
+
+const Iso9660Index::Node* Iso9660Index::find(const std::string& path) const {
+    std::string::size_type begin = 0;
+    while (begin < path.size() && (path[begin] == '/' || path.compare(begin, 2, "./") == 0))
+        begin += path[begin] == '/' ? 1 : 2;
+
+    auto end = path.size();
+    while (end > begin && path[end - 1] == '/')
+        --end;
+
+    auto itr = d->pathIds.find(path.substr(begin, end - begin));
+    if (itr == d->pathIds.end())
+        return nullptr;
+
+    return &d->nodes[itr->second];
+}
+
+const Iso9660Index::Node* Iso9660Index::get(PayloadEntryId id) const {
+    if (id >= d->nodes.size())
+        return nullptr;
+
+    return &d->nodes[id];
+}
+
+size_t Iso9660Index::size() const {
+    return d->nodes.size();
+}
+
+size_t Iso9660Index::readAt(uint64_t offset, char* buffer, size_t size) const {
+    return d->readAt(offset, buffer, size);
+}
+
+int Iso9660Index::getFd() const {
+    return d->fd;
+}
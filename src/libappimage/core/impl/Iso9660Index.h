@@ -0,0 +1,121 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// local
+#include <appimage/core/EntryStat.h>
+#include <appimage/core/PayloadEntry.h>
+#include <appimage/core/PayloadEntryType.h>
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * In memory index of the ISO 9660 file system of type 1 AppImages.
+             *
+             * The primary volume descriptor and the directory records are parsed once, including the Rock
+             * Ridge extensions (names, permissions, symlinks, timestamps, relocated directories and zisofs
+             * compressed files). Then paths can be resolved and directories listed without touching the image
+             * again and the files contents are read directly from their extents.
+             *
+             * Only images with Rock Ridge extensions are supported. libarchive reads the Joliet names of the
+             * others, so their entries must be read by means of it.
+             *
+             * Regular files sharing their extent with a previous one (in path order) are reported as links to
+             * it, as libarchive does with hard links.
+             *
+             * Entries are numbered in depth first order, the root directory is entry 0. Their ids remain the
+             * same as long as the image isn't modified.
+             */
+            class Iso9660Index {
+            public:
+                /**
+                 * Contiguous region of the image holding part of a file contents
+                 */
+                struct Extent {
+                    // absolute position in the image file
+                    uint64_t offset;
+                    uint64_t size;
+                };
+
+                struct Node {
+                    PayloadEntryId id = 0;
+
+                    // path relative to the image root, empty for the root directory
+                    std::string path;
+
+                    PayloadEntryType type = PayloadEntryType::UNKNOWN;
+                    EntryStat stat;
+                    std::string linkTarget;
+
+                    // REGULAR entries contents, files bigger than 4 GiB span several extents
+                    std::vector<Extent> extents;
+
+                    // the extents hold the contents compressed with zisofs instead of the contents themselves
+                    bool zisofs = false;
+
+                    // ids of the entries contained directly in a DIR entry
+                    std::vector<PayloadEntryId> children;
+                };
+
+                /**
+                 * Parse the image at <path>
+                 * @param path
+                 * @throw IOError if the file can't be read, it's not a valid ISO 9660 image or it has no Rock Ridge
+                 * extensions
+                 */
+                explicit Iso9660Index(const std::string& path);
+
+                // Creating copies of this object is not allowed
+                Iso9660Index(Iso9660Index& other) = delete;
+
+                // Creating copies of this object is not allowed
+                Iso9660Index& operator=(Iso9660Index& other) = delete;
+
+                ~Iso9660Index();
+
+                /**
+                 * @param path entry path, leading "/" and "./" are ignored
+                 * @return the entry at <path>, nullptr if there is none
+                 */
+                const Node* find(const std::string& path) const;
+
+                /**
+                 * @param id
+                 * @return the entry with the given <id>, nullptr if there is none
+                 */
+                const Node* get(PayloadEntryId id) const;
+
+                /**
+                 * @return number of entries, including the root directory
+                 */
+                size_t size() const;
+
+                /**
+                 * Read up to <size> bytes at <offset> of the image file
+                 * @param offset
+                 * @param buffer
+                 * @param size
+                 * @return number of bytes read, 0 at the end of the file
+                 * @throw IOError on read errors
+                 */
+                size_t readAt(uint64_t offset, char* buffer, size_t size) const;
+
+                /**
+                 * @return descriptor of the image file, owned by the index. Extents can be copied from it with
+                 * copy_file_range(2).
+                 */
+                int getFd() const;
+
+            private:
+                class Private;
+                std::unique_ptr<Private> d;
+            };
+        }
+    }
+}
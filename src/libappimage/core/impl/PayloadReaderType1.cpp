@@ -0,0 +1,262 @@
+// system
+#include <cstring>
+#include <sstream>
+
+// library
+#include <archive.h>
+#include <archive_entry.h>
+
+// local
+#include "appimage/core/exceptions.h"
+#include "utils/path_utils.h"
+#include "PayloadReaderType1.h"
+#include "StatConversion.h"
+#include "StreambufIso9660.h"
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+namespace {
+    /**
+     * Remove the "./" prefix from entries names, as TraversalType1 does
+     */
+    std::string normalizeEntryName(const char* name) {
+        if (name == nullptr)
+            return std::string();
+
+        if (strncmp("./", name, 2) == 0)
+            return name + 2;
+
+        return name;
+    }
+
+    /**
+     * Remove the "/" and "./" prefixes from the given path to make it comparable with entries names
+     */
+    std::string normalizePath(const std::string& path) {
+        std::string::size_type begin = 0;
+        while (begin < path.size() &&
+               (path[begin] == '/' || path.compare(begin, 2, "./") == 0))
+            begin += path[begin] == '/' ? 1 : 2;
+
+        return path.substr(begin);
+    }
+
+    void fillEntry(archive_entry* archiveEntry, PayloadEntryId id, const std::string& path,
+                   PayloadReader::Entry& entry) {
+        entry.id = id;
+        entry.path = path;
+
+        // Hard links are reported by libarchive as regular files, this a workaround
+        const char* link = archive_entry_symlink(archiveEntry);
+        if (link == nullptr)
+            link = archive_entry_hardlink(archiveEntry);
+
+        if (link != nullptr) {
+            entry.type = PayloadEntryType::LINK;
+            entry.linkTarget = link + 2;
+        } else {
+            switch (archive_entry_filetype(archiveEntry)) {
+                case AE_IFREG:
+                    entry.type = PayloadEntryType::REGULAR;
+                    break;
+                case AE_IFDIR:
+                    entry.type = PayloadEntryType::DIR;
+                    break;
+                default:
+                    entry.type = PayloadEntryType::UNKNOWN;
+            }
+        }
+
+        entry.stat = toEntryStat(*archive_entry_stat(archiveEntry), entry.type);
+    }
+
+    void fillEntry(const Iso9660Index::Node& node, PayloadReader::Entry& entry) {
+        entry.id = node.id;
+        entry.path = node.path;
+        entry.type = node.type;
+        entry.linkTarget = node.linkTarget;
+        entry.stat = node.stat;
+    }
+}
+
+PayloadReaderType1::PayloadReaderType1(const std::string& path) : path(path) {
+    try {
+        index = std::make_shared<Iso9660Index>(path);
+    } catch (const IOError&) {
+        // images without Rock Ridge extensions or unusual ones are still readable by libarchive
+    }
+}
+
+bool PayloadReaderType1::lookup(const std::string& path, PayloadReader::Entry& entry) {
+    if (index) {
+        const auto node = index->find(path);
+        if (node == nullptr)
+            return false;
+
+        fillEntry(*node, entry);
+        return true;
+    }
+
+    const auto entryPath = normalizePath(path);
+
+    return seek([&entryPath](PayloadEntryId, const std::string& name) { return name == entryPath; },
+                [&entry](archive*, archive_entry* archiveEntry, PayloadEntryId id, const std::string& name) {
+                    fillEntry(archiveEntry, id, name, entry);
+                });
+}
+
+PayloadReader::Entry PayloadReaderType1::open(PayloadEntryId id) {
+    Entry entry;
+    if (index) {
+        const auto node = index->get(id);
+        if (node == nullptr)
+            throw PayloadIteratorError("Invalid entry id: " + std::to_string(id));
+
+        fillEntry(*node, entry);
+        return entry;
+    }
+
+    bool found = seek([id](PayloadEntryId entryId, const std::string&) { return entryId == id; },
+                      [&entry](archive*, archive_entry* archiveEntry, PayloadEntryId id, const std::string& name) {
+                          fillEntry(archiveEntry, id, name, entry);
+                      });
+
+    if (!found)
+        throw PayloadIteratorError("Invalid entry id: " + std::to_string(id));
+
+    return entry;
+}
+
+bool PayloadReaderType1::list(const std::string& path, std::vector<PayloadReader::Entry>& entries) {
+    if (index) {
+        const auto node = index->find(path);
+        if (node == nullptr)
+            return false;
+
+        if (node->type != PayloadEntryType::DIR)
+            throw PayloadIteratorError("Not a directory: " + path);
+
+        entries.clear();
+        for (const auto childId : node->children) {
+            Entry entry;
+            fillEntry(*index->get(childId), entry);
+            entries.emplace_back(std::move(entry));
+        }
+
+        return true;
+    }
+
+    const auto prefix = appimage::utils::toDirPrefix(path);
+    const auto dirPath = prefix.empty() ? std::string() : prefix.substr(0, prefix.size() - 1);
+
+    // the payload root is not always part of the archive
+    bool found = prefix.empty();
+    bool isDir = true;
+
+    entries.clear();
+    scan([&](archive*, archive_entry* archiveEntry, PayloadEntryId id, const std::string& name) {
+        if (name == dirPath) {
+            found = true;
+            isDir = archive_entry_filetype(archiveEntry) == AE_IFDIR;
+        } else if (name.size() > prefix.size() && name.compare(0, prefix.size(), prefix) == 0 &&
+                   name.find('/', prefix.size()) == std::string::npos) {
+            // the entries are not sorted, children may appear before their parent
+            found = true;
+
+            Entry entry;
+            fillEntry(archiveEntry, id, name, entry);
+            entries.emplace_back(std::move(entry));
+        }
+
+        return true;
+    });
+
+    if (found && !isDir)
+        throw PayloadIteratorError("Not a directory: " + path);
+
+    return found;
+}
+
+std::unique_ptr<std::streambuf> PayloadReaderType1::read(const PayloadReader::Entry& entry) {
+    if (entry.type != PayloadEntryType::REGULAR)
+        throw PayloadIteratorError("Not a regular file: " + entry.path);
+
+    if (index) {
+        const auto node = index->get(entry.id);
+        if (node == nullptr || node->type != PayloadEntryType::REGULAR)
+            throw PayloadIteratorError("Invalid entry id: " + std::to_string(entry.id));
+
+        return std::unique_ptr<std::streambuf>(new StreambufIso9660(index, *node));
+    }
+
+    // libarchive can't keep more than one entry open, the contents are loaded into memory
+    std::unique_ptr<std::stringbuf> buffer(new std::stringbuf(std::ios_base::in | std::ios_base::out));
+
+    bool found = seek([&entry](PayloadEntryId id, const std::string&) { return id == entry.id; },
+                      [&buffer](archive* a, archive_entry*, PayloadEntryId, const std::string&) {
+                          char chunk[10240];
+                          la_ssize_t bytesRead;
+                          while ((bytesRead = archive_read_data(a, chunk, sizeof(chunk))) > 0)
+                              buffer->sputn(chunk, bytesRead);
+
+                          if (bytesRead < 0)
+                              throw IOError(archive_error_string(a));
+                      });
+
+    if (!found)
+        throw PayloadIteratorError("Invalid entry id: " + std::to_string(entry.id));
+
+    return buffer;
+}
+
+bool PayloadReaderType1::seek(const std::function<bool(PayloadEntryId, const std::string&)>& predicate,
+                              const std::function<void(archive*, archive_entry*, PayloadEntryId,
+                                                       const std::string&)>& action) {
+    return scan([&](archive* a, archive_entry* archiveEntry, PayloadEntryId id, const std::string& name) {
+        if (!predicate(id, name))
+            return true;
+
+        action(a, archiveEntry, id, name);
+        return false;
+    });
+}
+
+bool PayloadReaderType1::scan(const std::function<bool(archive*, archive_entry*, PayloadEntryId,
+                                                       const std::string&)>& visitor) {
+    archive* a = archive_read_new();
+    archive_read_support_format_iso9660(a);
+
+    if (archive_read_open_filename(a, path.c_str(), 10240) != ARCHIVE_OK) {
+        std::string error = archive_error_string(a);
+        archive_read_free(a);
+        throw IOError(error);
+    }
+
+    bool interrupted = false;
+    try {
+        archive_entry* archiveEntry;
+        PayloadEntryId id = 0;
+        int r;
+        while ((r = archive_read_next_header(a, &archiveEntry)) == ARCHIVE_OK) {
+            const auto name = normalizeEntryName(archive_entry_pathname(archiveEntry));
+            if (!visitor(a, archiveEntry, id, name)) {
+                interrupted = true;
+                break;
+            }
+
+            ++id;
+        }
+
+        if (!interrupted && r != ARCHIVE_EOF)
+            throw IOError(archive_error_string(a));
+    } catch (...) {
+        archive_read_close(a);
+        archive_read_free(a);
+        throw;
+    }
+
+    archive_read_close(a);
+    archive_read_free(a);
+    return interrupted;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// system
+#include <functional>
+#include <memory>
+#include <string>
+
+// local
+#include "core/PayloadReader.h"
+#include "Iso9660Index.h"
+
+// forward declaration, libarchive is kept confined to the implementation
+struct archive;
+struct archive_entry;
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Provides random access to the payload of type 1 AppImages.
+             *
+             * The ISO 9660 directory records are loaded once into an Iso9660Index, then lookups and listings
+             * are served from memory and the files contents are read straight from their extents. The index
+             * entries ids are used as entry ids.
+             *
+             * Images that can't be indexed, i.e.: without Rock Ridge extensions, are read by means of libarchive
+             * instead. It only allows to read ISO 9660 images sequentially, therefore every operation implies
+             * reading the archive headers up to the requested entry. The position of the entry in the archive
+             * is used as entry id.
+             *
+             * See the base class for more details.
+             */
+            class PayloadReaderType1 : public PayloadReader {
+            public:
+                explicit PayloadReaderType1(const std::string& path);
+
+                bool lookup(const std::string& path, Entry& entry) override;
+
+                Entry open(PayloadEntryId id) override;
+
+                bool list(const std::string& path, std::vector<Entry>& entries) override;
+
+                std::unique_ptr<std::streambuf> read(const Entry& entry) override;
+
+            private:
+                std::string path;
+
+                // nullptr if the image can't be indexed
+                std::shared_ptr<const Iso9660Index> index;
+
+                /**
+                 * Read the archive headers until <predicate> is satisfied, then <action> is called with
+                 * the archive pointing to the matched entry.
+                 * @return true if a matching entry was found, false otherwise
+                 */
+                bool seek(const std::function<bool(PayloadEntryId, const std::string&)>& predicate,
+                          const std::function<void(archive*, archive_entry*, PayloadEntryId, const std::string&)>& action);
+
+                /**
+                 * Read the archive headers calling <visitor> on each of them until it returns false or the end
+                 * of the archive is reached.
+                 * @return true if the scan was interrupted by <visitor>, false otherwise
+                 */
+                bool scan(const std::function<bool(archive*, archive_entry*, PayloadEntryId, const std::string&)>& visitor);
+            };
+        }
+    }
+}
@@ -0,0 +1,197 @@
+/*
+ * NOTE ON SQUASHFUSE:
+ * It wasn't designed originally as a library and its headers are somehow broken.
+ * Therefore they must be kept confined.
+ *
+ * keep squashfuse includes on top to avoid _POSIX_C_SOURCE redefinition warning
+*/
+extern "C" {
+#include <squashfuse.h>
+#include <squashfs_fs.h>
+}
+
+// system
+#include <vector>
+#include <sys/stat.h>
+
+// local
+#include "appimage/core/exceptions.h"
+#include "utils/path_utils.h"
+#include "SquashfsLookup.h"
+#include "StatConversion.h"
+#include "StreambufType2.h"
+#include "PayloadReaderType2.h"
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+class PayloadReaderType2::Priv {
+public:
+    Priv(const std::string& path, off_t offset, std::shared_ptr<appimage::utils::MappedFile> mapping)
+        : path(path), mapping(std::move(mapping)) {
+        if (offset < 0)
+            throw IOError("get_elf_size error");
+
+        if (sqfs_open_image(&fs, path.c_str(), (size_t) offset) != SQFS_OK)
+            throw IOError("sqfs_open_image error: " + path);
+
+        try {
+            imageId = BlockCache::ImageId::fromFd(fs.fd);
+        } catch (...) {
+            sqfs_destroy(&fs);
+            throw;
+        }
+
+        // lookups jump around the payload, read ahead would be wasted
+        if (this->mapping)
+            this->mapping->advise(appimage::utils::MappedFile::Access::RANDOM, offset);
+    }
+
+    ~Priv() {
+        sqfs_destroy(&fs);
+    }
+
+    /**
+     * Fill <entry> with the data available at <inode>
+     * @param inode
+     * @param entry
+     */
+    void readEntry(sqfs_inode& inode, Entry& entry) {
+        entry.linkTarget.clear();
+
+        switch (inode.base.inode_type) {
+            case SQUASHFS_REG_TYPE:
+            case SQUASHFS_LREG_TYPE:
+                entry.type = PayloadEntryType::REGULAR;
+                break;
+
+            case SQUASHFS_SYMLINK_TYPE:
+            case SQUASHFS_LSYMLINK_TYPE:
+                entry.type = PayloadEntryType::LINK;
+                entry.linkTarget = readLink(inode);
+                break;
+
+            case SQUASHFS_DIR_TYPE:
+            case SQUASHFS_LDIR_TYPE:
+                entry.type = PayloadEntryType::DIR;
+                break;
+
+            default:
+                entry.type = PayloadEntryType::UNKNOWN;
+        }
+
+        struct stat st = {};
+        if (sqfs_stat(&fs, &inode, &st) != SQFS_OK)
+            throw IOError("sqfs_stat error");
+
+        entry.stat = toEntryStat(st, entry.type);
+    }
+
+    /**
+     * Read the target of the symlink pointed by <inode>
+     * @param inode
+     * @return link target
+     */
+    std::string readLink(sqfs_inode& inode) {
+        size_t size;
+        if (sqfs_readlink(&fs, &inode, nullptr, &size) != SQFS_OK)
+            throw IOError("sqfs_readlink error");
+
+        std::vector<char> buf(size);
+        if (sqfs_readlink(&fs, &inode, buf.data(), &size) != SQFS_OK)
+            throw IOError("sqfs_readlink error");
+
+        // If the returned string is not NULL terminated a buffer overflow may occur, creating the string this way
+        // prevents it
+        return std::string(buf.data(), buf.data() + size - 1);
+    }
+
+    std::string path;
+    struct sqfs fs = {};
+    BlockCache::ImageId imageId;
+    std::shared_ptr<appimage::utils::MappedFile> mapping;
+};
+
+PayloadReaderType2::PayloadReaderType2(const std::string& path, off_t offset,
+                                       std::shared_ptr<appimage::utils::MappedFile> mapping)
+    : d(new Priv(path, offset, std::move(mapping))) {}
+
+PayloadReaderType2::~PayloadReaderType2() = default;
+
+bool PayloadReaderType2::lookup(const std::string& path, PayloadReader::Entry& entry) {
+    sqfs_inode inode;
+    sqfs_inode_id inodeId;
+    if (!lookupInode(&d->fs, path, inode, inodeId))
+        return false;
+
+    entry.id = inodeId;
+    entry.path = path;
+    d->readEntry(inode, entry);
+
+    return true;
+}
+
+PayloadReader::Entry PayloadReaderType2::open(PayloadEntryId id) {
+    sqfs_inode inode;
+    if (sqfs_inode_get(&d->fs, &inode, id) != SQFS_OK)
+        throw PayloadIteratorError("Invalid entry id: " + std::to_string(id));
+
+    Entry entry;
+    entry.id = id;
+    d->readEntry(inode, entry);
+
+    return entry;
+}
+
+bool PayloadReaderType2::list(const std::string& path, std::vector<PayloadReader::Entry>& entries) {
+    sqfs_inode inode;
+    sqfs_inode_id inodeId;
+    if (!lookupInode(&d->fs, path, inode, inodeId))
+        return false;
+
+    if (!S_ISDIR(inode.base.mode))
+        throw PayloadIteratorError("Not a directory: " + path);
+
+    sqfs_dir dir;
+    if (sqfs_dir_open(&d->fs, &inode, &dir, 0) != SQFS_OK)
+        throw IOError("sqfs_dir_open error");
+
+    sqfs_name nameBuffer;
+    sqfs_dir_entry dirEntry;
+    sqfs_dentry_init(&dirEntry, nameBuffer);
+
+    // children paths share the normalized directory prefix
+    const auto prefix = appimage::utils::toDirPrefix(path);
+
+    sqfs_err err = SQFS_OK;
+    entries.clear();
+    while (sqfs_dir_next(&d->fs, &dir, &dirEntry, &err)) {
+        Entry entry;
+        entry.id = sqfs_dentry_inode(&dirEntry);
+        entry.path = prefix + sqfs_dentry_name(&dirEntry);
+
+        sqfs_inode childInode;
+        if (sqfs_inode_get(&d->fs, &childInode, entry.id) != SQFS_OK)
+            throw IOError("sqfs_inode_get error");
+
+        d->readEntry(childInode, entry);
+        entries.emplace_back(std::move(entry));
+    }
+
+    if (err != SQFS_OK)
+        throw IOError("sqfs_dir_next error");
+
+    return true;
+}
+
+std::unique_ptr<std::streambuf> PayloadReaderType2::read(const PayloadReader::Entry& entry) {
+    if (entry.type != PayloadEntryType::REGULAR)
+        throw PayloadIteratorError("Not a regular file: " + entry.path);
+
+    sqfs_inode inode;
+    if (sqfs_inode_get(&d->fs, &inode, entry.id) != SQFS_OK)
+        throw IOError("sqfs_inode_get error");
+
+    return std::unique_ptr<std::streambuf>(new StreambufType2(&d->fs, &inode, entry.id, d->imageId, true,
+                                                                d->mapping));
+}
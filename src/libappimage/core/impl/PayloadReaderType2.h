@@ -0,0 +1,58 @@
+#pragma once
+
+// system
+#include <memory>
+#include <string>
+
+// local
+#include "core/PayloadReader.h"
+#include "utils/MappedFile.h"
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Provides random access to the payload of type 2 AppImages. It's based on squashfuse.
+             *
+             * Paths are resolved by means of squashfs directory lookups therefore the cost of reaching an
+             * entry depends only on its depth. The squashfs inode ids are used as entry ids.
+             *
+             * See the base class for more details.
+             */
+            class PayloadReaderType2 : public PayloadReader {
+            public:
+                /**
+                 * Open the squashfs image located at <offset> inside the file at <path>
+                 * @param path
+                 * @param offset
+                 * @param mapping optional mapping of the whole file, used to read the data blocks
+                 * @throw IOError if the image cannot be opened
+                 */
+                PayloadReaderType2(const std::string& path, off_t offset,
+                                   std::shared_ptr<utils::MappedFile> mapping = nullptr);
+
+                // Creating copies of this object is not allowed
+                PayloadReaderType2(PayloadReaderType2& other) = delete;
+
+                // Creating copies of this object is not allowed
+                PayloadReaderType2& operator=(PayloadReaderType2& other) = delete;
+
+                ~PayloadReaderType2() override;
+
+                bool lookup(const std::string& path, Entry& entry) override;
+
+                Entry open(PayloadEntryId id) override;
+
+                bool list(const std::string& path, std::vector<Entry>& entries) override;
+
+                std::unique_ptr<std::streambuf> read(const Entry& entry) override;
+
+            private:
+                // Keep squashfuse private, it's too unstable to go into the wild
+                class Priv;
+
+                std::unique_ptr<Priv> d;
+            };
+        }
+    }
+}
@@ -0,0 +1,263 @@
+// system
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+// local
+#include "appimage/core/exceptions.h"
+#include "utils/BlockPipeline.h"
+#include "StreambufType2.h"
+#include "SquashfsFileWriter.h"
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            namespace {
+                // Size of the chunks transferred from the streambuf to the target files
+                constexpr size_t TRANSFER_BUFFER_SIZE = 1024 * 1024;
+
+                // Smallest file decompressed and written by different threads, the pipeline thread costs more than
+                // it saves on smaller ones
+                constexpr uint64_t PIPELINE_MIN_SIZE = 4 * TRANSFER_BUFFER_SIZE;
+
+                // Location of a data block of a regular file
+                struct DataBlock {
+                    // absolute position in the AppImage file
+                    uint64_t position;
+
+                    // stored size, 0 for sparse blocks
+                    uint32_t inputSize;
+
+                    bool compressed;
+
+                    bool isSparse() const {
+                        return inputSize == 0;
+                    }
+
+                    bool isStoredRaw() const {
+                        return inputSize != 0 && !compressed;
+                    }
+                };
+
+                std::vector<DataBlock> readBlocksList(sqfs* fs, sqfs_inode& inode) {
+                    const auto blocksCount = sqfs_blocklist_count(fs, &inode);
+                    std::vector<DataBlock> blocks;
+                    blocks.reserve(blocksCount);
+
+                    sqfs_blocklist blocklist;
+                    sqfs_blocklist_init(fs, &inode, &blocklist);
+
+                    for (size_t i = 0; i < blocksCount; ++i) {
+                        if (sqfs_blocklist_next(&blocklist) != SQFS_OK)
+                            throw IOError("sqfs_blocklist_next error");
+
+                        DataBlock block{fs->offset + (uint64_t) blocklist.block, 0, false};
+                        sqfs_data_header(blocklist.header, &block.compressed, &block.inputSize);
+                        blocks.emplace_back(block);
+                    }
+
+                    return blocks;
+                }
+
+                void writeAll(int fd, const char* data, size_t size, off_t offset, const std::string& target) {
+                    while (size > 0) {
+                        auto written = pwrite(fd, data, size, offset);
+                        if (written < 0) {
+                            if (errno == EINTR)
+                                continue;
+
+                            throw IOError("write error at " + target);
+                        }
+
+                        data += written;
+                        size -= (size_t) written;
+                        offset += written;
+                    }
+                }
+
+                /**
+                 * Decompress the file range [<start>, <end>) with squashfuse and write it at the same offset
+                 */
+                void writeDecodedRange(sqfs* fs, sqfs_inode& inode, int fd, uint64_t start, uint64_t end,
+                                       std::vector<char>& buffer, const std::string& target) {
+                    while (start < end) {
+                        auto size = (sqfs_off_t) std::min<uint64_t>(end - start, buffer.size());
+                        if (sqfs_read_range(fs, &inode, (sqfs_off_t) start, &size, buffer.data()) != SQFS_OK ||
+                            size <= 0)
+                            throw IOError("Unable to read the data of " + target);
+
+                        writeAll(fd, buffer.data(), (size_t) size, (off_t) start, target);
+                        start += (uint64_t) size;
+                    }
+                }
+
+                /**
+                 * Write the file block by block, runs of contiguous uncompressed blocks are copied by the
+                 * kernel, the others blocks and the fragment are decompressed by squashfuse.
+                 */
+                void writeBlocks(sqfs* fs, sqfs_inode& inode, const std::vector<DataBlock>& blocks, int fd,
+                                 std::vector<char>& buffer, const std::string& target) {
+                    const uint64_t blockSize = fs->sb.block_size;
+                    const uint64_t fileSize = inode.xtra.reg.file_size;
+
+                    size_t i = 0;
+                    while (i < blocks.size()) {
+                        const uint64_t offset = i * blockSize;
+
+                        if (blocks[i].isSparse()) {
+                            ++i;
+                            continue;
+                        }
+
+                        if (blocks[i].isStoredRaw()) {
+                            uint64_t length = 0;
+                            size_t j = i;
+                            while (j < blocks.size() && blocks[j].isStoredRaw() &&
+                                   blocks[j].position == blocks[i].position + length) {
+                                length += blocks[j].inputSize;
+                                ++j;
+                            }
+
+                            copyFileRange(fs->fd, blocks[i].position, fd, offset, length, buffer, target);
+                            i = j;
+                            continue;
+                        }
+
+                        const auto blockEnd = std::min(fileSize, offset + blockSize);
+                        writeDecodedRange(fs, inode, fd, offset, blockEnd, buffer, target);
+                        ++i;
+                    }
+
+                    // the file tail stored in a fragment
+                    const auto blocksEnd = std::min<uint64_t>(fileSize, blocks.size() * blockSize);
+                    writeDecodedRange(fs, inode, fd, blocksEnd, fileSize, buffer, target);
+
+                    // trailing holes are only created by setting the file size
+                    if (ftruncate(fd, (off_t) fileSize) != 0)
+                        throw IOError("ftruncate error at " + target);
+                }
+            }
+
+            void writeFileContents(sqfs* fs, sqfs_inode& inode, sqfs_inode_id inodeId,
+                                   const BlockCache::ImageId& imageId,
+                                   const std::shared_ptr<utils::MappedFile>& mapping, int fd,
+                                   std::vector<char>& buffer, const std::string& target,
+                                   unsigned int pipelineDepth) {
+                if (buffer.empty())
+                    buffer.resize(TRANSFER_BUFFER_SIZE);
+
+                const auto blocks = readBlocksList(fs, inode);
+                const bool hasRawBlocks = std::any_of(blocks.begin(), blocks.end(), [](const DataBlock& block) {
+                    return block.isStoredRaw();
+                });
+                if (hasRawBlocks) {
+                    writeBlocks(fs, inode, blocks, fd, buffer, target);
+                    return;
+                }
+
+                const bool hasSparseBlocks = std::any_of(blocks.begin(), blocks.end(), [](const DataBlock& block) {
+                    return block.isSparse();
+                });
+                const uint64_t blockSize = fs->sb.block_size;
+
+                // extracted data is unlikely to be read again so it's kept out of the cache
+                StreambufType2 streambuf(fs, &inode, inodeId, imageId, false, mapping);
+
+                uint64_t position = 0;
+
+                // write the chunk block by block skipping the sparse ones
+                auto writeChunk = [&](const char* data, size_t size) {
+                    const uint64_t end = position + size;
+
+                    uint64_t offset = position;
+                    while (offset < end) {
+                        const auto block = offset / blockSize;
+                        const auto segmentEnd = std::min(end, (block + 1) * blockSize);
+
+                        if (block >= blocks.size() || !blocks[block].isSparse())
+                            writeAll(fd, data + (offset - position), (size_t) (segmentEnd - offset), (off_t) offset,
+                                     target);
+
+                        offset = segmentEnd;
+                    }
+
+                    position = end;
+                };
+
+                if (pipelineDepth > 0 && inode.xtra.reg.file_size >= PIPELINE_MIN_SIZE) {
+                    // writes overlap the decompression of the next chunks
+                    utils::BlockPipeline pipeline(pipelineDepth, TRANSFER_BUFFER_SIZE);
+                    pipeline.run([&](char* block, size_t capacity) {
+                        const auto bytesRead = streambuf.sgetn(block, (std::streamsize) capacity);
+                        return bytesRead > 0 ? (size_t) bytesRead : 0;
+                    }, writeChunk);
+                } else {
+                    std::streamsize bytesRead;
+                    while ((bytesRead = streambuf.sgetn(buffer.data(), (std::streamsize) buffer.size())) > 0)
+                        writeChunk(buffer.data(), (size_t) bytesRead);
+                }
+
+                // trailing holes are only created by setting the file size
+                if (hasSparseBlocks && ftruncate(fd, (off_t) position) != 0)
+                    throw IOError("ftruncate error at " + target);
+            }
+
+            void copyFileRange(int inFd, uint64_t inOffset, int outFd, uint64_t outOffset, uint64_t size,
+                               std::vector<char>& buffer, const std::string& target) {
+                auto in = (off_t) inOffset;
+                auto out = (off_t) outOffset;
+
+                while (size > 0) {
+                    auto copied = copy_file_range(inFd, &in, outFd, &out, (size_t) size, 0);
+                    if (copied > 0) {
+                        size -= (uint64_t) copied;
+                        continue;
+                    }
+
+                    if (copied < 0 && errno == EINTR)
+                        continue;
+
+                    // unexpected end of file, reported by the pread based copy below
+                    if (copied == 0 || errno == ENOSYS || errno == EXDEV || errno == EINVAL ||
+                        errno == EOPNOTSUPP || errno == EPERM)
+                        break;
+
+                    throw IOError("copy_file_range error at " + target);
+                }
+
+                while (size > 0) {
+                    const auto chunkSize = (size_t) std::min<uint64_t>(size, buffer.size());
+                    auto bytesRead = pread(inFd, buffer.data(), chunkSize, in);
+                    if (bytesRead < 0 && errno == EINTR)
+                        continue;
+
+                    if (bytesRead <= 0)
+                        throw IOError("Unable to read the AppImage data of " + target);
+
+                    writeAll(outFd, buffer.data(), (size_t) bytesRead, out, target);
+                    size -= (uint64_t) bytesRead;
+                    in += bytesRead;
+                    out += bytesRead;
+                }
+            }
+
+            void createHardLink(const std::string& source, const std::string& target) {
+                if (unlink(target.c_str()) != 0 && errno != ENOENT)
+                    throw FileSystemError("unlink error at " + target);
+
+                if (link(source.c_str(), target.c_str()) == 0)
+                    return;
+
+                if (errno != EPERM && errno != EXDEV && errno != EMLINK && errno != ENOTSUP)
+                    throw FileSystemError("link error at " + target);
+
+                std::error_code error;
+                std::filesystem::copy_file(source, target, std::filesystem::copy_options::overwrite_existing, error);
+                if (error)
+                    throw FileSystemError("Unable to copy " + source + " to " + target + ": " + error.message());
+            }
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <squashfuse.h>
+#include <squashfs_fs.h>
+}
+
+// local
+#include "utils/MappedFile.h"
+#include "BlockCache.h"
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Write the contents of the regular file pointed by <inode> into the empty file opened at <fd>.
+             *
+             * The sparse blocks of the squashfs blocks list are not written, they are left as holes in the
+             * target file. Blocks are read without going through the BlockCache. Blocks stored uncompressed are
+             * copied from the AppImage file with copy_file_range(2), the kernel may then use reflinks or
+             * server side copies.
+             *
+             * @param fs
+             * @param inode
+             * @param inodeId
+             * @param imageId
+             * @param mapping optional mapping of the whole AppImage file
+             * @param fd target file, opened for writing
+             * @param buffer transfer buffer, it's resized if empty
+             * @param target target file path, used in the error messages
+             * @param pipelineDepth number of chunks of a large file that may be decompressed ahead of the writes,
+             * 0 decompresses and writes on the calling thread
+             * @throw IOError if the contents can't be read or written
+             */
+            void writeFileContents(sqfs* fs, sqfs_inode& inode, sqfs_inode_id inodeId,
+                                   const BlockCache::ImageId& imageId,
+                                   const std::shared_ptr<utils::MappedFile>& mapping, int fd,
+                                   std::vector<char>& buffer, const std::string& target,
+                                   unsigned int pipelineDepth = 0);
+
+            /**
+             * Copy <size> bytes from <inFd> at <inOffset> into <outFd> at <outOffset> with copy_file_range(2) so
+             * the data doesn't go through userspace. Falls back to pread and pwrite when the kernel or the files
+             * systems don't support it.
+             * @param inFd
+             * @param inOffset
+             * @param outFd
+             * @param outOffset
+             * @param size
+             * @param buffer transfer buffer used by the fallback, must not be empty
+             * @param target target file path, used in the error messages
+             * @throw IOError if the data can't be read or written
+             */
+            void copyFileRange(int inFd, uint64_t inOffset, int outFd, uint64_t outOffset, uint64_t size,
+                               std::vector<char>& buffer, const std::string& target);
+
+            /**
+             * Create <target> as a hard link to the already extracted <source>. Files systems that don't
+             * support hard links get a copy instead.
+             * @param source
+             * @param target
+             * @throw FileSystemError if the link or the copy can't be created
+             */
+            void createHardLink(const std::string& source, const std::string& target);
+        }
+    }
+}
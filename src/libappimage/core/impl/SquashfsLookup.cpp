@@ -0,0 +1,55 @@
+// system
+#include <sys/stat.h>
+
+// local
+#include "appimage/core/exceptions.h"
+#include "SquashfsLookup.h"
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            bool lookupInode(sqfs* fs, const std::string& path, sqfs_inode& inode, sqfs_inode_id& inodeId) {
+                inodeId = sqfs_inode_root(fs);
+                if (sqfs_inode_get(fs, &inode, inodeId) != SQFS_OK)
+                    throw IOError("sqfs_inode_get error");
+
+                sqfs_name nameBuffer;
+                sqfs_dir_entry dirEntry;
+                sqfs_dentry_init(&dirEntry, nameBuffer);
+
+                std::string::size_type begin = 0;
+                while (begin < path.size()) {
+                    auto end = path.find('/', begin);
+                    if (end == std::string::npos)
+                        end = path.size();
+
+                    // skip empty and "current dir" components
+                    const auto componentSize = end - begin;
+                    if (componentSize == 0 || (componentSize == 1 && path[begin] == '.')) {
+                        begin = end + 1;
+                        continue;
+                    }
+
+                    if (!S_ISDIR(inode.base.mode))
+                        return false;
+
+                    bool found = false;
+                    if (sqfs_dir_lookup(fs, &inode, path.c_str() + begin, componentSize, &dirEntry, &found) !=
+                        SQFS_OK)
+                        throw IOError("sqfs_dir_lookup error");
+
+                    if (!found)
+                        return false;
+
+                    inodeId = sqfs_dentry_inode(&dirEntry);
+                    if (sqfs_inode_get(fs, &inode, inodeId) != SQFS_OK)
+                        throw IOError("sqfs_inode_get error");
+
+                    begin = end + 1;
+                }
+
+                return true;
+            }
+        }
+    }
+}
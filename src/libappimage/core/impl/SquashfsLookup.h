@@ -0,0 +1,27 @@
+#pragma once
+
+// system
+#include <string>
+
+extern "C" {
+#include <squashfuse.h>
+#include <squashfs_fs.h>
+}
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Walk down the directories tree of <fs> from the root inode following the <path> components.
+             * Empty and "." components are ignored, therefore an empty path resolves to the root inode.
+             * @param fs
+             * @param path
+             * @param inode will be set to the inode found at <path>
+             * @param inodeId will be set to the id of the inode found at <path>
+             * @return true if the entry was found, false otherwise
+             * @throw IOError if the image can't be read
+             */
+            bool lookupInode(sqfs* fs, const std::string& path, sqfs_inode& inode, sqfs_inode_id& inodeId);
+        }
+    }
+}
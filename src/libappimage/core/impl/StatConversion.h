@@ -0,0 +1,34 @@
+#pragma once
+
+// system
+#include <sys/stat.h>
+
+// local
+#include <appimage/core/EntryStat.h>
+#include <appimage/core/PayloadEntryType.h>
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Create the EntryStat of an entry of the given <type> from the stat(2) like results of the payload
+             * readers.
+             * @param st
+             * @param type
+             * @return entry stat
+             */
+            inline EntryStat toEntryStat(const struct stat& st, PayloadEntryType type) {
+                EntryStat stat;
+                stat.size = type == PayloadEntryType::REGULAR ? (uint64_t) st.st_size : 0;
+                stat.mode = st.st_mode;
+                stat.mtime = st.st_mtim;
+                stat.uid = st.st_uid;
+                stat.gid = st.st_gid;
+                stat.inode = (uint64_t) st.st_ino;
+                stat.nlink = (uint64_t) st.st_nlink;
+                stat.blocks = (uint64_t) st.st_blocks;
+                return stat;
+            }
+        }
+    }
+}
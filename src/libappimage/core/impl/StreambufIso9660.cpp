@@ -0,0 +1,196 @@
+// system
+#include <algorithm>
+#include <cstring>
+
+// libraries
+#include <zlib.h>
+
+// local
+#include <appimage/core/exceptions.h>
+#include "StreambufIso9660.h"
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+namespace {
+    // Size of the chunks read from uncompressed files
+    constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+
+    constexpr uint8_t ZISOFS_MAGIC[8] = {0x37, 0xE4, 0x53, 0x96, 0xC9, 0xDB, 0xD6, 0x07};
+    constexpr size_t ZISOFS_HEADER_SIZE = 16;
+
+    // zisofs blocks are 32, 64 or 128 KiB long
+    constexpr unsigned int ZISOFS_MIN_BLOCK_SHIFT = 15;
+    constexpr unsigned int ZISOFS_MAX_BLOCK_SHIFT = 17;
+
+    uint32_t readLE32(const uint8_t* data) {
+        return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16) |
+               ((uint32_t) data[3] << 24);
+    }
+}
+
+StreambufIso9660::StreambufIso9660(std::shared_ptr<const Iso9660Index> index, const Iso9660Index::Node& node)
+    : index(std::move(index)), extents(node.extents), zisofs(node.zisofs), size(node.stat.size) {}
+
+int StreambufIso9660::underflow() {
+    if (position >= size)
+        return traits_type::eof();
+
+    size_t bytesLoaded;
+    if (zisofs) {
+        bytesLoaded = loadZisofsBlock();
+    } else {
+        bytesLoaded = (size_t) std::min<uint64_t>(READ_CHUNK_SIZE, size - position);
+        buffer.resize(READ_CHUNK_SIZE);
+        readStored(position, buffer.data(), bytesLoaded);
+    }
+
+    position += bytesLoaded;
+
+    // Update streambuf read pointers see <setg> doc
+    setg(buffer.data(), buffer.data(), buffer.data() + bytesLoaded);
+
+    // return the first char
+    return traits_type::to_int_type(*gptr());
+}
+
+StreambufIso9660::pos_type StreambufIso9660::seekoff(off_type off, std::ios_base::seekdir way,
+                                                      std::ios_base::openmode which) {
+    const auto current = (int64_t) position - (egptr() - gptr());
+
+    int64_t base;
+    switch (way) {
+        case std::ios_base::beg:
+            base = 0;
+            break;
+        case std::ios_base::cur:
+            base = current;
+            break;
+        case std::ios_base::end:
+            base = (int64_t) size;
+            break;
+        default:
+            return pos_type(off_type(-1));
+    }
+
+    const int64_t target = base + off;
+    if (!(which & std::ios_base::in) || (which & std::ios_base::out) || target < 0 || target > (int64_t) size)
+        return pos_type(off_type(-1));
+
+    // the position is already loaded
+    const auto areaBegin = (int64_t) position - (egptr() - eback());
+    if (eback() != nullptr && target >= areaBegin && target < (int64_t) position) {
+        setg(eback(), eback() + (target - areaBegin), egptr());
+        return pos_type(target);
+    }
+
+    // zisofs blocks can only be decompressed whole
+    int64_t loadBegin = target;
+    if (zisofs && target < (int64_t) size) {
+        if (zisofsBlockPointers.empty())
+            readZisofsHeader();
+
+        loadBegin = target & ~(((int64_t) 1 << zisofsBlockShift) - 1);
+    }
+
+    position = (uint64_t) loadBegin;
+    setg(nullptr, nullptr, nullptr);
+
+    if (target > loadBegin) {
+        if (underflow() == traits_type::eof())
+            return pos_type(off_type(-1));
+
+        gbump((int) (target - loadBegin));
+    }
+
+    return pos_type(target);
+}
+
+StreambufIso9660::pos_type StreambufIso9660::seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+void StreambufIso9660::readStored(uint64_t offset, char* data, size_t length) const {
+    for (const auto& extent : extents) {
+        if (length == 0)
+            return;
+
+        if (offset >= extent.size) {
+            offset -= extent.size;
+            continue;
+        }
+
+        const auto chunkLength = (size_t) std::min<uint64_t>(length, extent.size - offset);
+        size_t chunkPosition = 0;
+        while (chunkPosition < chunkLength) {
+            auto bytesRead = index->readAt(extent.offset + offset + chunkPosition, data + chunkPosition,
+                                           chunkLength - chunkPosition);
+            if (bytesRead == 0)
+                throw IOError("Truncated ISO 9660 image");
+
+            chunkPosition += bytesRead;
+        }
+
+        data += chunkLength;
+        length -= chunkLength;
+        offset = 0;
+    }
+
+    if (length > 0)
+        throw IOError("Read past the end of an ISO 9660 file extent");
+}
+
+void StreambufIso9660::readZisofsHeader() {
+    uint8_t header[ZISOFS_HEADER_SIZE];
+    readStored(0, reinterpret_cast<char*>(header), sizeof(header));
+
+    if (memcmp(header, ZISOFS_MAGIC, sizeof(ZISOFS_MAGIC)) != 0)
+        throw IOError("Invalid zisofs header");
+
+    const size_t headerSize = header[12] * 4u;
+    zisofsBlockShift = header[13];
+    if (headerSize < ZISOFS_HEADER_SIZE || zisofsBlockShift < ZISOFS_MIN_BLOCK_SHIFT ||
+        zisofsBlockShift > ZISOFS_MAX_BLOCK_SHIFT)
+        throw IOError("Invalid zisofs header");
+
+    // the pointers table holds the start of every block followed by the end of the last one
+    const uint64_t blocksCount = (size + (1u << zisofsBlockShift) - 1) >> zisofsBlockShift;
+    std::vector<uint8_t> pointers((blocksCount + 1) * 4);
+    readStored(headerSize, reinterpret_cast<char*>(pointers.data()), pointers.size());
+
+    zisofsBlockPointers.resize(blocksCount + 1);
+    for (size_t i = 0; i < zisofsBlockPointers.size(); ++i)
+        zisofsBlockPointers[i] = readLE32(pointers.data() + i * 4);
+}
+
+size_t StreambufIso9660::loadZisofsBlock() {
+    if (zisofsBlockPointers.empty())
+        readZisofsHeader();
+
+    const uint64_t blockSize = 1u << zisofsBlockShift;
+    const auto block = position >> zisofsBlockShift;
+    const auto uncompressedSize = (size_t) std::min<uint64_t>(blockSize, size - block * blockSize);
+    buffer.resize(blockSize);
+
+    const auto begin = zisofsBlockPointers[block];
+    const auto end = zisofsBlockPointers[block + 1];
+    if (end < begin)
+        throw IOError("Invalid zisofs block pointers");
+
+    // empty blocks are filled with zeros
+    if (end == begin) {
+        std::fill(buffer.begin(), buffer.begin() + uncompressedSize, 0);
+        return uncompressedSize;
+    }
+
+    compressedBlock.resize(end - begin);
+    readStored(begin, compressedBlock.data(), compressedBlock.size());
+
+    auto destinationSize = (uLongf) uncompressedSize;
+    if (uncompress(reinterpret_cast<Bytef*>(buffer.data()), &destinationSize,
+                   reinterpret_cast<const Bytef*>(compressedBlock.data()), (uLong) compressedBlock.size()) != Z_OK ||
+        destinationSize != uncompressedSize)
+        throw IOError("zisofs block decompression error");
+
+    return uncompressedSize;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+// local
+#include "Iso9660Index.h"
+
+namespace appimage {
+    namespace core {
+        namespace impl {
+            /**
+             * Provides a streambuf implementation for reading the regular files of type 1 AppImages straight from
+             * their ISO 9660 extents. zisofs compressed files are decompressed block by block.
+             *
+             * The streambuf is seekable, only the zisofs block holding the new position is decompressed.
+             *
+             * For more details about streambuf see https://gcc.gnu.org/onlinedocs/libstdc++/manual/streambufs.html
+             */
+            class StreambufIso9660 : public std::streambuf {
+            public:
+                /**
+                 * @param index index of the image holding <node>, kept alive by the streambuf
+                 * @param node regular file
+                 */
+                StreambufIso9660(std::shared_ptr<const Iso9660Index> index, const Iso9660Index::Node& node);
+
+                // Creating copies of this object is not allowed
+                StreambufIso9660(StreambufIso9660& other) = delete;
+
+                // Creating copies of this object is not allowed
+                StreambufIso9660& operator=(StreambufIso9660& other) = delete;
+
+            protected:
+                /**
+                 * @brief  Fetches more data from the controlled sequence.
+                 * See parenth method documentation.
+                 * @return e first character from the <em>pending sequence</em>.
+                 */
+                int underflow() override;
+
+                /**
+                 * @brief  Alters the stream position.
+                 * Positions inside the get area are reached without reading. Only input positions are supported.
+                 * See the superclass method documentation.
+                 * @return the new position, pos_type(off_type(-1)) on failure
+                 */
+                pos_type seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which) override;
+
+                /**
+                 * @brief  Alters the stream position.
+                 * See seekoff.
+                 * @return the new position, pos_type(off_type(-1)) on failure
+                 */
+                pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+            private:
+                std::shared_ptr<const Iso9660Index> index;
+                std::vector<Iso9660Index::Extent> extents;
+                bool zisofs;
+
+                // size of the file contents
+                uint64_t size;
+
+                // position in the file contents of the first byte not loaded yet, zisofs blocks are loaded whole
+                uint64_t position = 0;
+
+                std::vector<char> buffer;
+
+                // zisofs blocks layout, read along with the first block
+                unsigned int zisofsBlockShift = 0;
+                std::vector<uint32_t> zisofsBlockPointers;
+                std::vector<char> compressedBlock;
+
+                /**
+                 * Read <length> bytes at <offset> of the data stored in the extents
+                 * @throw IOError if the data can't be read
+                 */
+                void readStored(uint64_t offset, char* data, size_t length) const;
+
+                void readZisofsHeader();
+
+                /**
+                 * Decompress the zisofs block holding <position> into the buffer
+                 * @return number of bytes loaded
+                 */
+                size_t loadZisofsBlock();
+            };
+        }
+    }
+}
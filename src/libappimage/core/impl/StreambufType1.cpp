@@ -1,41 +1,79 @@
+// system
+#include <algorithm>
+
 // local
 #include <appimage/core/exceptions.h>
 #include "StreambufType1.h"
 
 using namespace appimage::core::impl;
 
+namespace {
+    // Source of the holes contents, never written
+    const char ZEROS[64 * 1024] = {};
+}
+
 int StreambufType1::underflow() {
-    // Read line from original source
-    auto bytesRead = archive_read_data(a, buffer.data(), size);
+    while (nextBlock == nullptr && !lastBlockRead) {
+        const void* block;
+        size_t blockSize;
+        la_int64_t blockOffset;
 
-    // In case of error a value lower than 0 is returned
-    if (bytesRead < 0)
-        throw IOError(archive_error_string(a));
+        auto r = archive_read_data_block(a, &block, &blockSize, &blockOffset);
+        if (r == ARCHIVE_EOF) {
+            lastBlockRead = true;
+            nextBlockOffset = std::max<int64_t>(blockOffset, position);
+        } else if (r != ARCHIVE_OK) {
+            throw IOError(archive_error_string(a));
+        } else if (blockSize > 0) {
+            nextBlock = block;
+            nextBlockSize = blockSize;
+            nextBlockOffset = blockOffset;
+        }
+    }
+
+    // the data before the next block is a hole
+    if (nextBlockOffset > position) {
+        auto holeSize = (size_t) std::min<int64_t>(sizeof(ZEROS), nextBlockOffset - position);
+        auto zeros = const_cast<char*>(ZEROS);
+        setg(zeros, zeros, zeros + holeSize);
+
+        position += (int64_t) holeSize;
+        return traits_type::to_int_type(*gptr());
+    }
 
     // notify eof if nothing
-    if (bytesRead == 0) return traits_type::eof();
+    if (nextBlock == nullptr)
+        return traits_type::eof();
+
+    // The get area is never written, libarchive blocks can be exposed as they are. See <setg> doc
+    auto data = const_cast<char*>(static_cast<const char*>(nextBlock));
+    setg(data, data, data + nextBlockSize);
 
-    // Update streambuf read pointers see <setg> doc
-    setg(buffer.data(), buffer.data(), buffer.data() + bytesRead);
+    position = nextBlockOffset + (int64_t) nextBlockSize;
+    nextBlock = nullptr;
 
     // return the first char
     return traits_type::to_int_type(*gptr());
 }
 
-StreambufType1::StreambufType1(archive* a, unsigned long size) : a(a), size(size), buffer(size) {}
+StreambufType1::StreambufType1(archive* a) : a(a) {}
 
 StreambufType1::StreambufType1(StreambufType1&& other) noexcept
-    : a(other.a), size(other.size), buffer(std::move(other.buffer)) {
-    // Reset the three read area pointers
+    : a(other.a), position(other.position), nextBlock(other.nextBlock), nextBlockSize(other.nextBlockSize),
+      nextBlockOffset(other.nextBlockOffset), lastBlockRead(other.lastBlockRead) {
+    // Reset the three read area pointers, they point to memory owned by libarchive
     setg(other.eback(), other.gptr(), other.egptr());
 }
 
 StreambufType1& StreambufType1::operator=(StreambufType1&& other) noexcept {
     a = other.a;
-    size = other.size;
-    buffer = std::move(other.buffer);
+    position = other.position;
+    nextBlock = other.nextBlock;
+    nextBlockSize = other.nextBlockSize;
+    nextBlockOffset = other.nextBlockOffset;
+    lastBlockRead = other.lastBlockRead;
 
-    // Reset the three read area pointers
+    // Reset the three read area pointers, they point to memory owned by libarchive
     setg(other.eback(), other.gptr(), other.egptr());
 
     return *this;
@@ -1,7 +1,8 @@
 #pragma once
 
 // system
-#include <vector>
+#include <cstddef>
+#include <cstdint>
 #include <streambuf>
 
 // libraries
@@ -14,17 +15,20 @@ namespace appimage {
              * Provides a streambuf implementation for reading type 1 AppImages
              * by means of libarchive.
              *
+             * The get area points straight at the data blocks owned by libarchive, as returned by
+             * archive_read_data_block, so the entry contents are never copied into an intermediate buffer.
+             * A block remains valid until the next read on the archive, therefore the streambuf must not be
+             * used once the archive moves to another entry. Holes between blocks are served as zeros.
+             *
              * For more details about streambuf see https://gcc.gnu.org/onlinedocs/libstdc++/manual/streambufs.html
              */
             class StreambufType1 : public std::streambuf {
             public:
                 /**
-                 * Create an streambuf_type_1 object from an archive <a> pointer
-                 * with a buffer size of <size>
+                 * Create an streambuf_type_1 object for reading the current entry of the archive <a>
                  * @param a opened archive struct from libarchive
-                 * @param size buffer size
                  */
-                StreambufType1(archive* a, unsigned long size);
+                explicit StreambufType1(archive* a);
 
                 // Creating copies of this object is not allowed
                 StreambufType1(StreambufType1& other) = delete;
@@ -47,9 +51,18 @@ namespace appimage {
                 int underflow() override;
 
             private:
-                unsigned long size;
-                std::vector<char> buffer;
                 struct archive* a = {nullptr};
+
+                // offset in the entry of the end of the get area
+                int64_t position = 0;
+
+                // block returned by libarchive that comes after a hole, not yet exposed in the get area
+                const void* nextBlock = nullptr;
+                size_t nextBlockSize = 0;
+                int64_t nextBlockOffset = 0;
+
+                // the end of the entry was reported by libarchive, <nextBlockOffset> holds the entry size
+                bool lastBlockRead = false;
             };
         }
     }
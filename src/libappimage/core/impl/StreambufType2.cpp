@@ -12,18 +12,34 @@ extern "C" {
 #include <sys/stat.h>
 }
 
+// system
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
 // local
 #include "appimage/core/exceptions.h"
 #include "StreambufType2.h"
 
 using namespace appimage::core::impl;
 
-StreambufType2::StreambufType2(sqfs* fs, sqfs_inode* inode, unsigned long size)
-    : fs(fs), inode(inode), buffer(size) {
+namespace {
+    // entry id of the fragment blocks in the BlockCache, they are keyed by their position in the image
+    constexpr uint64_t FRAGMENT_BLOCKS_ID = UINT64_MAX;
+}
+
+StreambufType2::StreambufType2(sqfs* fs, sqfs_inode* inode, sqfs_inode_id inodeId,
+                               const BlockCache::ImageId& imageId, bool cached,
+                               std::shared_ptr<appimage::utils::MappedFile> mapping)
+    : fs(fs), inode(*inode), inodeId(inodeId), imageId(imageId), cached(cached),
+      blockSize(fs->sb.block_size), mapping(std::move(mapping)) {
 }
 
 StreambufType2::StreambufType2(StreambufType2&& other) noexcept
-    : fs(other.fs), inode(other.inode), buffer(std::move(other.buffer)) {
+    : fs(other.fs), inode(other.inode), inodeId(other.inodeId), imageId(other.imageId), cached(other.cached),
+      blockSize(other.blockSize), block(std::move(other.block)), bytes_already_read(other.bytes_already_read),
+      mapping(std::move(other.mapping)), blocklist(other.blocklist), blocklistReady(other.blocklistReady),
+      fragmentBlock(std::move(other.fragmentBlock)) {
 
     // Reset the three read area pointers
     setg(other.eback(), other.gptr(), other.egptr());
@@ -32,7 +48,16 @@ StreambufType2::StreambufType2(StreambufType2&& other) noexcept
 StreambufType2& StreambufType2::operator=(StreambufType2&& other) noexcept {
     fs = other.fs;
     inode = other.inode;
-    buffer = std::move(other.buffer);
+    inodeId = other.inodeId;
+    imageId = other.imageId;
+    cached = other.cached;
+    blockSize = other.blockSize;
+    block = std::move(other.block);
+    bytes_already_read = other.bytes_already_read;
+    mapping = std::move(other.mapping);
+    blocklist = other.blocklist;
+    blocklistReady = other.blocklistReady;
+    fragmentBlock = std::move(other.fragmentBlock);
 
     // Reset the three read area pointers
     setg(other.eback(), other.gptr(), other.egptr());
@@ -41,18 +66,247 @@ StreambufType2& StreambufType2::operator=(StreambufType2&& other) noexcept {
 
 int StreambufType2::underflow() {
     // notify eof if the whole file was read
-    if (bytes_already_read >= inode->xtra.reg.file_size) return traits_type::eof();
+    if (bytes_already_read >= (sqfs_off_t) inode.xtra.reg.file_size) return traits_type::eof();
+
+    auto& cache = BlockCache::instance();
+    const bool useCache = cached && cache.isEnabled();
+    const BlockCache::Key key = {imageId, inodeId, (uint64_t) bytes_already_read};
 
-    // read next data chunk
-    sqfs_off_t bytes_at_a_time = buffer.size();
-    if (sqfs_read_range(fs, inode, (sqfs_off_t) bytes_already_read, &bytes_at_a_time, buffer.data()))
-        throw IOError("sqfs_read_range error");
+    BlockCache::Block nextBlock = useCache ? cache.get(key) : nullptr;
+    if (nextBlock) {
+        bytes_already_read += nextBlock->size();
+    } else {
+        // reuse the current block memory if nobody else holds it
+        std::shared_ptr<std::vector<char>> data;
+        if (!useCache && block && block.use_count() == 1)
+            data = std::const_pointer_cast<std::vector<char>>(block);
+        else
+            data = std::make_shared<std::vector<char>>();
 
-    bytes_already_read += bytes_at_a_time;
+        // read the next whole block, the reads are always aligned to the block boundaries
+        data->resize(blockSize);
+        data->resize(readRange(data->data(), (sqfs_off_t) blockSize));
+        nextBlock = data;
 
-    // Update streambuf read pointers see <setg> doc
-    setg(buffer.data(), buffer.data(), buffer.data() + bytes_at_a_time);
+        if (useCache)
+            cache.put(key, nextBlock);
+    }
+
+    block = nextBlock;
+    if (block->empty()) return traits_type::eof();
+
+    // Update streambuf read pointers see <setg> doc, the get area is never written
+    char* data = const_cast<char*>(block->data());
+    setg(data, data, data + block->size());
 
     // return the first char
     return traits_type::to_int_type(*gptr());
 }
+
+std::streamsize StreambufType2::xsgetn(char* s, std::streamsize n) {
+    std::streamsize total = 0;
+
+    // consume the data already available in the get area
+    const std::streamsize available = std::min<std::streamsize>(egptr() - gptr(), n);
+    if (available > 0) {
+        std::memcpy(s, gptr(), available);
+        gbump((int) available);
+        total += available;
+    }
+
+    // copy whole blocks straight into the caller buffer, the cache is bypassed
+    const std::streamsize directSize = ((n - total) / (std::streamsize) blockSize) * (std::streamsize) blockSize;
+    if (directSize > 0) {
+        sqfs_off_t bytesRead = readRange(s + total, directSize);
+        total += bytesRead;
+
+        // the get area holds a block preceding the read ones, seekoff would take it as the current one
+        setg(nullptr, nullptr, nullptr);
+
+        if (bytesRead < directSize)
+            return total;
+    }
+
+    // serve the remaining bytes through the get area
+    while (total < n && underflow() != traits_type::eof()) {
+        const std::streamsize chunk = std::min<std::streamsize>(egptr() - gptr(), n - total);
+        std::memcpy(s + total, gptr(), chunk);
+        gbump((int) chunk);
+        total += chunk;
+    }
+
+    return total;
+}
+
+StreambufType2::pos_type StreambufType2::seekoff(off_type off, std::ios_base::seekdir way,
+                                                  std::ios_base::openmode which) {
+    const auto fileSize = (sqfs_off_t) inode.xtra.reg.file_size;
+    const sqfs_off_t current = bytes_already_read - (egptr() - gptr());
+
+    sqfs_off_t base;
+    switch (way) {
+        case std::ios_base::beg:
+            base = 0;
+            break;
+        case std::ios_base::cur:
+            base = current;
+            break;
+        case std::ios_base::end:
+            base = fileSize;
+            break;
+        default:
+            return pos_type(off_type(-1));
+    }
+
+    const sqfs_off_t target = base + off;
+    if (!(which & std::ios_base::in) || (which & std::ios_base::out) || target < 0 || target > fileSize)
+        return pos_type(off_type(-1));
+
+    // the position is already loaded
+    const sqfs_off_t areaBegin = bytes_already_read - (egptr() - eback());
+    if (eback() != nullptr && target >= areaBegin && target < bytes_already_read) {
+        setg(eback(), eback() + (target - areaBegin), egptr());
+        return pos_type(target);
+    }
+
+    // reads are kept aligned to the block boundaries, the block holding <target> is loaded when it's in the middle
+    const sqfs_off_t blockBegin = target - target % (sqfs_off_t) blockSize;
+    bytes_already_read = blockBegin;
+    setg(nullptr, nullptr, nullptr);
+
+    if (target > blockBegin) {
+        if (underflow() == traits_type::eof())
+            return pos_type(off_type(-1));
+
+        gbump((int) (target - blockBegin));
+    }
+
+    return pos_type(target);
+}
+
+StreambufType2::pos_type StreambufType2::seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+sqfs_off_t StreambufType2::readRange(char* target, sqfs_off_t size) {
+    const auto fileSize = (sqfs_off_t) inode.xtra.reg.file_size;
+    if (bytes_already_read >= fileSize)
+        return 0;
+
+    size = std::min(size, fileSize - bytes_already_read);
+
+    sqfs_off_t bytesRead = mapping ? readMappedBlocks(target, size) : 0;
+    if (bytesRead < size) {
+        sqfs_off_t remaining = size - bytesRead;
+        if (sqfs_read_range(fs, &inode, bytes_already_read + bytesRead, &remaining, target + bytesRead))
+            throw IOError("sqfs_read_range error");
+
+        bytesRead += remaining;
+    }
+
+    bytes_already_read += bytesRead;
+    return bytesRead;
+}
+
+sqfs_off_t StreambufType2::readMappedBlocks(char* target, sqfs_off_t size) {
+    const auto fileSize = (sqfs_off_t) inode.xtra.reg.file_size;
+    const auto blocksEnd = (sqfs_off_t) (sqfs_blocklist_count(fs, &inode) * blockSize);
+
+    sqfs_off_t bytesRead = 0;
+    while (bytesRead < size) {
+        const sqfs_off_t offset = bytes_already_read + bytesRead;
+        if (offset >= blocksEnd) {
+            bytesRead += readMappedFragment(target + bytesRead, size - bytesRead, offset - blocksEnd);
+            break;
+        }
+
+        if (offset % (sqfs_off_t) blockSize != 0)
+            break;
+
+        const auto outputSize = std::min<sqfs_off_t>((sqfs_off_t) blockSize, fileSize - offset);
+        if (size - bytesRead < outputSize)
+            break;
+
+        // the blocks list can only move forward, restart it when going backwards
+        if (!blocklistReady || (sqfs_off_t) blocklist.pos > offset) {
+            sqfs_blocklist_init(fs, &inode, &blocklist);
+            blocklistReady = true;
+        }
+
+        while (!blocklist.started || (sqfs_off_t) blocklist.pos < offset)
+            if (sqfs_blocklist_next(&blocklist) != SQFS_OK)
+                throw IOError("sqfs_blocklist_next error");
+
+        bool compressed;
+        uint32_t inputSize;
+        sqfs_data_header(blocklist.header, &compressed, &inputSize);
+
+        char* output = target + bytesRead;
+        if (inputSize == 0) {
+            // sparse block
+            std::memset(output, 0, (size_t) outputSize);
+        } else if (readMappedBlock(blocklist.block, blocklist.header, output, (size_t) outputSize) !=
+                   (size_t) outputSize) {
+            throw IOError("Unexpected data block size");
+        }
+
+        bytesRead += outputSize;
+    }
+
+    return bytesRead;
+}
+
+sqfs_off_t StreambufType2::readMappedFragment(char* target, sqfs_off_t size, sqfs_off_t tailOffset) {
+    // without the cache every file would decompress the whole fragment block again, squashfuse keeps
+    // the last used ones instead
+    auto& cache = BlockCache::instance();
+    if (inode.xtra.reg.frag_idx == SQUASHFS_INVALID_FRAG || !cached || !cache.isEnabled())
+        return 0;
+
+    if (!fragmentBlock) {
+        struct squashfs_fragment_entry entry = {};
+        if (sqfs_frag_entry(fs, &entry, inode.xtra.reg.frag_idx) != SQFS_OK)
+            throw IOError("sqfs_frag_entry error");
+
+        const BlockCache::Key key = {imageId, FRAGMENT_BLOCKS_ID, entry.start_block};
+        fragmentBlock = cache.get(key);
+        if (!fragmentBlock) {
+            auto data = std::make_shared<std::vector<char>>(blockSize);
+            data->resize(readMappedBlock(entry.start_block, entry.size, data->data(), blockSize));
+            fragmentBlock = data;
+            cache.put(key, fragmentBlock);
+        }
+    }
+
+    const auto begin = (size_t) (inode.xtra.reg.frag_off + tailOffset);
+    if (begin + size > fragmentBlock->size())
+        throw IOError("File tail out of the fragment block bounds");
+
+    std::memcpy(target, fragmentBlock->data() + begin, (size_t) size);
+    return size;
+}
+
+size_t StreambufType2::readMappedBlock(uint64_t start, uint32_t header, char* output, size_t capacity) {
+    bool compressed;
+    uint32_t inputSize;
+    sqfs_data_header(header, &compressed, &inputSize);
+
+    const auto position = (off_t) (fs->offset + start);
+    if (!mapping->contains(position, inputSize))
+        throw IOError("Data block out of the AppImage file bounds");
+
+    auto input = const_cast<char*>(mapping->data() + position);
+    if (!compressed) {
+        if (inputSize > capacity)
+            throw IOError("Unexpected data block size");
+
+        std::memcpy(output, input, inputSize);
+        return inputSize;
+    }
+
+    size_t decompressedSize = capacity;
+    if (fs->decompressor(input, inputSize, output, &decompressedSize) != SQFS_OK)
+        throw IOError("Data block decompression error");
+
+    return decompressedSize;
+}
@@ -9,6 +9,10 @@ extern "C" {
 #include <squashfs_fs.h>
 }
 
+// local
+#include "utils/MappedFile.h"
+#include "BlockCache.h"
+
 
 namespace appimage {
     namespace core {
@@ -17,18 +21,37 @@ namespace appimage {
              * Provides a streambuf implementation for reading type 2 AppImages
              * by means of squashfuse.
              *
+             * Data is fetched one squashfs block at a time, so every block (or fragment) is located and
+             * decompressed exactly once. Large reads are copied straight into the caller buffer.
+             *
+             * Blocks read through the get area are shared with other readers by means of the process wide
+             * BlockCache, unless caching is disabled for the streambuf.
+             *
+             * When a mapping of the AppImage file is provided the data blocks are decompressed straight from
+             * it, without any read system call. So are the fragment blocks when the BlockCache is used, they
+             * are shared there by all the files they hold. Metadata (inodes, blocks lists and the fragments
+             * table) is still read by squashfuse through its file descriptor and kept in its own caches.
+             *
+             * The streambuf is seekable, only the block holding the new position is decompressed.
+             *
              * For more details about streambuf see https://gcc.gnu.org/onlinedocs/libstdc++/manual/streambufs.html
              */
             class StreambufType2 : public std::streambuf {
             public:
                 /**
-                 * Create an streambuf_type_2 object for reading the file pointed by <inode> at <fs>
-                 * of size <size>
+                 * Create an streambuf_type_2 object for reading the file pointed by <inode> at <fs>.
+                 * The buffer size matches the image block size. A copy of <inode> is kept so the
+                 * streambuf can outlive it.
                  * @param fs
                  * @param inode
-                 * @param size
+                 * @param inodeId id of <inode>, used to identify the blocks in the cache
+                 * @param imageId id of the AppImage file, used to identify the blocks in the cache
+                 * @param cached whether the blocks should be looked up and stored in the BlockCache
+                 * @param mapping optional mapping of the whole AppImage file
                  */
-                StreambufType2(sqfs* fs, sqfs_inode* inode, unsigned long size);
+                StreambufType2(sqfs* fs, sqfs_inode* inode, sqfs_inode_id inodeId,
+                               const BlockCache::ImageId& imageId, bool cached = true,
+                               std::shared_ptr<utils::MappedFile> mapping = nullptr);
 
                 // Creating copies of this object is not allowed
                 StreambufType2(StreambufType2& other) = delete;
@@ -50,11 +73,80 @@ namespace appimage {
                  */
                 int underflow() override;
 
+                /**
+                 * @brief  Multiple character extraction.
+                 * Whole blocks are read directly into <s> without going through the internal buffer.
+                 * See the superclass method documentation.
+                 * @return the number of characters extracted
+                 */
+                std::streamsize xsgetn(char* s, std::streamsize n) override;
+
+                /**
+                 * @brief  Alters the stream position.
+                 * Positions inside the get area are reached without reading, otherwise the block holding the
+                 * new position is loaded. Only input positions are supported.
+                 * See the superclass method documentation.
+                 * @return the new position, pos_type(off_type(-1)) on failure
+                 */
+                pos_type seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which) override;
+
+                /**
+                 * @brief  Alters the stream position.
+                 * See seekoff.
+                 * @return the new position, pos_type(off_type(-1)) on failure
+                 */
+                pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
             private:
                 sqfs* fs;
-                sqfs_inode* inode;
-                std::vector<char> buffer;
+                sqfs_inode inode;
+                sqfs_inode_id inodeId;
+                BlockCache::ImageId imageId;
+                bool cached;
+                size_t blockSize;
+
+                // block currently exposed as get area, it may be shared with the cache
+                BlockCache::Block block;
                 sqfs_off_t bytes_already_read = 0;
+
+                std::shared_ptr<utils::MappedFile> mapping;
+
+                // position in the file blocks list, only used when reading from the mapping
+                sqfs_blocklist blocklist = {};
+                bool blocklistReady = false;
+
+                // decompressed fragment block holding the file tail, only used when reading from the mapping
+                BlockCache::Block fragmentBlock;
+
+                /**
+                 * Read up to <size> bytes of the file starting at <bytes_already_read> into <target>
+                 * @return number of bytes read
+                 */
+                sqfs_off_t readRange(char* target, sqfs_off_t size);
+
+                /**
+                 * Decompress whole data blocks and the file tail from the mapping into <target>, starting at
+                 * <bytes_already_read>. Stops when <size> can't hold a whole block or when the tail must be
+                 * read by squashfuse.
+                 * @return number of bytes read
+                 */
+                sqfs_off_t readMappedBlocks(char* target, sqfs_off_t size);
+
+                /**
+                 * Copy <size> bytes of the file tail starting at <tailOffset> from its fragment block, which
+                 * is decompressed from the mapping or taken from the BlockCache.
+                 * @return number of bytes read, 0 if the file has no fragment or the BlockCache is not used
+                 */
+                sqfs_off_t readMappedFragment(char* target, sqfs_off_t size, sqfs_off_t tailOffset);
+
+                /**
+                 * Decompress the block starting at <start> in the image from the mapping into <output>
+                 * @param header block size as stored in the image, including the uncompressed flag
+                 * @param capacity size of <output>
+                 * @return decompressed size
+                 * @throw IOError if the block is out of the mapping bounds or can't be decompressed
+                 */
+                size_t readMappedBlock(uint64_t start, uint32_t header, char* output, size_t capacity);
             };
         }
     }
@@ -1,8 +1,13 @@
 // system
+#include <algorithm>
 #include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <filesystem>
+#include <string_view>
+#include <vector>
 
 // library
 #include <archive.h>
@@ -12,18 +17,50 @@
 #include "appimage/core/AppImage.h"
 #include "appimage/core/exceptions.h"
 #include "appimage/appimage_shared.h"
-#include "TraversalType1.h"
+#include "utils/BlockPipeline.h"
+#include "utils/path_utils.h"
+#include "SquashfsFileWriter.h"
+#include "StatConversion.h"
+#include "StreambufIso9660.h"
 #include "StreambufType1.h"
+#include "TraversalType1.h"
 
 using namespace std;
 using namespace appimage::core::impl;
 
-TraversalType1::TraversalType1(const std::string& path) : path(path) {
-    a = archive_read_new();
-    archive_read_support_format_iso9660(a);
+namespace {
+    // Size of the chunks handed from libarchive to the writer thread
+    constexpr size_t PIPELINE_BLOCK_SIZE = 1024 * 1024;
 
-    if (archive_read_open_filename(a, path.c_str(), 10240) != ARCHIVE_OK)
-        throw IOError(archive_error_string(a));
+    // Smallest file read and written by different threads, the pipeline thread costs more than it saves on
+    // smaller ones
+    constexpr uint64_t PIPELINE_MIN_SIZE = 4 * PIPELINE_BLOCK_SIZE;
+}
+
+TraversalType1::TraversalType1(const std::string& path) : TraversalType1(path, std::string()) {}
+
+TraversalType1::TraversalType1(const std::string& path, const std::string& subdir, const PayloadFilter& filter)
+    : path(path), pathPrefix(appimage::utils::toDirPrefix(subdir)), filter(filter) {
+    try {
+        index = std::make_shared<Iso9660Index>(path);
+    } catch (const IOError&) {
+        // images without Rock Ridge extensions or unusual ones are read by libarchive, as PayloadReaderType1 does
+    }
+
+    if (index) {
+        const auto root = index->find(pathPrefix);
+        if (root != nullptr && root->type == PayloadEntryType::DIR && filter.isReachable(pathPrefix))
+            pendingIds.assign(root->children.rbegin(), root->children.rend());
+    } else {
+        a = archive_read_new();
+        archive_read_support_format_iso9660(a);
+
+        if (archive_read_open_filename(a, path.c_str(), 10240) != ARCHIVE_OK) {
+            std::string error = archive_error_string(a);
+            archive_read_free(a);
+            throw IOError(error);
+        }
+    }
 
     completed = false;
 
@@ -33,33 +70,123 @@ TraversalType1::TraversalType1(const std::string& path) : path(path) {
 
 
 TraversalType1::TraversalType1::~TraversalType1() {
-    archive_read_close(a);
-    archive_read_free(a);
+    if (a != nullptr) {
+        archive_read_close(a);
+        archive_read_free(a);
+    }
 }
 
 void TraversalType1::next() {
-    if (completed)
+    // the stream of the previous entry becomes invalid
+    entryIStream.rdbuf(nullptr);
+    entryStreambuf.reset();
+
+    if (index) {
+        nextIndexEntry();
         return;
+    }
+
+    while (!completed) {
+        readNextHeader();
+        if (completed)
+            return;
+
+        if (isEntrySelected()) {
+            readEntryData();
+            return;
+        }
+    }
+}
 
-    readNextHeader();
-    if (!completed) {
-        readEntryData();
+void TraversalType1::nextIndexEntry() {
+    node = nullptr;
+    while (!pendingIds.empty()) {
+        const auto candidate = index->get(pendingIds.back());
+        pendingIds.pop_back();
 
-        // Skip the "." entry
-        if (entryName == ".")
-            next();
+        // the children are queued in reverse order so they are visited in the directory order
+        if (candidate->type == PayloadEntryType::DIR && filter.canDescend(candidate->path))
+            pendingIds.insert(pendingIds.end(), candidate->children.rbegin(), candidate->children.rend());
+
+        if (filter.matches(candidate->path, candidate->type)) {
+            node = candidate;
+            break;
+        }
     }
+
+    completed = node == nullptr;
+    entryName = completed ? std::string() : node->path;
+    entryLink = completed ? std::string() : node->linkTarget;
+    entryType = completed ? PayloadEntryType::UNKNOWN : node->type;
+}
+
+bool TraversalType1::isEntrySelected() const {
+    const char* pathname = archive_entry_pathname(entry);
+    if (pathname == nullptr)
+        return false;
+
+    std::string_view name(pathname);
+    if (name.compare(0, 2, "./") == 0)
+        name.remove_prefix(2);
+
+    // Skip the "." entry and the entries outside of the traversal root
+    if (name == "." || name.size() <= pathPrefix.size() || name.compare(0, pathPrefix.size(), pathPrefix) != 0)
+        return false;
+
+    if (filter.isEmpty())
+        return true;
+
+    // the archive can't skip directories, their contents are discarded one by one
+    return filter.matches(name, readEntryType()) && filter.isReachable(name);
 }
 
 bool TraversalType1::isCompleted() const { return completed; }
 
-std::string TraversalType1::getEntryPath() const { return entryName; }
+const std::string& TraversalType1::getEntryPath() const { return entryName; }
 
 appimage::core::PayloadEntryType TraversalType1::getEntryType() const { return entryType; }
 
-string TraversalType1::getEntryLinkTarget() const { return entryLink; }
+const string& TraversalType1::getEntryLinkTarget() const { return entryLink; }
+
+appimage::core::PayloadEntryId TraversalType1::getEntryId() const {
+    if (index)
+        return node != nullptr ? node->id : 0;
+
+    // PayloadReaderType1 falls back to libarchive as well, the headers positions are used as ids
+    return entryId;
+}
+
+uint64_t TraversalType1::getEntrySize() const {
+    if (completed || entryType != PayloadEntryType::REGULAR)
+        return 0;
+
+    if (index)
+        return node->stat.size;
 
-void TraversalType1::extract(const std::string& target) {
+    return entry != nullptr ? archive_entry_size(entry) : 0;
+}
+
+mode_t TraversalType1::getEntryMode() const {
+    if (completed)
+        return 0;
+
+    if (index)
+        return node->stat.mode;
+
+    return entry != nullptr ? archive_entry_mode(entry) : 0;
+}
+
+appimage::core::EntryStat TraversalType1::getEntryStat() const {
+    if (completed)
+        return {};
+
+    if (index)
+        return node->stat;
+
+    return entry != nullptr ? toEntryStat(*archive_entry_stat(entry), entryType) : EntryStat();
+}
+
+void TraversalType1::extract(const std::string& target, const ExtractOptions& options) {
     // create target parent dir
     auto parentPath = filesystem::path(target).parent_path();
     filesystem::create_directories(parentPath);
@@ -71,22 +198,100 @@ void TraversalType1::extract(const std::string& target) {
     if (f == -1)
         throw FileSystemError("Unable to open file: " + target);
 
-    // call the libarchive extract file implementation
-    archive_read_data_into_fd(a, f);
-    close(f);
+    if (isEntryCopyable()) {
+        const auto& extent = node->extents.front();
+        try {
+            // only used if copy_file_range is not supported
+            std::vector<char> buffer((size_t) std::clamp<uint64_t>(extent.size, 1, PIPELINE_BLOCK_SIZE));
+            copyFileRange(index->getFd(), extent.offset, f, 0, extent.size, buffer, target);
+        } catch (...) {
+            close(f);
+            throw;
+        }
+
+        if (close(f) != 0)
+            throw IOError("close error at " + target);
+        return;
+    }
+
+    const bool pipelined = options.pipelineDepth > 0 && getEntrySize() >= PIPELINE_MIN_SIZE;
+    if (!index && !pipelined) {
+        // call the libarchive extract file implementation, it leaves trailing holes out
+        archive_read_data_into_fd(a, f);
+        if (ftruncate(f, (off_t) getEntrySize()) != 0) {
+            close(f);
+            throw IOError("ftruncate error at " + target);
+        }
+
+        close(f);
+        return;
+    }
+
+    uint64_t position = 0;
+    auto writeData = [&](const char* data, size_t size) {
+        while (size > 0) {
+            auto written = pwrite(f, data, size, (off_t) position);
+            if (written < 0 && errno == EINTR)
+                continue;
+
+            if (written < 0)
+                throw IOError("write error at " + target);
+
+            data += written;
+            size -= (size_t) written;
+            position += (uint64_t) written;
+        }
+    };
+
+    try {
+        if (pipelined) {
+            // writes overlap the reading of the next chunks
+            appimage::utils::BlockPipeline pipeline(options.pipelineDepth, PIPELINE_BLOCK_SIZE);
+            pipeline.run([this](char* block, size_t capacity) { return readContents(block, capacity); },
+                         writeData);
+        } else {
+            std::vector<char> buffer((size_t) std::min<uint64_t>(getEntrySize(), PIPELINE_BLOCK_SIZE));
+            size_t bytesRead;
+            while (!buffer.empty() && (bytesRead = readContents(buffer.data(), buffer.size())) > 0)
+                writeData(buffer.data(), bytesRead);
+        }
+    } catch (...) {
+        close(f);
+        throw;
+    }
+
+    if (close(f) != 0)
+        throw IOError("close error at " + target);
+}
+
+bool TraversalType1::isEntryCopyable() const {
+    return index && node != nullptr && entryType == PayloadEntryType::REGULAR && !node->zisofs &&
+           node->extents.size() == 1 && node->extents.front().size == node->stat.size;
 }
 
 istream& TraversalType1::read() {
-    // create a new streambuf for reading the current entry
-    auto tmpBuffer = new StreambufType1(a, 1024);
+    // the stream is created once per entry, reading it again continues where the previous read stopped
+    if (!entryStreambuf && !completed) {
+        if (index)
+            entryStreambuf.reset(new StreambufIso9660(index, *node));
+        else
+            entryStreambuf.reset(new StreambufType1(a));
+
+        entryIStream.rdbuf(entryStreambuf.get());
+    }
 
-    // replace buffer in the istream
-    entryIStream.rdbuf(tmpBuffer);
+    return entryIStream;
+}
 
-    // replace and drop the old buffer
-    entryStreambuf.reset(tmpBuffer);
+size_t TraversalType1::readContents(char* buffer, size_t size) {
+    if (index)
+        return (size_t) read().rdbuf()->sgetn(buffer, (std::streamsize) size);
 
-    return entryIStream;
+    auto bytesRead = archive_read_data(a, buffer, size);
+    if (bytesRead < 0)
+        throw IOError("Unable to read the data of " + entryName + ": " + archive_error_string(a));
+
+    return (size_t) bytesRead;
 }
 
 void TraversalType1::readNextHeader() {
@@ -98,6 +303,8 @@ void TraversalType1::readNextHeader() {
 
     if (r != ARCHIVE_OK)
         throw IOError(archive_error_string(a));
+
+    entryId = headersCount++;
 }
 
 void TraversalType1::readEntryData() {
@@ -106,9 +313,9 @@ void TraversalType1::readEntryData() {
     entryType = readEntryType();
 }
 
-appimage::core::PayloadEntryType TraversalType1::readEntryType() {
+appimage::core::PayloadEntryType TraversalType1::readEntryType() const {
     // Hard links are reported by libarchive as regular files, this a workaround
-    if (!entryLink.empty())
+    if (archive_entry_symlink(entry) != nullptr || archive_entry_hardlink(entry) != nullptr)
         return PayloadEntryType::LINK;
 
     auto entryType = archive_entry_filetype(entry);
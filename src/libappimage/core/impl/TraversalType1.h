@@ -2,18 +2,27 @@
 
 // system
 #include <memory>
+#include <vector>
 
 // local
+#include <appimage/core/PayloadFilter.h>
 #include "core/Traversal.h"
+#include "Iso9660Index.h"
 #include "PayloadIStream.h"
-#include "StreambufType1.h"
+
+// forward declaration, libarchive is kept confined to the implementation
+struct archive;
+struct archive_entry;
 
 namespace appimage {
     namespace core {
         namespace impl {
             /**
-             * Provides an implementation of the traversal class for type 1 AppImages. It's based on libarchive.
-             * As libarchive imposes this is a READONLY, ONE WAY, SINGLE PASS traversal implementation.
+             * Provides an implementation of the traversal class for type 1 AppImages.
+             *
+             * The entries are taken from an Iso9660Index, as PayloadReaderType1 does, so both report the same
+             * types, link targets and ids. Images that can't be indexed are read by means of libarchive. As
+             * libarchive imposes this is a READONLY, ONE WAY, SINGLE PASS traversal implementation.
              *
              * See the base class for more details.
              */
@@ -21,6 +30,17 @@ namespace appimage {
             public:
                 explicit TraversalType1(const std::string& path);
 
+                /**
+                 * Traverse only the entries contained in <subdir>. When libarchive is used the ISO 9660 image can
+                 * only be read sequentially therefore every header is still read but the other entries are
+                 * skipped without decoding their names further. A missing <subdir> results in an empty traversal.
+                 * @param path
+                 * @param subdir
+                 * @param filter entries to be reported, the others are skipped in the same way
+                 */
+                TraversalType1(const std::string& path, const std::string& subdir,
+                               const PayloadFilter& filter = PayloadFilter());
+
                 // Creating copies of this object is not allowed
                 TraversalType1(TraversalType1& other) = delete;
 
@@ -33,13 +53,31 @@ namespace appimage {
 
                 bool isCompleted() const override;
 
-                std::string getEntryPath() const override;
+                const std::string& getEntryPath() const override;
 
-                std::string getEntryLinkTarget() const override;
+                const std::string& getEntryLinkTarget() const override;
 
                 PayloadEntryType getEntryType() const override;
 
-                void extract(const std::string& target) override;
+                PayloadEntryId getEntryId() const override;
+
+                uint64_t getEntrySize() const override;
+
+                mode_t getEntryMode() const override;
+
+                EntryStat getEntryStat() const override;
+
+                /**
+                 * Entries stored plainly in a single extent of an indexed image are copied with
+                 * copy_file_range(2), their data doesn't go through userspace.
+                 * See the base class for more details.
+                 */
+                void extract(const std::string& target, const ExtractOptions& options) override;
+
+                /**
+                 * @return true if extract copies the current entry contents within the kernel
+                 */
+                bool isEntryCopyable() const;
 
                 std::istream& read() override;
 
@@ -48,6 +86,21 @@ namespace appimage {
                 std::string path;
                 bool completed = false;
 
+                // path of the traversal root followed by a "/", empty when the whole image is traversed
+                std::string pathPrefix;
+
+                // entries to be reported
+                PayloadFilter filter;
+
+                // nullptr if the image can't be indexed, libarchive is used then
+                std::shared_ptr<const Iso9660Index> index;
+
+                // current entry when the index is used
+                const Iso9660Index::Node* node = nullptr;
+
+                // entries left to visit when the index is used, the next one is at the back
+                std::vector<PayloadEntryId> pendingIds;
+
                 // libarchive
                 struct archive* a = {nullptr};
                 struct archive_entry* entry = {nullptr};
@@ -56,14 +109,38 @@ namespace appimage {
                 std::string entryName;
                 PayloadEntryType entryType = PayloadEntryType::UNKNOWN;
                 std::string entryLink;
+
+                // position of the current header in the archive, used as entry id when the image can't be indexed
+                PayloadEntryId entryId = 0;
+                PayloadEntryId headersCount = 0;
+
                 PayloadIStream entryIStream;
-                std::unique_ptr<StreambufType1> entryStreambuf;
+                std::unique_ptr<std::streambuf> entryStreambuf;
+
+                /**
+                 * Move to the next entry of the index selected by the filter
+                 */
+                void nextIndexEntry();
+
+                /**
+                 * Read up to <size> bytes of the current entry contents
+                 * @return number of bytes read, 0 at the end of the entry
+                 * @throw IOError on read errors
+                 */
+                size_t readContents(char* buffer, size_t size);
 
                 /**
                  * Move to the next header
                  */
                 void readNextHeader();
 
+                /**
+                 * Check the current header against the traversal root and the filter without reading the
+                 * entry data into the cache
+                 * @return true if the current entry shall be reported, false otherwise
+                 */
+                bool isEntrySelected() const;
+
                 /**
                  * Read entry data into the cache
                  */
@@ -80,7 +157,7 @@ namespace appimage {
                  * Hard and Symbolic links are classified as "Links"
                  * @return current entry type
                  */
-                PayloadEntryType readEntryType();
+                PayloadEntryType readEntryType() const;
 
                 /**
                  * @return entry link if it's a Link type entry otherwise an empty string.
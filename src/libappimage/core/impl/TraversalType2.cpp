@@ -14,8 +14,11 @@
 #include <csignal>
 #include <cstring>
 #include <filesystem>
-#include <fstream>
+#include <map>
 #include <set>
+#include <vector>
+#include <fcntl.h>
+#include <string_view>
 #include <unistd.h>
 
 // libraries
@@ -25,9 +28,14 @@ extern "C" {
 
 
 // local
-#include "appimage/core/AppImage.h"
 #include "appimage/core/exceptions.h"
+#include "utils/ContentStore.h"
+#include "utils/ElfFile.h"
+#include "utils/path_utils.h"
 #include "PayloadIStream.h"
+#include "SquashfsFileWriter.h"
+#include "SquashfsLookup.h"
+#include "StatConversion.h"
 #include "StreambufType2.h"
 #include "TraversalType2.h"
 
@@ -36,10 +44,9 @@ using namespace appimage::core::impl;
 
 class TraversalType2::Priv {
 public:
-    explicit Priv(const std::string& path) {
-        // read the offset at which a squashfs image is expected to start
-        ssize_t fs_offset = core::AppImage(path).getPayloadOffset();
-
+    Priv(const std::string& path, off_t fs_offset, std::shared_ptr<appimage::utils::MappedFile> mapping,
+         const std::string& subdir, const PayloadFilter& filter)
+        : mapping(std::move(mapping)), filter(filter) {
         if (fs_offset < 0)
             throw IOError("get_elf_size error");
 
@@ -48,8 +55,22 @@ public:
         if (err != SQFS_OK)
             throw IOError("sqfs_open_image error: " + path);
 
-        // prepare for traverse
-        rootInodeId = sqfs_inode_root(&fs);
+        try {
+            imageId = BlockCache::ImageId::fromFd(fs.fd);
+
+            // prepare for traverse, starting at <subdir> allows to skip the rest of the image
+            sqfs_inode rootInode;
+            if (!lookupInode(&fs, subdir, rootInode, rootInodeId))
+                throw PayloadIteratorError("Missing payload entry: " + subdir);
+
+            if (!S_ISDIR(rootInode.base.mode))
+                throw PayloadIteratorError("Not a directory: " + subdir);
+        } catch (...) {
+            sqfs_destroy(&fs);
+            throw;
+        }
+
+        pathPrefix = appimage::utils::toDirPrefix(subdir);
         err = sqfs_traverse_open(&trv, &fs, rootInodeId);
         if (err != SQFS_OK) {
             sqfs_destroy(&fs);
@@ -71,38 +92,83 @@ public:
         return currentEntryType;
     }
 
-    const string& getCurrentEntryPath() const {
+    const string& getCurrentEntryPath() {
+        if (!currentEntryPathLoaded) {
+            currentEntryPath = completed ? std::string() : readEntryName();
+            currentEntryPathLoaded = true;
+        }
+
         return currentEntryPath;
     }
 
-    const string& getCurrentEntryLink() const {
+    std::string_view getCurrentEntryPathView() {
+        if (currentEntryPathLoaded || completed)
+            return currentEntryPath;
+
+        return readEntryPathView();
+    }
+
+    const string& getCurrentEntryLink() {
+        if (!currentEntryLinkLoaded) {
+            currentEntryLink = currentEntryType == PayloadEntryType::LINK ? readEntryLink() : std::string();
+            currentEntryLinkLoaded = true;
+        }
+
         return currentEntryLink;
     }
 
+    PayloadEntryId getCurrentEntryId() const {
+        return completed ? 0 : trv.entry.inode;
+    }
+
+    uint64_t getCurrentEntrySize() {
+        return currentEntryType == PayloadEntryType::REGULAR ? getCurrentInode().xtra.reg.file_size : 0;
+    }
+
+    mode_t getCurrentEntryMode() {
+        return completed ? 0 : getCurrentInode().base.mode;
+    }
+
+    EntryStat getCurrentEntryStat() {
+        if (completed)
+            return {};
+
+        // resolves the uid and gid indexes, only done on demand
+        struct stat st = {};
+        if (sqfs_stat(&fs, &getCurrentInode(), &st) != SQFS_OK)
+            throw IOError("sqfs_stat error");
+
+        return toEntryStat(st, currentEntryType);
+    }
+
     void next() {
-        sqfs_err err;
-        if (!sqfs_traverse_next(&trv, &err))
-            completed = true;
+        while (moveNext()) {
+            if (filter.isEmpty())
+                break;
 
-        if (err != SQFS_OK)
-            throw IOError("sqfs_traverse_next error");
+            // the filter is evaluated using only the directory listing data, no inode is read
+            const auto type = readEntryType();
+            const auto path = readEntryPathView();
 
-        if (!completed) {
-            currentInode = readInode();
-            currentEntryType = readEntryType();
-            currentEntryPath = readEntryName();
-            currentEntryLink = currentEntryType == PayloadEntryType::LINK ? readEntryLink() : std::string();
-        } else {
-            currentEntryType = PayloadEntryType::UNKNOWN;
-            currentEntryPath = std::string();
-            currentEntryLink = std::string();
+            if (type == PayloadEntryType::DIR && !trv.dir_end && !filter.canDescend(path) &&
+                sqfs_traverse_prune(&trv) != SQFS_OK)
+                throw IOError("sqfs_traverse_prune error");
+
+            if (filter.matches(path, type))
+                break;
         }
+
+        // the entry type is part of the directory listing, the rest is read only when requested
+        currentEntryType = completed ? PayloadEntryType::UNKNOWN : readEntryType();
+        currentInodeLoaded = false;
+        currentEntryPathLoaded = false;
+        currentEntryLinkLoaded = false;
+        currentEntryPath.clear();
+        currentEntryLink.clear();
     }
 
-    void extract(const std::string& target) {
-        sqfs_inode inode;
-        if (sqfs_inode_get(&fs, &inode, trv.entry.inode))
-            throw IOError("sqfs_inode_get error");
+    void extract(const std::string& target, const ExtractOptions& options) {
+        const auto& inode = getCurrentInode();
 
         // create target parent dir
         auto parentPath = filesystem::path(target).parent_path();
@@ -116,7 +182,7 @@ public:
                 break;
             case SQUASHFS_REG_TYPE:
             case SQUASHFS_LREG_TYPE:
-                extractFile(inode, target);
+                extractFile(inode, target, options);
                 break;
             case SQUASHFS_SYMLINK_TYPE:
             case SQUASHFS_LSYMLINK_TYPE:
@@ -128,9 +194,9 @@ public:
         }
     }
 
-    istream& read() {
+    istream& read(bool cached = true) {
         // create a streambuf for reading the inode contents
-        auto tmpBuffer = new StreambufType2(&fs, &currentInode, 1024);
+        auto tmpBuffer = new StreambufType2(&fs, &getCurrentInode(), trv.entry.inode, imageId, cached, mapping);
 
         // replace buffer of the istream
         entryIStream.rdbuf(tmpBuffer);
@@ -149,16 +215,79 @@ private:
     struct sqfs fs = {};
     sqfs_traverse trv = {};
     sqfs_inode_id rootInodeId = 0;
+
+    // path of the traversal root followed by a "/", empty when the whole image is traversed
+    std::string pathPrefix;
+
+    // reused to build the entries paths when the traversal root is not the image root
+    std::string pathBuffer;
+
     sqfs_inode currentInode = {};
+    BlockCache::ImageId imageId;
+    std::shared_ptr<appimage::utils::MappedFile> mapping;
 
-    // Current entry data cache
+    // entries that are not reported, directories that can't contain matches are pruned
+    PayloadFilter filter;
+
+    // Current entry data cache, filled on demand
     PayloadEntryType currentEntryType = PayloadEntryType::UNKNOWN;
+    bool currentInodeLoaded = false;
+    bool currentEntryPathLoaded = false;
     std::string currentEntryPath;
+    bool currentEntryLinkLoaded = false;
     std::string currentEntryLink;
 
     PayloadIStream entryIStream;
     std::unique_ptr<StreambufType2> entryStreamBuf;
 
+    // extraction of the regular files
+    std::vector<char> transferBuffer;
+    std::map<sqfs_inode_id, std::string> extractedInodes;
+
+    // opened on the first extraction that requests it, the objects records are saved when it's destroyed
+    std::unique_ptr<appimage::utils::ContentStore> contentStore;
+    std::string contentStorePath;
+    bool contentStoreReflinks = false;
+    std::string contentStoreSourceId;
+
+    /**
+     * Move the squashfs traversal to the next entry
+     * @return false if the end of the traversal was reached, true otherwise
+     */
+    bool moveNext() {
+        sqfs_err err;
+        if (!sqfs_traverse_next(&trv, &err))
+            completed = true;
+
+        if (err != SQFS_OK)
+            throw IOError("sqfs_traverse_next error");
+
+        // the subdir itself is not part of its own traversal, the final "dir end" of the traversal root is
+        // only reported for the whole image
+        if (!completed && !pathPrefix.empty() && trv.dir_end && (trv.path == nullptr || *trv.path == '\0')) {
+            if (sqfs_traverse_next(&trv, &err))
+                throw IOError("sqfs_traverse_next error: unexpected entry after the traversal root end");
+            completed = true;
+
+            if (err != SQFS_OK)
+                throw IOError("sqfs_traverse_next error");
+        }
+
+        return !completed;
+    }
+
+    /**
+     * @return inode of the current entry, read on the first call
+     */
+    sqfs_inode& getCurrentInode() {
+        if (!currentInodeLoaded) {
+            currentInode = readInode();
+            currentInodeLoaded = true;
+        }
+
+        return currentInode;
+    }
+
     sqfs_inode readInode() {
         sqfs_inode inode;
         if (sqfs_inode_get(&fs, &inode, trv.entry.inode))
@@ -199,13 +328,26 @@ private:
     * Read the current entry path from the underlying implementation.
     * @return Current entry path
     */
-    std::string readEntryName() const {
-        if (trv.path != nullptr)
+    std::string readEntryName() {
+        return std::string(readEntryPathView());
+    }
+
+    /**
+     * Non-copying variant of readEntryName(), the view becomes invalid when the traversal moves forward.
+     * @return Current entry path
+     */
+    std::string_view readEntryPathView() {
+        if (trv.path == nullptr)
+            return {};
+
+        if (pathPrefix.empty())
             return trv.path;
-        else
-            return string();
+
+        pathBuffer.assign(pathPrefix).append(trv.path);
+        return pathBuffer;
     }
 
+
     /**
      * Read the current entry link path from the underlying implementation.
      * @return Current link entry path or an empty string if the entry is not a link.
@@ -213,14 +355,14 @@ private:
     std::string readEntryLink() {
         // read the target link path size
         size_t size;
-        auto err = sqfs_readlink(&fs, &currentInode, nullptr, &size);
+        auto err = sqfs_readlink(&fs, &getCurrentInode(), nullptr, &size);
         if (err != SQFS_OK)
             throw IOError("sqfs_readlink error");
 
         char buf[size];
 
         // read the target link in buf
-        err = sqfs_readlink(&fs, &currentInode, buf, &size);
+        err = sqfs_readlink(&fs, &getCurrentInode(), buf, &size);
         if (err != SQFS_OK)
             throw IOError("sqfs_readlink error");
 
@@ -247,20 +389,77 @@ private:
     * extract the file pointed by <inode> contents at <target>
     * @param inode file
     * @param target path
+    * @param options
     */
-    void extractFile(sqfs_inode inode, const std::string& target) {
-        // open read stream
-        auto& istream = read();
+    void extractFile(sqfs_inode inode, const std::string& target, const ExtractOptions& options) {
+        // hard links share the inode, link to the copy extracted before if it's still there
+        if (inode.nlink > 1) {
+            auto itr = extractedInodes.find(trv.entry.inode);
+            if (itr != extractedInodes.end() && access(itr->second.c_str(), F_OK) == 0) {
+                createHardLink(itr->second, target);
+                return;
+            }
+        }
 
-        // open write stream
-        ofstream targetFile(target);
+        if (options.contentStorePath.empty())
+            writeFile(inode, target, options.pipelineDepth);
+        else
+            storeFile(inode, target, options);
 
-        // transfer data
-        targetFile << istream.rdbuf();
-        targetFile.close();
+        if (inode.nlink > 1)
+            extractedInodes[trv.entry.inode] = target;
+    }
 
-        // set file stats
-        chmod(target.c_str(), inode.base.mode);
+    /**
+    * write the contents of the file pointed by <inode> at <target>
+    * @param inode file
+    * @param target path
+    * @param pipelineDepth
+    */
+    void writeFile(sqfs_inode inode, const std::string& target, unsigned int pipelineDepth) {
+        int fd = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd == -1)
+            throw FileSystemError("Unable to open file: " + target);
+
+        try {
+            // sparse blocks are left as holes
+            writeFileContents(&fs, inode, trv.entry.inode, imageId, mapping, fd, transferBuffer, target, pipelineDepth);
+
+            // set file stats
+            fchmod(fd, inode.base.mode & 07777);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+
+        if (close(fd) != 0)
+            throw IOError("close error at " + target);
+    }
+
+    /**
+    * create <target> from the copy of the file pointed by <inode> kept in the content store of <options>, the
+    * contents are streamed into the store first when they are not there
+    * @param inode file
+    * @param target path
+    * @param options
+    */
+    void storeFile(sqfs_inode inode, const std::string& target, const ExtractOptions& options) {
+        if (!contentStore || contentStorePath != options.contentStorePath ||
+            contentStoreReflinks != options.contentStoreReflinks) {
+            const auto linkMode = options.contentStoreReflinks ? appimage::utils::ContentStore::LinkMode::REFLINK
+                                                               : appimage::utils::ContentStore::LinkMode::HARD_LINK;
+            contentStore.reset(new appimage::utils::ContentStore(options.contentStorePath, linkMode));
+            contentStorePath = options.contentStorePath;
+            contentStoreReflinks = options.contentStoreReflinks;
+            contentStoreSourceId = appimage::utils::ContentStore::sourceId(fs.fd);
+        }
+
+        const auto size = inode.xtra.reg.file_size;
+        if (contentStore->linkStored(contentStoreSourceId, trv.entry.inode, size, target))
+            return;
+
+        StreambufType2 streambuf(&fs, &inode, trv.entry.inode, imageId, false, mapping);
+        contentStore->store(contentStoreSourceId, trv.entry.inode, size, inode.base.mode, streambuf, target);
     }
 
 
@@ -271,17 +470,25 @@ private:
     */
     void extractSymlink(sqfs_inode inode, const std::string& target) {
         // read the target link in buf
-        int ret = unlink(currentEntryLink.c_str());
+        const auto& linkTarget = getCurrentEntryLink();
+        int ret = unlink(linkTarget.c_str());
         if (ret != 0 && errno != ENOENT)
             throw IOError("unlink error at " + target);
 
-        ret = symlink(currentEntryLink.c_str(), target.c_str());
+        ret = symlink(linkTarget.c_str(), target.c_str());
         if (ret != 0)
             throw IOError("symlink error at " + target);
     }
 };
 
-TraversalType2::TraversalType2(std::string path) : d(new Priv(path)) {
+TraversalType2::TraversalType2(std::string path)
+    // read the offset at which a squashfs image is expected to start
+    : TraversalType2(path, appimage::utils::ElfFile(path).getSize(), nullptr) {}
+
+TraversalType2::TraversalType2(const std::string& path, off_t offset,
+                               std::shared_ptr<appimage::utils::MappedFile> mapping, const std::string& subdir,
+                               const PayloadFilter& filter)
+    : d(new Priv(path, offset, std::move(mapping), subdir, filter)) {
     // The traversal starts pointing to an empty entry, fetch first entry to be in a valid stated
     next();
 }
@@ -297,16 +504,36 @@ bool TraversalType2::isCompleted() const {
     return d->isCompleted();
 }
 
-std::string TraversalType2::getEntryPath() const {
+const std::string& TraversalType2::getEntryPath() const {
     return d->getCurrentEntryPath();
 }
 
+std::string_view TraversalType2::getEntryPathView() const {
+    return d->getCurrentEntryPathView();
+}
+
 appimage::core::PayloadEntryType TraversalType2::getEntryType() const {
     return d->getCurrentEntryType();
 }
 
-void TraversalType2::extract(const std::string& target) {
-    d->extract(target);
+appimage::core::PayloadEntryId TraversalType2::getEntryId() const {
+    return d->getCurrentEntryId();
+}
+
+uint64_t TraversalType2::getEntrySize() const {
+    return d->getCurrentEntrySize();
+}
+
+mode_t TraversalType2::getEntryMode() const {
+    return d->getCurrentEntryMode();
+}
+
+appimage::core::EntryStat TraversalType2::getEntryStat() const {
+    return d->getCurrentEntryStat();
+}
+
+void TraversalType2::extract(const std::string& target, const ExtractOptions& options) {
+    d->extract(target, options);
 }
 
 
@@ -315,6 +542,6 @@ istream& TraversalType2::read() {
 
 }
 
-string TraversalType2::getEntryLinkTarget() const {
+const string& TraversalType2::getEntryLinkTarget() const {
     return d->getCurrentEntryLink();
 }
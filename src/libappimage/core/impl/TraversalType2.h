@@ -4,7 +4,9 @@
 #include <memory>
 
 // local
+#include <appimage/core/PayloadFilter.h>
 #include "core/Traversal.h"
+#include "utils/MappedFile.h"
 #include "PayloadIStream.h"
 
 namespace appimage {
@@ -20,6 +22,20 @@ namespace appimage {
             public:
                 explicit TraversalType2(std::string path);
 
+                /**
+                 * Traverse the squashfs image located at <offset> inside the file at <path>
+                 * @param path
+                 * @param offset
+                 * @param mapping optional mapping of the whole file, used to read the data blocks
+                 * @param subdir directory at which the traversal starts, the image root if empty. The
+                 * directory itself is not reported but its entries keep their full paths.
+                 * @param filter entries to be reported, the directories that can't contain matches are pruned
+                 * @throw PayloadIteratorError if <subdir> doesn't exist or is not a directory
+                 */
+                TraversalType2(const std::string& path, off_t offset, std::shared_ptr<utils::MappedFile> mapping,
+                               const std::string& subdir = std::string(),
+                               const PayloadFilter& filter = PayloadFilter());
+
                 // Creating copies of this object is not allowed
                 TraversalType2(TraversalType2& other) = delete;
 
@@ -32,13 +48,23 @@ namespace appimage {
 
                 bool isCompleted() const override;
 
-                std::string getEntryPath() const override;
+                const std::string& getEntryPath() const override;
+
+                std::string_view getEntryPathView() const override;
 
-                std::string getEntryLinkTarget() const override;
+                const std::string& getEntryLinkTarget() const override;
 
                 PayloadEntryType getEntryType() const override;
 
-                void extract(const std::string& target) override;
+                PayloadEntryId getEntryId() const override;
+
+                uint64_t getEntrySize() const override;
+
+                mode_t getEntryMode() const override;
+
+                EntryStat getEntryStat() const override;
+
+                void extract(const std::string& target, const ExtractOptions& options) override;
 
                 std::istream& read() override;
 
@@ -15,7 +15,10 @@
 #include <XdgUtils/DesktopEntry/DesktopEntry.h>
 #include <appimage/utils/ResourcesExtractor.h>
 #include <appimage/core/AppImage.h>
+#include <appimage/core/AppImageInfo.h>
+#include <appimage/core/Scanner.h>
 #include <appimage/config.h>
+#include <appimage/appimage.h>
 #include "utils/Logger.h"
 #include "utils/hashlib.h"
 #include "utils/UrlEncoder.h"
@@ -23,7 +26,6 @@
 
 #ifdef LIBAPPIMAGE_DESKTOP_INTEGRATION_ENABLED
 #include <appimage/desktop_integration/IntegrationManager.h>
-#include <appimage/appimage.h>
 #endif
 
 using namespace appimage::core;
@@ -45,6 +47,184 @@ using namespace appimage::utils;
     } \
 }
 
+namespace {
+    char* dupOrNull(const std::string& value) {
+        return value.empty() ? nullptr : strdup(value.c_str());
+    }
+
+    char** dupStringList(const std::vector<std::string>& values) {
+        auto result = static_cast<char**>(malloc(sizeof(char*) * (values.size() + 1)));
+        for (size_t i = 0; i < values.size(); i++)
+            result[i] = strdup(values[i].c_str());
+
+        result[values.size()] = nullptr;
+        return result;
+    }
+
+    Scanner::Callback wrapScanCallback(appimage_scan_callback callback, void* user_data) {
+        typedef std::underlying_type<AppImageFormat>::type utype;
+
+        return [callback, user_data](const ScanResult& result) {
+            appimage_scan_result cResult = {};
+            cResult.path = result.path.c_str();
+            cResult.type = static_cast<utype>(result.format);
+            cResult.size = static_cast<off_t>(result.size);
+            cResult.mtime = result.mtime;
+            cResult.payload_offset = result.payloadOffset;
+
+            callback(&cResult, user_data);
+        };
+    }
+
+    char** listFiles(const std::vector<std::string>& paths) {
+        std::vector<std::string> files;
+        for (const auto& path : paths)
+            if (!path.empty())
+                files.emplace_back(path);
+
+        return dupStringList(files);
+    }
+
+    char** listFiles(const AppImage& appImage) {
+        std::vector<std::string> files;
+        // only the names are used, no inode is read
+        for (auto itr = appImage.files(); itr != itr.end(); ++itr) {
+            const auto path = itr.pathView();
+            if (!path.empty())
+                files.emplace_back(path);
+        }
+
+        return dupStringList(files);
+    }
+
+    void readFileIntoBuffer(const ResourcesExtractor& resourcesExtractor, const char* file_path, char** buffer,
+                            unsigned long* buf_size) {
+        auto fileData = resourcesExtractor.extract(file_path);
+
+        *buffer = static_cast<char*>(malloc(sizeof(char) * fileData.size()));
+        std::copy(fileData.begin(), fileData.end(), *buffer);
+
+        *buf_size = fileData.size();
+    }
+
+    appimage_info* getInfo(const AppImage& appImage) {
+        AppImageInfo info(appImage);
+
+        auto result = static_cast<appimage_info*>(calloc(1, sizeof(appimage_info)));
+        result->type = static_cast<int>(info.getFormat());
+        result->payload_offset = info.getPayloadOffset();
+        result->compression = dupOrNull(info.getCompression());
+        result->block_size = info.getBlockSize();
+        result->desktop_entry_path = dupOrNull(info.getDesktopEntryPath());
+        result->desktop_entry = dupOrNull(info.getDesktopEntry());
+        result->icon_paths = dupStringList(info.getIconPaths());
+        result->mime_type_packages_paths = dupStringList(info.getMimeTypePackagesPaths());
+        result->appstream_metainfo_path = dupOrNull(info.getAppStreamMetainfoPath());
+        result->appstream_metainfo = dupOrNull(info.getAppStreamMetainfo());
+        result->has_update_information_section = info.hasUpdateInformationSection();
+        result->has_signature_section = info.hasSignatureSection();
+
+        return result;
+    }
+
+    /**
+     * Load the main desktop entry, links are resolved. An empty entry is returned if there is none.
+     * @throw AppImageError if the desktop entry is empty
+     */
+    XdgUtils::DesktopEntry::DesktopEntry loadDesktopEntry(const ResourcesExtractor& extractor) {
+        std::string entryPath;
+        try {
+            entryPath = extractor.getDesktopEntryPath();
+        } catch (const AppImageError&) {
+            return {};
+        }
+
+        const auto contents = extractor.extractText(entryPath);
+
+        // empty desktop files are clearly an error
+        if (contents.empty())
+            throw AppImageError("Empty Desktop Entry: " + entryPath);
+
+        return XdgUtils::DesktopEntry::DesktopEntry(contents);
+    }
+
+    int shallNotBeIntegrated(const ResourcesExtractor& extractor) {
+        auto entry = loadDesktopEntry(extractor);
+
+        {
+            auto integrateEntryValue = entry.get("Desktop Entry/X-AppImage-Integrate", "true");
+
+            boost::to_lower(integrateEntryValue);
+            boost::algorithm::trim(integrateEntryValue);
+
+            if (integrateEntryValue == "false") {
+                return 1;
+            }
+        }
+
+        {
+            auto noDisplayValue = entry.get("Desktop Entry/NoDisplay", "false");
+
+            boost::to_lower(noDisplayValue);
+            boost::algorithm::trim(noDisplayValue);
+
+            if (noDisplayValue == "true") {
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    int isTerminalApp(const ResourcesExtractor& extractor) {
+        auto entry = loadDesktopEntry(extractor);
+
+        auto terminalEntryValue = entry.get("Desktop Entry/Terminal", "false");
+
+        boost::to_lower(terminalEntryValue);
+        boost::algorithm::trim(terminalEntryValue);
+
+        return terminalEntryValue == "true";
+    }
+}
+
+/**
+ * Opened AppImage. The AppImage instance caches the format, the ELF headers and the payload reader, the resources
+ * extractor holds the payload entries index.
+ */
+struct appimage_handle {
+    explicit appimage_handle(const char* path) : appImage(path) {}
+
+    AppImage appImage;
+
+    /**
+     * @return resources extractor of the AppImage, created on the first call
+     */
+    const ResourcesExtractor& getExtractor() {
+        if (!extractor)
+            extractor.reset(new ResourcesExtractor(appImage));
+
+        return *extractor;
+    }
+
+    /**
+     * @return md5 of the AppImage path, computed on the first call. Empty if it can't be computed.
+     */
+    const std::string& getMd5() {
+        if (!md5Ready) {
+            md5 = hashPath(appImage.getPath());
+            md5Ready = true;
+        }
+
+        return md5;
+    }
+
+private:
+    std::unique_ptr<ResourcesExtractor> extractor;
+    std::string md5;
+    bool md5Ready = false;
+};
+
 extern "C" {
 
 
@@ -58,31 +238,43 @@ int appimage_get_type(const char* path, bool) {
     return static_cast<utype>(AppImageFormat::INVALID);
 }
 
-char** appimage_list_files(const char* path) {
-    char** result = nullptr;
+bool appimage_scan_directory(const char* dir_path, unsigned int threads, appimage_scan_callback callback,
+                             void* user_data) {
     CATCH_ALL(
-        AppImage appImage(path);
+        ScanOptions options;
+        options.threads = threads;
 
-        std::vector<std::string> files;
-        for (auto itr = appImage.files(); itr != itr.end(); ++itr)
-            if (!(*itr).empty())
-                files.emplace_back(*itr);
+        Scanner(options).scanDirectory(dir_path, wrapScanCallback(callback, user_data));
+        return true;
+    );
 
+    return false;
+}
 
-        result = static_cast<char**>(malloc(sizeof(char*) * (files.size() + 1)));
-        for (int i = 0; i < files.size(); i++)
-            result[i] = strdup(files[i].c_str());
+bool appimage_scan_files(const char* const* paths, unsigned int threads, appimage_scan_callback callback,
+                         void* user_data) {
+    CATCH_ALL(
+        std::vector<std::string> pathsList;
+        for (auto ptr = paths; ptr != nullptr && *ptr != nullptr; ptr++)
+            pathsList.emplace_back(*ptr);
 
-        result[files.size()] = nullptr;
+        ScanOptions options;
+        options.threads = threads;
 
-        return result;
+        Scanner(options).scanFiles(pathsList, wrapScanCallback(callback, user_data));
+        return true;
     );
 
-    // Create empty string list
-    result = static_cast<char**>(malloc(sizeof(char*)));
-    result[0] = nullptr;
+    return false;
+}
 
-    return result;
+char** appimage_list_files(const char* path) {
+    CATCH_ALL(
+        return listFiles(AppImage(path));
+    );
+
+    // Create empty string list
+    return dupStringList({});
 }
 
 void appimage_string_list_free(char** list) {
@@ -92,6 +284,28 @@ void appimage_string_list_free(char** list) {
     free(list);
 }
 
+struct appimage_info* appimage_get_info(const char* path) {
+    CATCH_ALL(
+        return getInfo(AppImage(path));
+    );
+
+    return nullptr;
+}
+
+void appimage_info_free(struct appimage_info* info) {
+    if (info == nullptr)
+        return;
+
+    free(info->compression);
+    free(info->desktop_entry_path);
+    free(info->desktop_entry);
+    appimage_string_list_free(info->icon_paths);
+    appimage_string_list_free(info->mime_type_packages_paths);
+    free(info->appstream_metainfo_path);
+    free(info->appstream_metainfo);
+    free(info);
+}
+
 bool
 appimage_read_file_into_buffer_following_symlinks(const char* appimage_file_path, const char* file_path, char** buffer,
                                                   unsigned long* buf_size) {
@@ -101,14 +315,7 @@ appimage_read_file_into_buffer_following_symlinks(const char* appimage_file_path
 
     CATCH_ALL(
         AppImage appImage(appimage_file_path);
-        appimage::utils::ResourcesExtractor resourcesExtractor(appImage);
-
-        auto fileData = resourcesExtractor.extract(file_path);
-
-        *buffer = static_cast<char*>(malloc(sizeof(char) * fileData.size()));
-        std::copy(fileData.begin(), fileData.end(), *buffer);
-
-        *buf_size = fileData.size();
+        readFileIntoBuffer(ResourcesExtractor(appImage), file_path, buffer, buf_size);
 
         return true;
     );
@@ -126,6 +333,20 @@ void appimage_extract_file_following_symlinks(const char* appimage_file_path, co
     );
 }
 
+bool appimage_extract_all(const char* appimage_file_path, const char* target_dir, unsigned int threads) {
+    CATCH_ALL(
+        AppImage appImage(appimage_file_path);
+
+        ExtractOptions options;
+        options.threads = threads;
+        appImage.extractAll(target_dir, options);
+
+        return true;
+    );
+
+    return false;
+}
+
 
 /*
  * Checks whether an AppImage's desktop file has set X-AppImage-Integrate=false or NoDisplay=true.
@@ -136,102 +357,178 @@ void appimage_extract_file_following_symlinks(const char* appimage_file_path, co
 int appimage_shall_not_be_integrated(const char* path) {
     CATCH_ALL(
         AppImage appImage(path);
-        XdgUtils::DesktopEntry::DesktopEntry entry;
+        return shallNotBeIntegrated(ResourcesExtractor(appImage));
+    )
 
-        // Load Desktop Entry
-        for (auto itr = appImage.files(); itr != itr.end(); ++itr) {
-            const auto& entryPath = *itr;
-            if (entryPath.find(".desktop") != std::string::npos && entryPath.find('/') == std::string::npos) {
-                // use the resources extractor to make sure symlinks are resolved
-                ResourcesExtractor extractor(appImage);
+    return -1;
+}
 
-                const auto contents = extractor.extractText(entryPath);
 
-                // empty desktop files are clearly an error
-                if (contents.empty()) {
-                    return -1;
-                }
+/*
+ * Checks whether an AppImage's desktop file has set Terminal=true.
+ * Useful to check whether the author of an AppImage doesn't want it to be integrated.
+ *
+ * Returns >0 if set, 0 if not set, <0 on errors.
+ */
+int appimage_is_terminal_app(const char* path) {
+    CATCH_ALL(
+        AppImage appImage(path);
+        return isTerminalApp(ResourcesExtractor(appImage));
+    );
 
-                entry = std::move(XdgUtils::DesktopEntry::DesktopEntry(contents));
+    return -1;
+}
 
-                break;
-            }
-        }
 
-        {
-            auto integrateEntryValue = entry.get("Desktop Entry/X-AppImage-Integrate", "true");
+struct appimage_handle* appimage_open(const char* path) {
+    if (path == nullptr)
+        return nullptr;
 
-            boost::to_lower(integrateEntryValue);
-            boost::algorithm::trim(integrateEntryValue);
+    CATCH_ALL(
+        return new appimage_handle(path);
+    );
 
-            if (integrateEntryValue == "false") {
-                return 1;
-            }
-        }
+    return nullptr;
+}
 
-        {
-            auto noDisplayValue = entry.get("Desktop Entry/NoDisplay", "false");
+void appimage_close(struct appimage_handle* handle) {
+    delete handle;
+}
 
-            boost::to_lower(noDisplayValue);
-            boost::algorithm::trim(noDisplayValue);
+int appimage_handle_get_type(struct appimage_handle* handle) {
+    typedef std::underlying_type<AppImageFormat>::type utype;
+    if (handle == nullptr)
+        return static_cast<utype>(AppImageFormat::INVALID);
 
-            if (noDisplayValue == "true") {
-                return 1;
-            }
-        }
+    return static_cast<utype>(handle->appImage.getFormat());
+}
 
+off_t appimage_handle_get_payload_offset(struct appimage_handle* handle) {
+    if (handle == nullptr)
         return 0;
-    )
 
-    return -1;
+    CATCH_ALL(
+        return handle->appImage.getPayloadOffset();
+    );
+
+    return 0;
 }
 
+char** appimage_handle_list_files(struct appimage_handle* handle) {
+    if (handle != nullptr) {
+        CATCH_ALL(
+            // served from the entries index kept by the handle
+            return listFiles(handle->getExtractor().getEntriesPaths());
+        );
+    }
+
+    // Create empty string list
+    return dupStringList({});
+}
+
+bool appimage_handle_read_file_into_buffer_following_symlinks(struct appimage_handle* handle, const char* file_path,
+                                                              char** buffer, unsigned long* buf_size) {
+    // Init output params
+    *buffer = nullptr;
+    *buf_size = 0;
+
+    if (handle == nullptr)
+        return false;
 
-/*
- * Checks whether an AppImage's desktop file has set Terminal=true.
- * Useful to check whether the author of an AppImage doesn't want it to be integrated.
- *
- * Returns >0 if set, 0 if not set, <0 on errors.
- */
-int appimage_is_terminal_app(const char* path) {
     CATCH_ALL(
-        AppImage appImage(path);
+        readFileIntoBuffer(handle->getExtractor(), file_path, buffer, buf_size);
+        return true;
+    );
 
-        std::vector<char> data;
+    return false;
+}
 
-        XdgUtils::DesktopEntry::DesktopEntry entry;
+void appimage_handle_extract_file_following_symlinks(struct appimage_handle* handle, const char* file_path,
+                                                     const char* target_file_path) {
+    if (handle == nullptr)
+        return;
 
-        // Load Desktop Entry
-        for (auto itr = appImage.files(); itr != itr.end(); ++itr) {
-            const auto& entryPath = *itr;
-            if (entryPath.find(".desktop") != std::string::npos && entryPath.find('/') == std::string::npos) {
-                // use the resources extractor to make sure symlinks are resolved
-                ResourcesExtractor extractor(appImage);
+    CATCH_ALL(
+        handle->getExtractor().extractTo({{file_path, target_file_path}});
+    );
+}
 
-                const auto contents = extractor.extractText(entryPath);
+bool appimage_handle_extract_all(struct appimage_handle* handle, const char* target_dir, unsigned int threads) {
+    if (handle == nullptr)
+        return false;
 
-                // empty desktop files are clearly an error
-                if (contents.empty()) {
-                    return -1;
-                }
+    CATCH_ALL(
+        ExtractOptions options;
+        options.threads = threads;
+        handle->appImage.extractAll(target_dir, options);
 
-                entry = std::move(XdgUtils::DesktopEntry::DesktopEntry(contents));
+        return true;
+    );
 
-                break;
-            }
-        }
+    return false;
+}
 
-        auto terminalEntryValue = entry.get("Desktop Entry/Terminal", "false");
+struct appimage_info* appimage_handle_get_info(struct appimage_handle* handle) {
+    if (handle == nullptr)
+        return nullptr;
 
-        boost::to_lower(terminalEntryValue);
-        boost::algorithm::trim(terminalEntryValue);
+    CATCH_ALL(
+        return getInfo(handle->appImage);
+    );
 
-        return terminalEntryValue == "true";
+    return nullptr;
+}
+
+int appimage_handle_shall_not_be_integrated(struct appimage_handle* handle) {
+    if (handle == nullptr)
+        return -1;
+
+    CATCH_ALL(
+        return shallNotBeIntegrated(handle->getExtractor());
     );
 
     return -1;
 }
 
+int appimage_handle_is_terminal_app(struct appimage_handle* handle) {
+    if (handle == nullptr)
+        return -1;
+
+    CATCH_ALL(
+        return isTerminalApp(handle->getExtractor());
+    );
+
+    return -1;
+}
+
+char* appimage_handle_get_md5(struct appimage_handle* handle) {
+    if (handle == nullptr)
+        return nullptr;
+
+    CATCH_ALL(
+        return dupOrNull(handle->getMd5());
+    );
+
+    return nullptr;
+}
+
+char* appimage_handle_registered_desktop_file_path(struct appimage_handle* handle, bool verbose) {
+    if (handle == nullptr)
+        return nullptr;
+
+    CATCH_ALL(
+        const auto& md5 = handle->getMd5();
+        if (md5.empty())
+            return nullptr;
+
+        // the md5 is only read
+        return appimage_registered_desktop_file_path(handle->appImage.getPath().c_str(),
+                                                     const_cast<char*>(md5.c_str()), verbose);
+    );
+
+    return nullptr;
+}
+
 
 /* Return the md5 hash constructed according to
  * https://specifications.freedesktop.org/thumbnail-spec/thumbnail-spec-latest.html#THUMBSAVE
@@ -288,6 +585,24 @@ int appimage_register_in_system(const char* path, bool verbose) {
 }
 
 
+int appimage_handle_register_in_system(struct appimage_handle* handle, bool verbose) {
+    if (handle == nullptr)
+        return 1;
+
+    CATCH_ALL(
+        IntegrationManager manager;
+        manager.registerAppImage(handle->appImage);
+
+#ifdef LIBAPPIMAGE_THUMBNAILER_ENABLED
+        manager.generateThumbnails(handle->appImage);
+#endif // LIBAPPIMAGE_THUMBNAILER_ENABLED
+        return 0;
+    );
+
+    return 1;
+}
+
+
 /* Unregister an AppImage in the system */
 int appimage_unregister_in_system(const char* path, bool verbose) {
     if (path == nullptr)
@@ -306,6 +621,13 @@ int appimage_unregister_in_system(const char* path, bool verbose) {
     return 1;
 }
 
+int appimage_handle_unregister_in_system(struct appimage_handle* handle, bool verbose) {
+    if (handle == nullptr)
+        return 1;
+
+    return appimage_unregister_in_system(handle->appImage.getPath().c_str(), verbose);
+}
+
 /* Check whether AppImage is registered in the system already */
 bool appimage_is_registered_in_system(const char* path) {
     if (path == nullptr)
@@ -319,6 +641,13 @@ bool appimage_is_registered_in_system(const char* path) {
     return false;
 }
 
+bool appimage_handle_is_registered_in_system(struct appimage_handle* handle) {
+    if (handle == nullptr)
+        return false;
+
+    return appimage_is_registered_in_system(handle->appImage.getPath().c_str());
+}
+
 
 #ifdef LIBAPPIMAGE_THUMBNAILER_ENABLED
 /* Create AppImage thumbanil according to
@@ -335,6 +664,19 @@ bool appimage_create_thumbnail(const char* appimage_file_path, bool verbose) {
     return false;
 }
 
+bool appimage_handle_create_thumbnail(struct appimage_handle* handle, bool verbose) {
+    if (handle == nullptr)
+        return false;
+
+    CATCH_ALL(
+        IntegrationManager manager;
+        manager.generateThumbnails(handle->appImage);
+        return true;
+    );
+
+    return false;
+}
+
 #endif // LIBAPPIMAGE_THUMBNAILER_ENABLED
 #endif // LIBAPPIMAGE_DESKTOP_INTEGRATION_ENABLED
 
@@ -0,0 +1,598 @@
+// system
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+}
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#define APPIMAGE_HAS_IO_URING
+extern "C" {
+#include <linux/io_uring.h>
+}
+#endif
+
+// local
+#include <appimage/core/exceptions.h>
+#include "AsyncFileWriter.h"
+
+using namespace appimage::core;
+
+namespace appimage {
+    namespace utils {
+        namespace {
+            // Number of submission queue entries requested to the kernel, each file has at most one in flight
+            constexpr unsigned int IO_URING_ENTRIES = 64;
+
+            /**
+             * File waiting to be written
+             */
+            struct Request {
+                enum class Step {
+                    OPEN,
+                    WRITE,
+                    CLOSE,
+                };
+
+                std::string path;
+                mode_t mode;
+                std::vector<char> data;
+
+                Step step = Step::OPEN;
+                int fd = -1;
+                size_t written = 0;
+                bool failed = false;
+            };
+
+#ifdef APPIMAGE_HAS_IO_URING
+            /**
+             * Minimal io_uring instance driven through the raw system calls, so no additional library is
+             * required. Not thread safe.
+             */
+            class IoUring {
+            public:
+                /**
+                 * @param entries
+                 * @throw IOError if io_uring or the required operations are not supported
+                 */
+                explicit IoUring(unsigned int entries) {
+                    io_uring_params params = {};
+                    fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+                    if (fd < 0)
+                        throw IOError("io_uring_setup error");
+
+                    try {
+                        checkOperationsSupport();
+                        mapRings(params);
+                    } catch (...) {
+                        unmapRings();
+                        close(fd);
+                        throw;
+                    }
+                }
+
+                ~IoUring() {
+                    unmapRings();
+                    close(fd);
+                }
+
+                // Creating copies of this object is not allowed
+                IoUring(IoUring& other) = delete;
+
+                // Creating copies of this object is not allowed
+                IoUring& operator=(IoUring& other) = delete;
+
+                /**
+                 * @return number of operations that can be prepared before submitting them
+                 */
+                unsigned int capacity() const {
+                    return entries;
+                }
+
+                /**
+                 * Prepare a new operation, the caller must not exceed capacity() operations in flight.
+                 * @return zeroed submission queue entry
+                 */
+                io_uring_sqe* prepare() {
+                    const auto index = sqTail & *sqMask;
+                    auto sqe = &sqes[index];
+                    std::memset(sqe, 0, sizeof(io_uring_sqe));
+
+                    sqArray[index] = index;
+                    ++sqTail;
+                    return sqe;
+                }
+
+                /**
+                 * Submit the prepared operations and wait for at least <minComplete> completions.
+                 * @return 0 or a negated errno value
+                 */
+                int submit(unsigned int minComplete) {
+                    __atomic_store_n(sqTailPtr, sqTail, __ATOMIC_RELEASE);
+
+                    const auto toSubmit = sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+                    const unsigned int flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+                    if (syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0) < 0)
+                        return -errno;
+
+                    return 0;
+                }
+
+                /**
+                 * Call <handler> with the user data and result of each available completion.
+                 */
+                template<typename Handler>
+                void reap(Handler handler) {
+                    auto head = *cqHead;
+                    const auto tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+
+                    while (head != tail) {
+                        const auto& cqe = cqes[head & *cqMask];
+                        const auto userData = cqe.user_data;
+                        const auto result = cqe.res;
+
+                        // release the entry before handling it as the handler may prepare new operations
+                        ++head;
+                        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+                        handler(userData, result);
+                    }
+                }
+
+            private:
+                int fd = -1;
+                unsigned int entries = 0;
+
+                void* sqRing = MAP_FAILED;
+                size_t sqRingSize = 0;
+                void* cqRing = MAP_FAILED;
+                size_t cqRingSize = 0;
+                io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+                size_t sqesSize = 0;
+
+                unsigned int* sqHead = nullptr;
+                unsigned int* sqTailPtr = nullptr;
+                unsigned int* sqMask = nullptr;
+                unsigned int* sqArray = nullptr;
+                unsigned int sqTail = 0;
+
+                unsigned int* cqHead = nullptr;
+                unsigned int* cqTail = nullptr;
+                unsigned int* cqMask = nullptr;
+                io_uring_cqe* cqes = nullptr;
+
+                void checkOperationsSupport() {
+                    constexpr unsigned int OPS_COUNT = 256;
+                    std::vector<char> buffer(sizeof(io_uring_probe) + OPS_COUNT * sizeof(io_uring_probe_op), 0);
+                    auto probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+
+                    // probing was added along with the open and close operations, older kernels fail here
+                    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, OPS_COUNT) < 0)
+                        throw IOError("io_uring probe error");
+
+                    for (auto op : {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE}) {
+                        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+                            throw IOError("io_uring operation not supported");
+                    }
+                }
+
+                void mapRings(const io_uring_params& params) {
+                    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+                    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+                    // recent kernels map both rings with a single call
+                    const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                    if (singleMap)
+                        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+                    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                  IORING_OFF_SQ_RING);
+                    if (sqRing == MAP_FAILED)
+                        throw IOError("io_uring mmap error");
+
+                    if (singleMap) {
+                        cqRing = sqRing;
+                    } else {
+                        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                      IORING_OFF_CQ_RING);
+                        if (cqRing == MAP_FAILED)
+                            throw IOError("io_uring mmap error");
+                    }
+
+                    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                    auto sqesMapping = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                            fd, IORING_OFF_SQES);
+                    if (sqesMapping == MAP_FAILED)
+                        throw IOError("io_uring mmap error");
+
+                    sqes = static_cast<io_uring_sqe*>(sqesMapping);
+                    entries = params.sq_entries;
+
+                    auto sq = static_cast<char*>(sqRing);
+                    sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+                    sqTailPtr = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+                    sqMask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+                    sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+                    sqTail = *sqTailPtr;
+
+                    auto cq = static_cast<char*>(cqRing);
+                    cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+                    cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+                    cqMask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+                    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+                }
+
+                void unmapRings() {
+                    if (sqes != MAP_FAILED)
+                        munmap(sqes, sqesSize);
+
+                    if (cqRing != MAP_FAILED && cqRing != sqRing)
+                        munmap(cqRing, cqRingSize);
+
+                    if (sqRing != MAP_FAILED)
+                        munmap(sqRing, sqRingSize);
+                }
+            };
+#else
+            /**
+             * Placeholder for the platforms lacking io_uring, it can't be constructed.
+             */
+            class IoUring {
+            public:
+                explicit IoUring(unsigned int) {
+                    throw IOError("io_uring is not supported on this platform");
+                }
+            };
+#endif
+        }
+
+        class AsyncFileWriter::Private {
+        public:
+            Private(Backend backend, unsigned int threads, size_t maxPendingBytes)
+                : maxPendingBytes(maxPendingBytes) {
+                if (backend != Backend::THREADS) {
+                    try {
+                        ring.reset(new IoUring(IO_URING_ENTRIES));
+                    } catch (const IOError&) {
+                        // the kernel is too old or io_uring is disabled, use the threads instead
+                    }
+                }
+
+                if (ring) {
+                    usedBackend = Backend::IO_URING;
+                    workers.emplace_back(&Private::runIoUring, this);
+                } else {
+                    usedBackend = Backend::THREADS;
+                    if (threads == 0)
+                        threads = std::max(1u, std::thread::hardware_concurrency());
+
+                    for (unsigned int i = 0; i < threads; ++i)
+                        workers.emplace_back(&Private::runThread, this);
+                }
+            }
+
+            ~Private() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                requestsAvailable.notify_all();
+
+                for (auto& worker : workers)
+                    worker.join();
+            }
+
+            void push(const std::string& path, mode_t mode, std::vector<char> data) {
+                std::unique_lock<std::mutex> lock(mutex);
+
+                // a single request larger than the limit is accepted once nothing else is pending
+                spaceAvailable.wait(lock, [&] {
+                    return error || pendingBytes == 0 || pendingBytes + data.size() <= maxPendingBytes;
+                });
+
+                if (error)
+                    std::rethrow_exception(error);
+
+                pendingBytes += data.size();
+                ++pendingRequests;
+
+                std::unique_ptr<Request> request(new Request{path, mode, std::move(data)});
+                queue.emplace_back(std::move(request));
+                lock.unlock();
+
+                requestsAvailable.notify_one();
+            }
+
+            void finish() {
+                std::unique_lock<std::mutex> lock(mutex);
+                requestsCompleted.wait(lock, [&] { return pendingRequests == 0 || broken; });
+
+                if (error)
+                    std::rethrow_exception(error);
+            }
+
+            Backend usedBackend;
+
+        private:
+            size_t maxPendingBytes;
+
+            std::mutex mutex;
+            std::condition_variable requestsAvailable;
+            std::condition_variable spaceAvailable;
+            std::condition_variable requestsCompleted;
+
+            std::deque<std::unique_ptr<Request>> queue;
+            size_t pendingBytes = 0;
+            size_t pendingRequests = 0;
+            bool stopping = false;
+
+            // first error, the requests submitted after it are discarded
+            std::exception_ptr error;
+
+            // set when the io_uring instance can no longer be used
+            bool broken = false;
+
+            // requests used by io_uring operations, indexed by their user data. Declared before the ring so
+            // the buffers outlive any canceled operation
+            std::unordered_map<Request*, std::unique_ptr<Request>> inFlight;
+
+            std::unique_ptr<IoUring> ring;
+            std::vector<std::thread> workers;
+
+            void setError(std::exception_ptr newError) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::move(newError);
+            }
+
+            void complete(std::unique_ptr<Request> request) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    pendingBytes -= request->data.size();
+                    --pendingRequests;
+                }
+
+                spaceAvailable.notify_all();
+                requestsCompleted.notify_all();
+            }
+
+            /**
+             * Take the next request, blocks until there is one
+             * @return nullptr once the writer is being destroyed and the queue is empty
+             */
+            std::unique_ptr<Request> take() {
+                std::unique_lock<std::mutex> lock(mutex);
+                requestsAvailable.wait(lock, [&] { return !queue.empty() || stopping; });
+                if (queue.empty())
+                    return nullptr;
+
+                auto request = std::move(queue.front());
+                queue.pop_front();
+                return request;
+            }
+
+            bool hasError() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return bool(error);
+            }
+
+            void runThread() {
+                while (auto request = take()) {
+                    if (!hasError()) {
+                        try {
+                            writeFile(*request);
+                        } catch (...) {
+                            setError(std::current_exception());
+                        }
+                    }
+
+                    complete(std::move(request));
+                }
+            }
+
+            static void writeFile(const Request& request) {
+                int fd = open(request.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+                if (fd == -1)
+                    throw FileSystemError("Unable to open file: " + request.path);
+
+                size_t written = 0;
+                while (written < request.data.size()) {
+                    auto ret = ::write(fd, request.data.data() + written, request.data.size() - written);
+                    if (ret < 0 && errno == EINTR)
+                        continue;
+
+                    if (ret <= 0) {
+                        close(fd);
+                        throw IOError("write error at " + request.path);
+                    }
+
+                    written += (size_t) ret;
+                }
+
+                fchmod(fd, request.mode & 07777);
+
+                if (close(fd) != 0)
+                    throw IOError("close error at " + request.path);
+            }
+
+#ifdef APPIMAGE_HAS_IO_URING
+            void runIoUring() {
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+
+                        // new requests are picked up when the completions are reaped, sleep only when idle
+                        if (inFlight.empty())
+                            requestsAvailable.wait(lock, [&] { return !queue.empty() || stopping; });
+
+                        if (inFlight.empty() && queue.empty())
+                            break;
+
+                        while (!queue.empty() && inFlight.size() < ring->capacity()) {
+                            auto request = std::move(queue.front());
+                            queue.pop_front();
+
+                            if (error) {
+                                // complete() takes the lock
+                                lock.unlock();
+                                complete(std::move(request));
+                                lock.lock();
+                                continue;
+                            }
+
+                            prepareOpen(*request);
+                            auto key = request.get();
+                            inFlight.emplace(key, std::move(request));
+                        }
+                    }
+
+                    if (inFlight.empty())
+                        continue;
+
+                    // all the operations prepared since the last iteration are submitted in a single call
+                    int ret;
+                    while ((ret = ring->submit(1)) == -EINTR) {}
+
+                    if (ret < 0 && ret != -EAGAIN && ret != -EBUSY) {
+                        abortIoUring();
+                        return;
+                    }
+
+                    ring->reap([this](uint64_t userData, int32_t result) {
+                        onCompletion(reinterpret_cast<Request*>(userData), result);
+                    });
+                }
+            }
+
+            void prepareOpen(Request& request) {
+                request.step = Request::Step::OPEN;
+
+                auto sqe = ring->prepare();
+                sqe->opcode = IORING_OP_OPENAT;
+                sqe->fd = AT_FDCWD;
+                sqe->addr = (uint64_t) request.path.c_str();
+                sqe->len = 0600;
+                sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+                sqe->user_data = (uint64_t) &request;
+            }
+
+            void prepareWrite(Request& request) {
+                request.step = Request::Step::WRITE;
+
+                // large files may need several operations as the kernel can return short writes
+                const auto remaining = std::min<size_t>(request.data.size() - request.written, 1u << 30);
+
+                auto sqe = ring->prepare();
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->fd = request.fd;
+                sqe->addr = (uint64_t) (request.data.data() + request.written);
+                sqe->len = (uint32_t) remaining;
+                sqe->off = request.written;
+                sqe->user_data = (uint64_t) &request;
+            }
+
+            void prepareClose(Request& request) {
+                request.step = Request::Step::CLOSE;
+
+                auto sqe = ring->prepare();
+                sqe->opcode = IORING_OP_CLOSE;
+                sqe->fd = request.fd;
+                sqe->user_data = (uint64_t) &request;
+            }
+
+            void onCompletion(Request* key, int32_t result) {
+                auto& request = *key;
+
+                switch (request.step) {
+                    case Request::Step::OPEN:
+                        if (result < 0) {
+                            auto openError = FileSystemError("Unable to open file: " + request.path);
+                            setError(std::make_exception_ptr(openError));
+                            break;
+                        }
+
+                        request.fd = result;
+
+                        // io_uring has no fchmod operation, it's cheap compared to the open and write calls
+                        fchmod(request.fd, request.mode & 07777);
+
+                        if (request.data.empty())
+                            prepareClose(request);
+                        else
+                            prepareWrite(request);
+                        return;
+
+                    case Request::Step::WRITE:
+                        if (result <= 0) {
+                            setError(std::make_exception_ptr(IOError("write error at " + request.path)));
+                            request.failed = true;
+                            prepareClose(request);
+                            return;
+                        }
+
+                        request.written += (size_t) result;
+                        if (request.written < request.data.size())
+                            prepareWrite(request);
+                        else
+                            prepareClose(request);
+                        return;
+
+                    case Request::Step::CLOSE:
+                        if (result < 0 && !request.failed)
+                            setError(std::make_exception_ptr(IOError("close error at " + request.path)));
+                        break;
+                }
+
+                auto itr = inFlight.find(key);
+                auto owned = std::move(itr->second);
+                inFlight.erase(itr);
+                complete(std::move(owned));
+            }
+
+            /**
+             * Report the io_uring instance as unusable, the operations in flight are canceled when it's
+             * destroyed and their buffers are released along with this object.
+             */
+            void abortIoUring() {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::make_exception_ptr(IOError("io_uring_enter error"));
+
+                broken = true;
+                requestsCompleted.notify_all();
+                spaceAvailable.notify_all();
+            }
+#else
+            void runIoUring() {}
+#endif
+        };
+
+        AsyncFileWriter::AsyncFileWriter(Backend backend, unsigned int threads, size_t maxPendingBytes)
+            : d(new Private(backend, threads, maxPendingBytes)) {}
+
+        AsyncFileWriter::~AsyncFileWriter() = default;
+
+        AsyncFileWriter::Backend AsyncFileWriter::backend() const {
+            return d->usedBackend;
+        }
+
+        void AsyncFileWriter::write(const std::string& path, mode_t mode, std::vector<char> data) {
+            d->push(path, mode, std::move(data));
+        }
+
+        void AsyncFileWriter::finish() {
+            d->finish();
+        }
+    }
+}
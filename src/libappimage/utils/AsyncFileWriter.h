@@ -0,0 +1,80 @@
+#pragma once
+
+// system
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace appimage {
+    namespace utils {
+        /**
+         * Writes whole files in the background so the callers don't wait on the open, write, fchmod and close
+         * system calls, which dominate the extraction time of small files on high latency file systems.
+         *
+         * When the kernel supports it the requests are handed to io_uring in batches, keeping many of them in
+         * flight from a single thread. Otherwise they are written by a set of threads using blocking calls.
+         *
+         * The files contents are kept in memory until they are written. Callers are blocked while the
+         * pending contents exceed the configured limit.
+         */
+        class AsyncFileWriter {
+        public:
+            enum class Backend {
+                // io_uring when available, threads otherwise
+                AUTO,
+
+                IO_URING,
+
+                THREADS,
+            };
+
+            /**
+             * @param backend preferred backend, IO_URING falls back to THREADS when io_uring is not available
+             * @param threads threads used by the THREADS backend, 0 means one per available core
+             * @param maxPendingBytes size of the contents that may wait to be written
+             */
+            explicit AsyncFileWriter(Backend backend = Backend::AUTO, unsigned int threads = 0,
+                                     size_t maxPendingBytes = 64 * 1024 * 1024);
+
+            // Creating copies of this object is not allowed
+            AsyncFileWriter(AsyncFileWriter& other) = delete;
+
+            // Creating copies of this object is not allowed
+            AsyncFileWriter& operator=(AsyncFileWriter& other) = delete;
+
+            /**
+             * Waits for the pending requests, errors are discarded.
+             */
+            ~AsyncFileWriter();
+
+            /**
+             * @return backend in use
+             */
+            Backend backend() const;
+
+            /**
+             * Create or truncate the file at <path>, write <data> into it and set its permissions to <mode>.
+             * The parent directory must exist. Can be called from several threads.
+             *
+             * @param path
+             * @param mode
+             * @param data
+             * @throw IOError, FileSystemError reported by a previous request, once a request fails the next
+             * ones are discarded
+             */
+            void write(const std::string& path, mode_t mode, std::vector<char> data);
+
+            /**
+             * Wait for all the requests to be completed.
+             * @throw IOError, FileSystemError if any request failed
+             */
+            void finish();
+
+        private:
+            class Private;
+            std::unique_ptr<Private> d;
+        };
+    }
+}
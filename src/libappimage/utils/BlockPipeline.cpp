@@ -0,0 +1,119 @@
+// system
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// local
+#include "BlockPipeline.h"
+
+namespace appimage {
+    namespace utils {
+        BlockPipeline::BlockPipeline(unsigned int depth, size_t blockSize)
+            : depth(std::max(1u, depth)), blockSize(blockSize) {}
+
+        void BlockPipeline::run(const Producer& producer, const Consumer& consumer) const {
+            struct Block {
+                std::vector<char> data;
+                size_t size = 0;
+            };
+
+            // besides the queued ones a block is being consumed, the producer waits while all the others are queued
+            std::vector<Block> blocks(depth + 1);
+
+            std::deque<size_t> freeBlocks;
+            for (size_t i = 0; i < blocks.size(); ++i)
+                freeBlocks.push_back(i);
+
+            std::deque<size_t> filledBlocks;
+            bool produced = false;
+            bool failed = false;
+            std::exception_ptr error;
+
+            std::mutex mutex;
+            std::condition_variable changed;
+
+            auto setError = [&](std::exception_ptr newError) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                        error = std::move(newError);
+
+                    failed = true;
+                }
+                changed.notify_all();
+            };
+
+            std::thread consumerThread([&] {
+                try {
+                    while (true) {
+                        size_t index;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            changed.wait(lock, [&] { return !filledBlocks.empty() || produced || failed; });
+                            if (failed || filledBlocks.empty())
+                                return;
+
+                            index = filledBlocks.front();
+                            filledBlocks.pop_front();
+                        }
+
+                        consumer(blocks[index].data.data(), blocks[index].size);
+
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            freeBlocks.push_back(index);
+                        }
+                        changed.notify_all();
+                    }
+                } catch (...) {
+                    setError(std::current_exception());
+                }
+            });
+
+            try {
+                while (true) {
+                    size_t index;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        changed.wait(lock, [&] { return !freeBlocks.empty() || failed; });
+                        if (failed)
+                            break;
+
+                        index = freeBlocks.front();
+                        freeBlocks.pop_front();
+                    }
+
+                    // blocks are allocated on first use, short streams don't fill the whole pool
+                    auto& block = blocks[index];
+                    if (block.data.empty())
+                        block.data.resize(blockSize);
+
+                    block.size = producer(block.data.data(), blockSize);
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (block.size == 0)
+                            produced = true;
+                        else
+                            filledBlocks.push_back(index);
+                    }
+                    changed.notify_all();
+
+                    if (block.size == 0)
+                        break;
+                }
+            } catch (...) {
+                setError(std::current_exception());
+            }
+
+            consumerThread.join();
+
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// system
+#include <cstddef>
+#include <functional>
+
+namespace appimage {
+    namespace utils {
+        /**
+         * Overlaps the production of a stream of data blocks (i.e.: decompression) with their consumption
+         * (i.e.: writes to disk).
+         *
+         * The producer runs on the calling thread and fills blocks taken from a fixed pool, the consumer runs on
+         * a dedicated thread and drains them in the same order. The pool holds <depth> + 1 blocks: at most <depth>
+         * filled blocks wait to be consumed while another one is being consumed, once the pool is exhausted the
+         * producer waits for the consumer to release a block.
+         */
+        class BlockPipeline {
+        public:
+            /**
+             * Fill <block> with up to <capacity> bytes
+             * @return number of bytes written into the block, 0 once the stream is over
+             */
+            using Producer = std::function<size_t(char* block, size_t capacity)>;
+
+            using Consumer = std::function<void(const char* data, size_t size)>;
+
+            /**
+             * @param depth number of filled blocks that may wait to be consumed, at least 1
+             * @param blockSize
+             */
+            BlockPipeline(unsigned int depth, size_t blockSize);
+
+            /**
+             * Run <producer> until it reports the end of the stream, passing each block to <consumer>. Blocks
+             * until every block was consumed.
+             *
+             * Once any of the stages throws the other one is stopped and the first error is rethrown on the
+             * calling thread.
+             *
+             * @param producer
+             * @param consumer
+             */
+            void run(const Producer& producer, const Consumer& consumer) const;
+
+        private:
+            unsigned int depth;
+            size_t blockSize;
+        };
+    }
+}
@@ -0,0 +1,445 @@
+// system
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+}
+
+#if defined(__linux__) && __has_include(<linux/fs.h>)
+extern "C" {
+#include <linux/fs.h>
+}
+#endif
+
+// local
+#include <appimage/core/exceptions.h>
+#include "hashlib.h"
+#include "ContentStore.h"
+
+using namespace appimage::core;
+
+namespace appimage {
+    namespace utils {
+        namespace {
+            // Largest chunk of data read from the source streambufs or copied at once
+            constexpr size_t TRANSFER_BUFFER_SIZE = 1024 * 1024;
+
+            // Chunk size used to compare stored objects
+            constexpr size_t COMPARE_BUFFER_SIZE = 64 * 1024;
+
+            /**
+             * Closes the owned file descriptor when destroyed
+             */
+            class ScopedFd {
+            public:
+                explicit ScopedFd(int fd) : fd(fd) {}
+
+                ~ScopedFd() {
+                    if (fd != -1)
+                        ::close(fd);
+                }
+
+                // Creating copies of this object is not allowed
+                ScopedFd(ScopedFd& other) = delete;
+
+                // Creating copies of this object is not allowed
+                ScopedFd& operator=(ScopedFd& other) = delete;
+
+                /**
+                 * Close the file descriptor reporting the errors, writes may be reported at this point
+                 * @return false on error
+                 */
+                bool close() {
+                    const int ret = ::close(fd);
+                    fd = -1;
+                    return ret == 0;
+                }
+
+                int fd;
+            };
+
+            void writeAll(int fd, const char* data, size_t size, const std::string& path) {
+                while (size > 0) {
+                    auto written = write(fd, data, size);
+                    if (written < 0 && errno == EINTR)
+                        continue;
+
+                    if (written < 0)
+                        throw IOError("write error at " + path);
+
+                    data += written;
+                    size -= (size_t) written;
+                }
+            }
+
+            /**
+             * Read exactly <size> bytes at <offset>
+             * @return false if the file ends before
+             */
+            bool readAll(int fd, char* data, size_t size, off_t offset, const std::string& path) {
+                while (size > 0) {
+                    auto bytesRead = pread(fd, data, size, offset);
+                    if (bytesRead < 0 && errno == EINTR)
+                        continue;
+
+                    if (bytesRead < 0)
+                        throw IOError("read error at " + path);
+
+                    if (bytesRead == 0)
+                        return false;
+
+                    data += bytesRead;
+                    size -= (size_t) bytesRead;
+                    offset += bytesRead;
+                }
+
+                return true;
+            }
+
+            /**
+             * Compare the first <size> bytes of the files open at <fd> and <otherFd>
+             */
+            bool sameContents(int fd, int otherFd, uint64_t size, const std::string& path) {
+                std::vector<char> buffer(COMPARE_BUFFER_SIZE), otherBuffer(COMPARE_BUFFER_SIZE);
+
+                for (uint64_t offset = 0; offset < size; offset += buffer.size()) {
+                    const auto chunkSize = (size_t) std::min<uint64_t>(size - offset, buffer.size());
+                    if (!readAll(fd, buffer.data(), chunkSize, (off_t) offset, path) ||
+                        !readAll(otherFd, otherBuffer.data(), chunkSize, (off_t) offset, path) ||
+                        memcmp(buffer.data(), otherBuffer.data(), chunkSize) != 0)
+                        return false;
+                }
+
+                return true;
+            }
+
+            /**
+             * Copy <size> bytes from <sourceFd> to <targetFd>, the kernel copies them when both are on the same
+             * file system
+             */
+            void copyContents(int sourceFd, int targetFd, uint64_t size, const std::string& target) {
+                uint64_t position = 0;
+
+                while (position < size) {
+                    loff_t sourceOffset = (loff_t) position, targetOffset = (loff_t) position;
+                    auto copied = copy_file_range(sourceFd, &sourceOffset, targetFd, &targetOffset,
+                                                  (size_t) std::min<uint64_t>(size - position, SSIZE_MAX), 0);
+                    if (copied < 0 && errno == EINTR)
+                        continue;
+
+                    if (copied <= 0)
+                        break;
+
+                    position += (uint64_t) copied;
+                }
+
+                // not supported between these file systems, copy through user space
+                std::vector<char> buffer;
+                while (position < size) {
+                    buffer.resize((size_t) std::min<uint64_t>(size - position, TRANSFER_BUFFER_SIZE));
+                    if (!readAll(sourceFd, buffer.data(), buffer.size(), (off_t) position, target))
+                        throw IOError("Unexpected end of file while copying to " + target);
+
+                    if (pwrite(targetFd, buffer.data(), buffer.size(), (off_t) position) != (ssize_t) buffer.size())
+                        throw IOError("write error at " + target);
+
+                    position += buffer.size();
+                }
+            }
+
+            void removeFile(const std::string& path) {
+                if (unlink(path.c_str()) != 0 && errno != ENOENT)
+                    throw IOError("unlink error at " + path);
+            }
+
+            void createDir(const std::string& path) {
+                if (mkdir(path.c_str(), 0755) == -1 && errno != EEXIST)
+                    throw FileSystemError("mkdir error at " + path);
+            }
+
+            /**
+             * Create a temporary file in <dir>
+             * @return path of the file and its descriptor
+             */
+            std::pair<std::string, int> createTemporaryFile(const std::string& dir) {
+                std::string pathTemplate = dir + "/XXXXXX";
+                const int fd = mkostemp(&pathTemplate[0], O_CLOEXEC);
+                if (fd == -1)
+                    throw IOError("Unable to create a temporary file in " + dir);
+
+                return {pathTemplate, fd};
+            }
+        }
+
+        class ContentStore::Private {
+        public:
+            /**
+             * Objects recorded for an AppImage file
+             */
+            struct Source {
+                // object names by entry id
+                std::map<uint64_t, std::string> objects;
+
+                // there are records missing from the store
+                bool modified = false;
+            };
+
+            std::string path;
+            LinkMode linkMode;
+
+            std::mutex mutex;
+            std::map<std::string, Source> sources;
+
+            Private(const std::string& path, LinkMode linkMode) : path(path), linkMode(linkMode) {
+                std::error_code error;
+                std::filesystem::create_directories(path, error);
+                if (error)
+                    throw FileSystemError("Unable to create the store directory " + path + ": " + error.message());
+
+                createDir(objectsDir());
+                createDir(sourcesDir());
+                createDir(tmpDir());
+            }
+
+            std::string objectsDir() const { return path + "/objects"; }
+
+            std::string sourcesDir() const { return path + "/sources"; }
+
+            std::string tmpDir() const { return path + "/tmp"; }
+
+            std::string objectPath(const std::string& objectName) const {
+                return objectsDir() + "/" + objectName.substr(0, 2) + "/" + objectName.substr(2);
+            }
+
+            /**
+             * Records of <sourceId>, loaded from the store on first use. The mutex must be held.
+             */
+            Source& getSource(const std::string& sourceId) {
+                auto itr = sources.find(sourceId);
+                if (itr != sources.end())
+                    return itr->second;
+
+                auto& source = sources[sourceId];
+
+                // missing records are not an error, the source was not extracted before
+                std::ifstream input(sourcesDir() + "/" + sourceId);
+                uint64_t entryId;
+                std::string objectName;
+                while (input >> entryId >> objectName)
+                    source.objects[entryId] = objectName;
+
+                return source;
+            }
+
+            void record(const std::string& sourceId, uint64_t entryId, const std::string& objectName) {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                auto& source = getSource(sourceId);
+                source.objects[entryId] = objectName;
+                source.modified = true;
+            }
+
+            /**
+             * Create <target> from the file at <objectPath>, replacing any existing file
+             * @return false if <objectPath> doesn't exist
+             */
+            bool materialize(const std::string& objectPath, const std::string& target) const {
+                removeFile(target);
+
+                if (linkMode == LinkMode::HARD_LINK) {
+                    if (link(objectPath.c_str(), target.c_str()) == 0)
+                        return true;
+
+                    if (errno == ENOENT)
+                        return false;
+
+                    // other file system, too many links or hard links not supported
+                    if (errno != EXDEV && errno != EMLINK && errno != EPERM)
+                        throw IOError("link error at " + target);
+                }
+
+                ScopedFd source(open(objectPath.c_str(), O_RDONLY | O_CLOEXEC));
+                if (source.fd == -1) {
+                    if (errno == ENOENT)
+                        return false;
+
+                    throw IOError("Unable to open file: " + objectPath);
+                }
+
+                struct stat st = {};
+                if (fstat(source.fd, &st) != 0)
+                    throw IOError("fstat error at " + objectPath);
+
+                ScopedFd fd(open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600));
+                if (fd.fd == -1)
+                    throw FileSystemError("Unable to open file: " + target);
+
+#ifdef FICLONE
+                const bool cloned = linkMode == LinkMode::REFLINK && ioctl(fd.fd, FICLONE, source.fd) == 0;
+#else
+                const bool cloned = false;
+#endif
+                if (!cloned)
+                    copyContents(source.fd, fd.fd, (uint64_t) st.st_size, target);
+
+                fchmod(fd.fd, st.st_mode & 07777);
+
+                if (!fd.close())
+                    throw IOError("close error at " + target);
+
+                return true;
+            }
+
+            void saveSource(const std::string& sourceId, const Source& source) const {
+                std::stringstream records;
+                for (const auto& object : source.objects)
+                    records << object.first << ' ' << object.second << '\n';
+
+                // other processes may be reading the records, they are replaced at once
+                const auto tmpFile = createTemporaryFile(tmpDir());
+                ScopedFd fd(tmpFile.second);
+                try {
+                    const auto data = records.str();
+                    writeAll(fd.fd, data.data(), data.size(), tmpFile.first);
+                    fchmod(fd.fd, 0644);
+
+                    if (!fd.close())
+                        throw IOError("close error at " + tmpFile.first);
+
+                    const auto recordsPath = sourcesDir() + "/" + sourceId;
+                    if (rename(tmpFile.first.c_str(), recordsPath.c_str()) != 0)
+                        throw IOError("rename error at " + recordsPath);
+                } catch (...) {
+                    unlink(tmpFile.first.c_str());
+                    throw;
+                }
+            }
+        };
+
+        ContentStore::ContentStore(const std::string& path, LinkMode linkMode) : d(new Private(path, linkMode)) {}
+
+        ContentStore::~ContentStore() {
+            try {
+                save();
+            } catch (...) {
+                // the records are only a shortcut, the objects are stored already
+            }
+        }
+
+        std::string ContentStore::sourceId(int fd) {
+            struct stat st = {};
+            if (fstat(fd, &st) != 0)
+                throw IOError("fstat error");
+
+            std::stringstream id;
+            id << std::hex << st.st_dev << '-' << st.st_ino << '-' << st.st_size << '-'
+               << st.st_mtim.tv_sec << '.' << st.st_mtim.tv_nsec;
+
+            return id.str();
+        }
+
+        bool ContentStore::linkStored(const std::string& source, uint64_t entryId, uint64_t size,
+                                      const std::string& target) {
+            std::string objectName;
+            {
+                std::lock_guard<std::mutex> lock(d->mutex);
+
+                auto& objects = d->getSource(source).objects;
+                auto itr = objects.find(entryId);
+                if (itr == objects.end())
+                    return false;
+
+                objectName = itr->second;
+            }
+
+            // objects may be removed from the store to reclaim space, they are stored again then
+            const auto objectPath = d->objectPath(objectName);
+            struct stat st = {};
+            if (stat(objectPath.c_str(), &st) != 0 || (uint64_t) st.st_size != size)
+                return false;
+
+            return d->materialize(objectPath, target);
+        }
+
+        void ContentStore::store(const std::string& source, uint64_t entryId, uint64_t size, mode_t mode,
+                                 std::streambuf& data, const std::string& target) {
+            const auto tmpFile = createTemporaryFile(d->tmpDir());
+            ScopedFd fd(tmpFile.second);
+
+            try {
+                // hash the contents while they are written
+                hashlib::Md5 md5;
+                const auto bufferSize = std::max<uint64_t>(1, std::min<uint64_t>(size, TRANSFER_BUFFER_SIZE));
+                std::vector<char> buffer((size_t) bufferSize);
+                for (uint64_t remaining = size; remaining > 0;) {
+                    const auto chunkSize = (std::streamsize) std::min<uint64_t>(remaining, buffer.size());
+                    const auto bytesRead = data.sgetn(buffer.data(), chunkSize);
+                    if (bytesRead <= 0)
+                        throw IOError("Unable to read the data of " + target);
+
+                    md5.update(buffer.data(), (size_t) bytesRead);
+                    writeAll(fd.fd, buffer.data(), (size_t) bytesRead, tmpFile.first);
+                    remaining -= (uint64_t) bytesRead;
+                }
+
+                fchmod(fd.fd, mode & 07777);
+
+                std::stringstream objectName;
+                objectName << hashlib::toHex(md5.finish()) << '-' << size << '-' << std::oct << (mode & 07777);
+
+                const auto objectPath = d->objectPath(objectName.str());
+                createDir(objectPath.substr(0, objectPath.rfind('/')));
+
+                // link() doesn't replace existing objects, unlike rename()
+                bool stored = link(tmpFile.first.c_str(), objectPath.c_str()) == 0;
+                if (!stored) {
+                    if (errno != EEXIST)
+                        throw IOError("link error at " + objectPath);
+
+                    ScopedFd objectFd(open(objectPath.c_str(), O_RDONLY | O_CLOEXEC));
+                    stored = objectFd.fd != -1 && sameContents(fd.fd, objectFd.fd, size, objectPath);
+                }
+
+                if (!stored) {
+                    // the sums match but the contents don't, the file is extracted without being stored
+                    removeFile(target);
+                    if (rename(tmpFile.first.c_str(), target.c_str()) != 0 && !d->materialize(tmpFile.first, target))
+                        throw IOError("Unable to create " + target);
+                } else {
+                    if (!d->materialize(objectPath, target))
+                        throw IOError("Object removed while being linked: " + objectPath);
+
+                    d->record(source, entryId, objectName.str());
+                }
+            } catch (...) {
+                unlink(tmpFile.first.c_str());
+                throw;
+            }
+
+            unlink(tmpFile.first.c_str());
+        }
+
+        void ContentStore::save() {
+            std::lock_guard<std::mutex> lock(d->mutex);
+
+            for (auto& source : d->sources) {
+                if (!source.second.modified)
+                    continue;
+
+                d->saveSource(source.first, source.second);
+                source.second.modified = false;
+            }
+        }
+    }
+}
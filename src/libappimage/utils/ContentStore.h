@@ -0,0 +1,118 @@
+#pragma once
+
+// system
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <sys/types.h>
+
+namespace appimage {
+    namespace utils {
+        /**
+         * Content addressed storage of extracted files, shared by the extractions of many AppImages.
+         *
+         * Every regular file is written once into the store, named after the md5 sum of its contents, its size
+         * and its permissions. The extraction targets are then materialized as hard links or reflinks of the
+         * stored objects, so the files bundled by several AppImages (i.e.: the Qt, Electron or ICU libraries)
+         * take disk space only once.
+         *
+         * The sum is computed while the contents are streamed into a temporary file of the store. When an
+         * object with the same name exists already both are compared byte by byte before the temporary file
+         * is dropped, md5 is only used to find the candidates. Mismatching files are extracted without being
+         * stored.
+         *
+         * Objects are also remembered per source AppImage file (device, inode, size and modification time) and
+         * payload entry id. Extracting the same AppImage again links the known objects without decompressing
+         * nor hashing them, provided their size still matches. These records are saved in the store by save().
+         *
+         * Layout of the store directory:
+         *  - objects/<first two digits of the sum>/<rest of the sum>-<size>-<octal permissions>
+         *  - sources/<source id>, one "<entry id> <object name>" line per stored entry
+         *  - tmp/, files being written
+         *
+         * Hard linked targets share the inode of the stored object: modifying them in place alters the store
+         * and every other extraction. Use reflinks when the extracted files may be modified.
+         *
+         * All the methods can be called from several threads, several processes may share the same store.
+         */
+        class ContentStore {
+        public:
+            /**
+             * How the extraction targets are created from the stored objects
+             */
+            enum class LinkMode {
+                // Hard links, copies when the target is on another file system
+                HARD_LINK,
+
+                // Copy on write clones, copies when the file system doesn't support them (i.e.: not btrfs nor xfs)
+                REFLINK,
+            };
+
+            /**
+             * Open the store at <path>, its directories are created if missing
+             * @param path
+             * @param linkMode
+             * @throw FileSystemError if the store directories can't be created
+             */
+            explicit ContentStore(const std::string& path, LinkMode linkMode = LinkMode::HARD_LINK);
+
+            // Creating copies of this object is not allowed
+            ContentStore(ContentStore& other) = delete;
+
+            // Creating copies of this object is not allowed
+            ContentStore& operator=(ContentStore& other) = delete;
+
+            /**
+             * Calls save(), errors are discarded.
+             */
+            ~ContentStore();
+
+            /**
+             * Identify the source AppImage file open at <fd>
+             * @param fd
+             * @return id built from the device, inode, size and modification time of the file
+             * @throw IOError if the file can't be stat'ed
+             */
+            static std::string sourceId(int fd);
+
+            /**
+             * Materialize at <target> the object stored before for the entry <entryId> of <source>. Any file
+             * at <target> is replaced.
+             *
+             * @param source source id
+             * @param entryId
+             * @param size expected size of the entry contents
+             * @param target
+             * @return false if the entry is not known or its object is missing, it must be store()d then
+             * @throw IOError if the target can't be created
+             */
+            bool linkStored(const std::string& source, uint64_t entryId, uint64_t size, const std::string& target);
+
+            /**
+             * Store the <size> bytes read from <data> with the permissions in <mode> and materialize them at
+             * <target>. Any file at <target> is replaced.
+             *
+             * @param source source id
+             * @param entryId
+             * @param size
+             * @param mode
+             * @param data
+             * @param target
+             * @throw IOError if <data> is shorter than <size> or the store can't be written
+             */
+            void store(const std::string& source, uint64_t entryId, uint64_t size, mode_t mode,
+                       std::streambuf& data, const std::string& target);
+
+            /**
+             * Write the objects recorded for each source since the last call
+             * @throw IOError if the records can't be written
+             */
+            void save();
+
+        private:
+            class Private;
+            std::unique_ptr<Private> d;
+        };
+    }
+}
@@ -1,13 +1,11 @@
 // system
-extern "C" {
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/mman.h>
-#include <sys/types.h>
-}
+#include <algorithm>
+#include <cstring>
 
 // local
+#include "appimage/core/exceptions.h"
 #include "light_byteswap.h"
+#include "MappedFile.h"
 #include "ElfFile.h"
 
 #if __BYTE_ORDER == __LITTLE_ENDIAN
@@ -20,126 +18,380 @@ extern "C" {
 
 namespace appimage {
     namespace utils {
-        ElfFile::ElfFile(const std::string& path) : path(path), fname(path.c_str()), ehdr({0x0}) {}
+        namespace {
+            // Bounds of the ranged reads, keep broken headers from causing huge allocations
+            constexpr uint64_t MAX_PROGRAM_HEADERS_SIZE = 64 * 1024;
+            constexpr uint64_t MAX_DYNAMIC_SIZE = 1024 * 1024;
+            constexpr uint64_t MAX_NOTES_SIZE = 64 * 1024;
+            constexpr size_t MAX_STRING_SIZE = 4096;
+
+            // Strings are read in chunks of this size until their terminator is found
+            constexpr size_t STRING_CHUNK_SIZE = 256;
+
+            bool readExactly(const ElfFile::RangeReader& reader, uint64_t offset, char* buffer, size_t size) {
+                return reader(offset, buffer, size) == size;
+            }
+
+            /**
+             * Read the null terminated string at <offset>, the end of the table at <limit> isn't crossed
+             * @return false if the string is not terminated or too long
+             */
+            bool readString(const ElfFile::RangeReader& reader, uint64_t offset, uint64_t limit, std::string& value) {
+                value.clear();
+
+                char chunk[STRING_CHUNK_SIZE];
+                while (offset < limit && value.size() < MAX_STRING_SIZE) {
+                    const auto chunkSize = reader(offset, chunk, (size_t) std::min<uint64_t>(sizeof(chunk),
+                                                                                           limit - offset));
+                    if (chunkSize == 0)
+                        return false;
+
+                    const auto terminator = static_cast<const char*>(memchr(chunk, '\0', chunkSize));
+                    if (terminator != nullptr) {
+                        value.append(chunk, terminator - chunk);
+                        return true;
+                    }
+
+                    value.append(chunk, chunkSize);
+                    offset += chunkSize;
+                }
+
+                return false;
+            }
+
+            std::string toHex(const unsigned char* data, size_t size) {
+                static const char digits[] = "0123456789abcdef";
+
+                std::string hex;
+                hex.reserve(size * 2);
+                for (size_t i = 0; i < size; ++i) {
+                    hex += digits[data[i] >> 4];
+                    hex += digits[data[i] & 0xf];
+                }
 
-        uint16_t ElfFile::file16_to_cpu(uint16_t val) {
-            if (ehdr.e_ident[EI_DATA] != ELFDATANATIVE)
-                val = bswap_16(val);
-            return val;
+                return hex;
+            }
         }
 
-        uint32_t ElfFile::file32_to_cpu(uint32_t val) {
-            if (ehdr.e_ident[EI_DATA] != ELFDATANATIVE)
-                val = bswap_32(val);
-            return val;
+        ElfFile::ElfFile(const std::string& path) : path(path) {
+            try {
+                // only the pages holding the headers and the section names are actually read
+                MappedFile mapping(path);
+                read(mapping.data(), mapping.size());
+            } catch (const core::IOError& error) {
+                Logger::error(std::string("Cannot open ") + path + ": " + error.what());
+            }
         }
 
-        uint64_t ElfFile::file64_to_cpu(uint64_t val) {
-            if (ehdr.e_ident[EI_DATA] != ELFDATANATIVE)
-                val = bswap_64(val);
-            return val;
+        ElfFile::ElfFile(const char* data, size_t size) : path("<memory>") {
+            read(data, size);
         }
 
-        off_t ElfFile::read_elf32(FILE* fd) {
-            Elf32_Ehdr ehdr32;
-            Elf32_Shdr shdr32;
-            off_t last_shdr_offset;
-            ssize_t ret;
-            off_t sht_end, last_section_end;
-
-            fseeko(fd, 0, SEEK_SET);
-            ret = fread(&ehdr32, 1, sizeof(ehdr32), fd);
-            if (ret < 0 || (size_t) ret != sizeof(ehdr32)) {
-                fprintf(stderr, "Read of ELF header from %s failed: %s\n",
-                        fname, strerror(errno));
-                return -1;
-            }
+        bool ElfFile::isValid() const {
+            return size != -1;
+        }
 
-            ehdr.e_shoff = file32_to_cpu(ehdr32.e_shoff);
-            ehdr.e_shentsize = file16_to_cpu(ehdr32.e_shentsize);
-            ehdr.e_shnum = file16_to_cpu(ehdr32.e_shnum);
+        ssize_t ElfFile::getSize() const {
+            return size;
+        }
 
-            last_shdr_offset = ehdr.e_shoff + (ehdr.e_shentsize * (ehdr.e_shnum - 1));
-            fseeko(fd, last_shdr_offset, SEEK_SET);
-            ret = fread(&shdr32, 1, sizeof(shdr32), fd);
-            if (ret < 0 || (size_t) ret != sizeof(shdr32)) {
-                fprintf(stderr, "Read of ELF section header from %s failed: %s\n",
-                        fname, strerror(errno));
-                return -1;
-            }
+        bool ElfFile::findSection(const std::string& name, ElfFile::Section& section) const {
+            auto itr = sections.find(name);
+            if (itr == sections.end())
+                return false;
 
-            /* ELF ends either with the table of section headers (SHT) or with a section. */
-            sht_end = ehdr.e_shoff + (ehdr.e_shentsize * ehdr.e_shnum);
-            last_section_end = file64_to_cpu(shdr32.sh_offset) + file64_to_cpu(shdr32.sh_size);
-            return sht_end > last_section_end ? sht_end : last_section_end;
+            section = itr->second;
+            return true;
         }
 
-        off_t ElfFile::read_elf64(FILE* fd) {
-            Elf64_Ehdr ehdr64;
-            Elf64_Shdr shdr64;
-            off_t last_shdr_offset;
-            off_t ret;
-            off_t sht_end, last_section_end;
-
-            fseeko(fd, 0, SEEK_SET);
-            ret = fread(&ehdr64, 1, sizeof(ehdr64), fd);
-            if (ret < 0 || (size_t) ret != sizeof(ehdr64)) {
-                fprintf(stderr, "Read of ELF header from %s failed: %s\n",
-                        fname, strerror(errno));
-                return -1;
+        uint16_t ElfFile::getMachine() const {
+            return machine;
+        }
+
+        bool ElfFile::isLittleEndian() const {
+            return dataEncoding == ELFDATA2LSB;
+        }
+
+        template<typename T>
+        T ElfFile::toCpu(T val, unsigned char dataEncoding) {
+            if (dataEncoding == ELFDATANATIVE)
+                return val;
+
+            if constexpr (sizeof(T) == 1)
+                return val;
+            else if constexpr (sizeof(T) == 2)
+                return (T) bswap_16(val);
+            else if constexpr (sizeof(T) == 4)
+                return (T) bswap_32(val);
+            else
+                return (T) bswap_64(val);
+        }
+
+        template<typename T>
+        T ElfFile::fileToCpu(T val) const {
+            return toCpu(val, dataEncoding);
+        }
+
+        void ElfFile::read(const char* data, size_t dataSize) {
+            // this trick works as both 32 and 64 bit ELF files start with the e_ident[EI_NIDENT] section
+            if (data == nullptr || dataSize < EI_NIDENT) {
+                Logger::error("Read of e_ident from " + path + " failed");
+                return;
+            }
+
+            const auto ident = reinterpret_cast<const unsigned char*>(data);
+            if (ident[EI_DATA] != ELFDATA2LSB && ident[EI_DATA] != ELFDATA2MSB) {
+                Logger::error("Unknown ELF data order " + std::to_string(ident[EI_DATA]));
+                return;
             }
+            dataEncoding = ident[EI_DATA];
 
-            ehdr.e_shoff = file64_to_cpu(ehdr64.e_shoff);
-            ehdr.e_shentsize = file16_to_cpu(ehdr64.e_shentsize);
-            ehdr.e_shnum = file16_to_cpu(ehdr64.e_shnum);
+            if (ident[EI_CLASS] == ELFCLASS32)
+                size = readTables<Elf32_Ehdr, Elf32_Shdr>(data, dataSize);
+            else if (ident[EI_CLASS] == ELFCLASS64)
+                size = readTables<Elf64_Ehdr, Elf64_Shdr>(data, dataSize);
+            else
+                Logger::error("Unknown ELF class: " + std::to_string(ident[EI_CLASS]));
 
-            last_shdr_offset = ehdr.e_shoff + (ehdr.e_shentsize * (ehdr.e_shnum - 1));
-            fseeko(fd, last_shdr_offset, SEEK_SET);
-            ret = fread(&shdr64, 1, sizeof(shdr64), fd);
-            if (ret < 0 || ret != sizeof(shdr64)) {
-                Logger::error(std::string("Read of ELF section header from ") + fname
-                                             + " failed: " + strerror(errno));
+            if (size == -1) {
+                machine = 0;
+                sections.clear();
+            }
+        }
+
+        template<typename Ehdr, typename Shdr>
+        ssize_t ElfFile::readTables(const char* data, size_t dataSize) {
+            Ehdr ehdr;
+            if (dataSize < sizeof(ehdr)) {
+                Logger::error("Read of ELF header from " + path + " failed");
                 return -1;
             }
+            memcpy(&ehdr, data, sizeof(ehdr));
 
-            /* ELF ends either with the table of section headers (SHT) or with a section. */
-            sht_end = ehdr.e_shoff + (ehdr.e_shentsize * ehdr.e_shnum);
-            last_section_end = file64_to_cpu(shdr64.sh_offset) + file64_to_cpu(shdr64.sh_size);
-            return sht_end > last_section_end ? sht_end : last_section_end;
-        }
+            machine = fileToCpu(ehdr.e_machine);
 
-        ssize_t ElfFile::getSize() {
-            off_t ret;
-            FILE* fd = NULL;
-            off_t size = -1;
+            const uint64_t shoff = fileToCpu(ehdr.e_shoff);
+            const uint64_t shentsize = fileToCpu(ehdr.e_shentsize);
+            const uint64_t shnum = fileToCpu(ehdr.e_shnum);
+            const uint64_t shstrndx = fileToCpu(ehdr.e_shstrndx);
 
-            fd = fopen(fname, "rb");
-            if (fd == NULL) {
-                Logger::error(std::string("Cannot open ") + fname + ": " + strerror(errno));
+            /* ELF ends either with the table of section headers (SHT) or with a section. */
+            const uint64_t shtEnd = shoff + shentsize * shnum;
+            if (shnum == 0)
+                return (ssize_t) shtEnd;
+
+            if (shentsize < sizeof(Shdr) || shoff > dataSize || shtEnd > dataSize) {
+                Logger::error("Read of ELF section header from " + path + " failed");
                 return -1;
             }
-            ret = fread(ehdr.e_ident, 1, EI_NIDENT, fd);
-            if (ret != EI_NIDENT) {
-                Logger::error(std::string("Read of e_ident from ") + fname
-                                             + " failed: " + strerror(errno));
-                return -1;
+
+            auto readSectionHeader = [&](uint64_t index) {
+                Shdr shdr;
+                memcpy(&shdr, data + shoff + index * shentsize, sizeof(shdr));
+                return shdr;
+            };
+
+            const auto lastShdr = readSectionHeader(shnum - 1);
+            const uint64_t lastSectionEnd = (uint64_t) fileToCpu(lastShdr.sh_offset) + fileToCpu(lastShdr.sh_size);
+
+            // section names, a missing or broken string table only prevents the section lookups
+            const char* strTab = nullptr;
+            uint64_t strTabSize = 0;
+            if (shstrndx < shnum) {
+                const auto strTabShdr = readSectionHeader(shstrndx);
+                const uint64_t offset = fileToCpu(strTabShdr.sh_offset);
+                const uint64_t length = fileToCpu(strTabShdr.sh_size);
+
+                if (offset <= dataSize && length <= dataSize - offset) {
+                    strTab = data + offset;
+                    strTabSize = length;
+                }
             }
-            if ((ehdr.e_ident[EI_DATA] != ELFDATA2LSB) &&
-                (ehdr.e_ident[EI_DATA] != ELFDATA2MSB)) {
-                Logger::error("Unknown ELF data order " + std::to_string(ehdr.e_ident[EI_DATA]));
-                return -1;
+
+            if (strTab != nullptr) {
+                sections.reserve(shnum);
+
+                for (uint64_t i = 0; i < shnum; i++) {
+                    const auto shdr = readSectionHeader(i);
+
+                    const uint64_t nameOffset = fileToCpu(shdr.sh_name);
+                    if (nameOffset >= strTabSize)
+                        continue;
+
+                    const char* name = strTab + nameOffset;
+                    Section section;
+                    section.offset = fileToCpu(shdr.sh_offset);
+                    section.size = fileToCpu(shdr.sh_size);
+                    sections[std::string(name, strnlen(name, strTabSize - nameOffset))] = section;
+                }
             }
-            if (ehdr.e_ident[EI_CLASS] == ELFCLASS32) {
-                size = read_elf32(fd);
-            } else if (ehdr.e_ident[EI_CLASS] == ELFCLASS64) {
-                size = read_elf64(fd);
-            } else {
-                Logger::error("Unknown ELF class: " + std::to_string(ehdr.e_ident[EI_CLASS]));
-                return -1;
+
+            return (ssize_t) std::max(shtEnd, lastSectionEnd);
+        }
+
+        bool ElfFile::readDynamicInfo(const RangeReader& reader, DynamicInfo& info) {
+            info = DynamicInfo();
+
+            unsigned char ident[EI_NIDENT];
+            if (!readExactly(reader, 0, reinterpret_cast<char*>(ident), sizeof(ident)) ||
+                memcmp(ident, ELFMAG, SELFMAG) != 0)
+                return false;
+
+            const auto dataEncoding = ident[EI_DATA];
+            if (dataEncoding != ELFDATA2LSB && dataEncoding != ELFDATA2MSB)
+                return false;
+
+            info.elfClass = ident[EI_CLASS];
+            info.littleEndian = dataEncoding == ELFDATA2LSB;
+
+            if (info.elfClass == ELFCLASS32)
+                return readDynamicSegments<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn>(reader, dataEncoding, info);
+
+            if (info.elfClass == ELFCLASS64)
+                return readDynamicSegments<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn>(reader, dataEncoding, info);
+
+            return false;
+        }
+
+        template<typename Ehdr, typename Phdr, typename Dyn>
+        bool ElfFile::readDynamicSegments(const RangeReader& reader, unsigned char dataEncoding,
+                                          DynamicInfo& info) {
+            auto cpu = [dataEncoding](auto value) { return toCpu(value, dataEncoding); };
+
+            Ehdr ehdr;
+            if (!readExactly(reader, 0, reinterpret_cast<char*>(&ehdr), sizeof(ehdr)))
+                return false;
+
+            info.machine = cpu(ehdr.e_machine);
+
+            const uint64_t phoff = cpu(ehdr.e_phoff);
+            const uint64_t phentsize = cpu(ehdr.e_phentsize);
+            const uint64_t phnum = cpu(ehdr.e_phnum);
+            if (phnum == 0)
+                return true;
+
+            if (phentsize < sizeof(Phdr) || phentsize * phnum > MAX_PROGRAM_HEADERS_SIZE)
+                return false;
+
+            std::vector<char> programHeaders(phentsize * phnum);
+            if (!readExactly(reader, phoff, programHeaders.data(), programHeaders.size()))
+                return false;
+
+            std::vector<Phdr> segments(phnum);
+            for (uint64_t i = 0; i < phnum; ++i)
+                memcpy(&segments[i], programHeaders.data() + i * phentsize, sizeof(Phdr));
+
+            // the dynamic entries hold virtual addresses, the loaded segments allow to find them in the file
+            auto toFileOffset = [&](uint64_t address, uint64_t& offset) {
+                for (const auto& segment : segments) {
+                    const uint64_t vaddr = cpu(segment.p_vaddr);
+                    if (cpu(segment.p_type) == PT_LOAD && address >= vaddr && address - vaddr < cpu(segment.p_filesz)) {
+                        offset = cpu(segment.p_offset) + (address - vaddr);
+                        return true;
+                    }
+                }
+
+                return false;
+            };
+
+            for (const auto& segment : segments) {
+                const uint64_t type = cpu(segment.p_type);
+                const uint64_t offset = cpu(segment.p_offset);
+                const uint64_t fileSize = cpu(segment.p_filesz);
+
+                if (type == PT_NOTE && info.buildId.empty() && fileSize <= MAX_NOTES_SIZE) {
+                    std::vector<char> notes(fileSize);
+                    if (!readExactly(reader, offset, notes.data(), notes.size()))
+                        continue;
+
+                    // the note headers use 32 bits words on both classes, only the padding differs
+                    const uint64_t align = cpu(segment.p_align) == 8 ? 8 : 4;
+                    auto padded = [align](uint64_t size) { return (size + align - 1) & ~(align - 1); };
+
+                    uint64_t position = 0;
+                    while (position + sizeof(Elf32_Nhdr) <= notes.size()) {
+                        Elf32_Nhdr nhdr;
+                        memcpy(&nhdr, notes.data() + position, sizeof(nhdr));
+
+                        const uint64_t nameSize = cpu(nhdr.n_namesz);
+                        const uint64_t descSize = cpu(nhdr.n_descsz);
+                        const uint64_t namePosition = position + sizeof(nhdr);
+                        const uint64_t descPosition = namePosition + padded(nameSize);
+                        if (descPosition > notes.size() || descSize > notes.size() - descPosition)
+                            break;
+
+                        if (cpu(nhdr.n_type) == NT_GNU_BUILD_ID && nameSize == 4 &&
+                            memcmp(notes.data() + namePosition, "GNU", 4) == 0) {
+                            info.buildId = toHex(reinterpret_cast<const unsigned char*>(notes.data()) + descPosition,
+                                                 descSize);
+                            break;
+                        }
+
+                        position = descPosition + padded(descSize);
+                    }
+                } else if (type == PT_DYNAMIC && fileSize <= MAX_DYNAMIC_SIZE) {
+                    std::vector<Dyn> entries(fileSize / sizeof(Dyn));
+                    if (!readExactly(reader, offset, reinterpret_cast<char*>(entries.data()),
+                                     entries.size() * sizeof(Dyn)))
+                        return false;
+
+                    uint64_t strTabAddress = 0;
+                    uint64_t strTabSize = 0;
+                    uint64_t sonameOffset = 0;
+                    bool hasSoname = false;
+                    std::vector<uint64_t> neededOffsets;
+
+                    for (const auto& entry : entries) {
+                        const auto tag = (uint64_t) cpu(entry.d_tag);
+                        const uint64_t value = cpu(entry.d_val);
+
+                        if (tag == DT_NULL)
+                            break;
+
+                        switch (tag) {
+                            case DT_NEEDED:
+                                neededOffsets.emplace_back(value);
+                                break;
+                            case DT_SONAME:
+                                sonameOffset = value;
+                                hasSoname = true;
+                                break;
+                            case DT_STRTAB:
+                                strTabAddress = value;
+                                break;
+                            case DT_STRSZ:
+                                strTabSize = value;
+                                break;
+                            default:
+                                break;
+                        }
+                    }
+
+                    if (neededOffsets.empty() && !hasSoname)
+                        continue;
+
+                    uint64_t strTabOffset;
+                    if (!toFileOffset(strTabAddress, strTabOffset))
+                        return false;
+
+                    const uint64_t strTabEnd = strTabOffset + strTabSize;
+
+                    for (const auto neededOffset : neededOffsets) {
+                        std::string name;
+                        if (neededOffset >= strTabSize ||
+                            !readString(reader, strTabOffset + neededOffset, strTabEnd, name))
+                            return false;
+
+                        info.needed.emplace_back(std::move(name));
+                    }
+
+                    if (hasSoname && (sonameOffset >= strTabSize ||
+                                      !readString(reader, strTabOffset + sonameOffset, strTabEnd, info.soname)))
+                        return false;
+                }
             }
 
-            fclose(fd);
-            return size;
+            return true;
         }
     }
 }
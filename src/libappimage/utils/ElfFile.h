@@ -1,8 +1,12 @@
 #pragma once
 
 // system
+#include <cstdint>
+#include <functional>
 #include <string>
-#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
 
 // local
 #include "light_elf.h"
@@ -12,11 +16,67 @@ namespace appimage {
     namespace utils {
         /**
          * Utility class to read elf files. Not meant to be feature complete
+         *
+         * The ELF header, the section headers table and the section names are read once at construction
+         * time, from a mapping of the file, and kept in a hashed section table. Later queries don't touch
+         * the file. Errors are logged and leave the object in an invalid state, see isValid().
          */
         class ElfFile {
         public:
+            /**
+             * Location of a section inside the file
+             */
+            struct Section {
+                uint64_t offset = 0;
+                uint64_t size = 0;
+            };
+
+            /**
+             * Dynamic linking data of an ELF file, see readDynamicInfo()
+             */
+            struct DynamicInfo {
+                // e_machine field of the ELF header
+                uint16_t machine = 0;
+
+                // ELFCLASS32 or ELFCLASS64
+                unsigned char elfClass = 0;
+
+                bool littleEndian = false;
+
+                // DT_SONAME entry, empty if missing
+                std::string soname;
+
+                // DT_NEEDED entries, in the dynamic section order
+                std::vector<std::string> needed;
+
+                // contents of the GNU build id note as an hex string, empty if missing
+                std::string buildId;
+            };
+
+            /**
+             * Read up to <size> bytes at <offset> of the file into <buffer>
+             * @return number of bytes read, less than <size> only at the end of the file
+             */
+            using RangeReader = std::function<size_t(uint64_t offset, char* buffer, size_t size)>;
+
+            /**
+             * Read the elf file at <path>
+             * @param path
+             */
             explicit ElfFile(const std::string& path);
 
+            /**
+             * Read the elf file already loaded or mapped at <data>. The data is not referenced after the
+             * constructor returns.
+             * @param data
+             * @param size
+             */
+            ElfFile(const char* data, size_t size);
+
+            /**
+             * @return true if the ELF header and section headers table could be read
+             */
+            bool isValid() const;
 
             /*
              * Calculate the size of an ELF file on disk based on the information in its header
@@ -32,23 +92,60 @@ namespace appimage {
              *
              * e_shoff + ( e_shentsize * e_shnum ) =	126584
              */
-            ssize_t getSize();
+            ssize_t getSize() const;
+
+            /**
+             * Find the section called <name>. If several sections share the same name the last one is used.
+             * @param name
+             * @param section will be filled with the section location if found
+             * @return true if the section was found, false otherwise
+             */
+            bool findSection(const std::string& name, Section& section) const;
+
+            /**
+             * @return e_machine field of the ELF header, 0 if the file is not valid
+             */
+            uint16_t getMachine() const;
+
+            /**
+             * @return true if the file data is encoded in little endian
+             */
+            bool isLittleEndian() const;
+
+            /**
+             * Read the dynamic linking data of an ELF file through a few small ranged reads: the ELF header,
+             * the program headers, the dynamic segment, the strings it points to and the note segments. The
+             * section headers are not used, so the rest of the file is never read.
+             *
+             * Files without dynamic segment are valid, their <info> only holds the ELF header data.
+             *
+             * @param reader
+             * @param info will be filled with the file data
+             * @return false if the file is not an ELF file or its headers are broken, true otherwise
+             */
+            static bool readDynamicInfo(const RangeReader& reader, DynamicInfo& info);
 
         private:
             std::string path;
-            const char* fname;
-            Elf64_Ehdr ehdr;
-
-            uint16_t file16_to_cpu(uint16_t val);
+            unsigned char dataEncoding = 0;
+            uint16_t machine = 0;
+            ssize_t size = -1;
+            std::unordered_map<std::string, Section> sections;
 
-            uint32_t file32_to_cpu(uint32_t val);
+            template<typename T>
+            static T toCpu(T val, unsigned char dataEncoding);
 
-            uint64_t file64_to_cpu(uint64_t val);
+            template<typename T>
+            T fileToCpu(T val) const;
 
-            off_t read_elf32(FILE* fd);
+            void read(const char* data, size_t dataSize);
 
-            off_t read_elf64(FILE* fd);
+            template<typename Ehdr, typename Shdr>
+            ssize_t readTables(const char* data, size_t dataSize);
 
+            template<typename Ehdr, typename Phdr, typename Dyn>
+            static bool readDynamicSegments(const RangeReader& reader, unsigned char dataEncoding,
+                                            DynamicInfo& info);
         };
     }
 }
@@ -1,18 +1,38 @@
 // system
-#include <cstring>
 #include <algorithm>
-#include <iterator>
-#include <fstream>
-#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
 
 // local
 #include "MagicBytesChecker.h"
 
 using namespace appimage::utils;
 
-MagicBytesChecker::MagicBytesChecker(const std::string& path) : input(path, std::ios_base::binary) {}
+namespace {
+    /**
+     * Bytes expected at a given offset of the file
+     */
+    struct Signature {
+        size_t offset;
+        std::string_view bytes;
+
+        constexpr size_t end() const {
+            return offset + bytes.size();
+        }
+    };
+
+    // magic hex 0x7f 0x45 0x4c 0x46 at offset 0
+    constexpr Signature ELF_SIGNATURE = {0, {"\x7f" "ELF", 4}};
+
+    // magic hex 0x414901 at offset 8
+    constexpr Signature APPIMAGE_TYPE_1_SIGNATURE = {8, {"AI\x01", 3}};
+
+    // magic hex 0x414902 at offset 8
+    constexpr Signature APPIMAGE_TYPE_2_SIGNATURE = {8, {"AI\x02", 3}};
 
-bool MagicBytesChecker::hasIso9660Signature() {
     /* Implementation of the signature matches expressed at https://www.garykessler.net/library/file_sigs.html
      * Signature: 43 44 30 30 31 	  	= "CD001"
      * ISO 	  	ISO-9660 CD Disc Image
@@ -20,63 +40,77 @@ bool MagicBytesChecker::hasIso9660Signature() {
      * 34817 (0x8801), or 36865 (0x9001).
      * More information can be found at MacTech or at ECMA.
      */
+    constexpr Signature ISO9660_SIGNATURES[] = {
+        {32769, "CD001"},
+        {34817, "CD001"},
+        {36865, "CD001"},
+    };
+
+    constexpr size_t signaturesEnd() {
+        size_t end = std::max({ELF_SIGNATURE.end(), APPIMAGE_TYPE_1_SIGNATURE.end(),
+                               APPIMAGE_TYPE_2_SIGNATURE.end()});
+        for (const auto& signature : ISO9660_SIGNATURES)
+            end = std::max(end, signature.end());
 
-    if (input) {
-        off_t positions[] = {32769, 34817, 36865};
-        std::vector<char> signature = {'C', 'D', '0', '0', '1'};
-        for (int i = 0; i < 3; i++)
-            if (hasSignatureAt(input, signature, positions[i]))
-                return true;
+        return end;
     }
 
-    return false;
+    bool hasSignature(const char* data, size_t size, const Signature& signature) {
+        return data != nullptr && signature.end() <= size &&
+               memcmp(data + signature.offset, signature.bytes.data(), signature.bytes.size()) == 0;
+    }
 }
 
-bool MagicBytesChecker::hasElfSignature() {
-    if (input) {
-        // check magic hex 0x7f 0x45 0x4c 0x46 at offset 0
-        std::vector<char> signature = {0x7f, 0x45, 0x4c, 0x46};
-        if (hasSignatureAt(input, signature, 0))
-            return true;
-    }
-    return false;
+static_assert(signaturesEnd() <= MagicBytesChecker::WINDOW_SIZE, "The signatures window is too small");
+
+MagicBytesChecker::MagicBytesChecker(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return;
+
+    readWindow(fd);
+    close(fd);
 }
 
-bool MagicBytesChecker::hasAppImageType1Signature() {
-    if (input) {
-        // check magic hex 0x414901 at offset 8
-        std::vector<char> signature = {0x41, 0x49, 0x01};
-        if (hasSignatureAt(input, signature, 8))
-            return true;
-    }
-    return false;
+MagicBytesChecker::MagicBytesChecker(int fd) {
+    readWindow(fd);
 }
 
-bool MagicBytesChecker::hasAppImageType2Signature() {
-    if (input) {
-        // check magic hex 0x414902 at offset 8
-        std::vector<char> signature = {0x41, 0x49, 0x02};
-        if (hasSignatureAt(input, signature, 8))
-            return true;
+MagicBytesChecker::MagicBytesChecker(const char* data, size_t size) : data(data), dataSize(size) {}
+
+void MagicBytesChecker::readWindow(int fd) {
+    window.resize(WINDOW_SIZE);
+
+    size_t bytesRead = 0;
+    while (bytesRead < window.size()) {
+        auto ret = pread(fd, window.data() + bytesRead, window.size() - bytesRead, (off_t) bytesRead);
+        if (ret < 0 && errno == EINTR)
+            continue;
+
+        // short files end the window early, errors leave it empty
+        if (ret <= 0)
+            break;
+
+        bytesRead += (size_t) ret;
     }
-    return false;
+
+    data = window.data();
+    dataSize = bytesRead;
 }
 
-bool MagicBytesChecker::hasSignatureAt(std::ifstream& input, std::vector<char>& signature, off_t offset) {
-    try {
-        // move to the right offset in the file
-        input.seekg(offset, std::ios_base::beg);
+bool MagicBytesChecker::hasIso9660Signature() const {
+    return std::any_of(std::begin(ISO9660_SIGNATURES), std::end(ISO9660_SIGNATURES),
+                       [this](const Signature& signature) { return hasSignature(data, dataSize, signature); });
+}
 
-        for (int i = 0; i < signature.size() && input; i++) {
-            if (signature[i] != input.get())
-                return false;
-        }
+bool MagicBytesChecker::hasElfSignature() const {
+    return hasSignature(data, dataSize, ELF_SIGNATURE);
+}
 
-        if (input)
-            return true;
-        else
-            return false;
-    } catch (const std::ios_base::failure&) {}
+bool MagicBytesChecker::hasAppImageType1Signature() const {
+    return hasSignature(data, dataSize, APPIMAGE_TYPE_1_SIGNATURE);
+}
 
-    return false;
+bool MagicBytesChecker::hasAppImageType2Signature() const {
+    return hasSignature(data, dataSize, APPIMAGE_TYPE_2_SIGNATURE);
 }
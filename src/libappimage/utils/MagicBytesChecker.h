@@ -1,38 +1,68 @@
 #pragma once
 
 // system
+#include <cstddef>
 #include <string>
-#include <fstream>
 #include <vector>
 
 namespace appimage {
     namespace utils {
         /**
          * Allows the verification of magic bytes at in a given file.
+         *
+         * All the known signatures lie in the first WINDOW_SIZE bytes of the file. That window is read with
+         * a single pread() when the checker is created, the checks themselves don't perform any I/O.
          */
         class MagicBytesChecker {
         public:
+            /**
+             * Size of the file prefix covering all the known signatures, rounded up to the page size
+             */
+            static constexpr size_t WINDOW_SIZE = 40960;
+
+            /**
+             * Read the signatures window of the file at <path>. Files that can't be read don't match any
+             * signature.
+             * @param path
+             */
             explicit MagicBytesChecker(const std::string& path);
 
-            bool hasIso9660Signature();
+            /**
+             * Read the signatures window of the file opened at <fd>. The file offset is not modified.
+             * @param fd
+             */
+            explicit MagicBytesChecker(int fd);
+
+            /**
+             * Check the file contents already loaded or mapped at <data>. Only the first WINDOW_SIZE
+             * bytes are ever inspected.
+             * @param data
+             * @param size
+             */
+            MagicBytesChecker(const char* data, size_t size);
+
+            // Copies would point to the window of the original object
+            MagicBytesChecker(const MagicBytesChecker& other) = delete;
+
+            // Copies would point to the window of the original object
+            MagicBytesChecker& operator=(const MagicBytesChecker& other) = delete;
 
-            bool hasElfSignature();
+            bool hasIso9660Signature() const;
 
-            bool hasAppImageType1Signature();
+            bool hasElfSignature() const;
 
-            bool hasAppImageType2Signature();
+            bool hasAppImageType1Signature() const;
+
+            bool hasAppImageType2Signature() const;
 
         private:
-            std::ifstream input;
+            // file prefix, only used when the checker reads the file by itself
+            std::vector<char> window;
 
-            /**
-             * Verify if the input matches at <offset> with <signature>
-             * @param input
-             * @param signature
-             * @param offset
-             * @return true if there is a match, flase otherwise
-             */
-            bool hasSignatureAt(std::ifstream& input, std::vector<char>& signature, off_t offset);
+            const char* data = nullptr;
+            size_t dataSize = 0;
+
+            void readWindow(int fd);
         };
     }
 
@@ -0,0 +1,88 @@
+// system
+#include <algorithm>
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+}
+
+// local
+#include <appimage/core/exceptions.h>
+#include "MappedFile.h"
+
+namespace appimage {
+    namespace utils {
+        MappedFile::MappedFile(const std::string& path) {
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1)
+                throw core::IOError("Unable to open file: " + path);
+
+            struct stat st = {};
+            if (fstat(fd, &st) != 0) {
+                close(fd);
+                throw core::IOError("Unable to stat file: " + path);
+            }
+
+            length = (size_t) st.st_size;
+            if (length > 0) {
+                void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping == MAP_FAILED) {
+                    close(fd);
+                    throw core::IOError("Unable to map file: " + path);
+                }
+
+                address = static_cast<char*>(mapping);
+            }
+
+            // the mapping remains valid after closing the file descriptor
+            close(fd);
+        }
+
+        MappedFile::~MappedFile() {
+            if (address != nullptr)
+                munmap(address, length);
+        }
+
+        const char* MappedFile::data() const {
+            return address;
+        }
+
+        size_t MappedFile::size() const {
+            return length;
+        }
+
+        bool MappedFile::contains(off_t offset, size_t size) const {
+            return offset >= 0 && (size_t) offset <= length && size <= length - (size_t) offset;
+        }
+
+        void MappedFile::advise(MappedFile::Access access, off_t offset, size_t size) const {
+            if (address == nullptr || !contains(offset, 0))
+                return;
+
+            // madvise requires a page aligned address
+            static const auto pageSize = (off_t) sysconf(_SC_PAGESIZE);
+            const off_t alignedOffset = offset - offset % pageSize;
+
+            size_t alignedSize = size == 0 ? length - (size_t) offset : std::min(size, length - (size_t) offset);
+            alignedSize += (size_t) (offset - alignedOffset);
+
+            int advice;
+            switch (access) {
+                case Access::SEQUENTIAL:
+                    advice = MADV_SEQUENTIAL;
+                    break;
+                case Access::RANDOM:
+                    advice = MADV_RANDOM;
+                    break;
+                case Access::WILL_NEED:
+                    advice = MADV_WILLNEED;
+                    break;
+                default:
+                    advice = MADV_NORMAL;
+            }
+
+            madvise(address + alignedOffset, alignedSize, advice);
+        }
+    }
+}
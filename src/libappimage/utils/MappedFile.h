@@ -0,0 +1,75 @@
+#pragma once
+
+// system
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+
+namespace appimage {
+    namespace utils {
+        /**
+         * Read only memory mapping of a whole file.
+         *
+         * Once the pages are in the page cache reading from the mapping doesn't require any system call.
+         * The mapping is kept alive as long as the object exists, it's meant to be shared between all the
+         * components that read the same file.
+         */
+        class MappedFile {
+        public:
+            /**
+             * Expected access pattern, used to tune the kernel read ahead
+             */
+            enum class Access {
+                NORMAL,
+                SEQUENTIAL,
+                RANDOM,
+                WILL_NEED,
+            };
+
+            /**
+             * Map the file at <path>
+             * @param path
+             * @throw IOError if the file cannot be opened or mapped
+             */
+            explicit MappedFile(const std::string& path);
+
+            // Creating copies of this object is not allowed
+            MappedFile(MappedFile& other) = delete;
+
+            // Creating copies of this object is not allowed
+            MappedFile& operator=(MappedFile& other) = delete;
+
+            ~MappedFile();
+
+            /**
+             * @return start of the mapping, nullptr if the file is empty
+             */
+            const char* data() const;
+
+            /**
+             * @return size of the mapped file
+             */
+            size_t size() const;
+
+            /**
+             * @param offset
+             * @param length
+             * @return true if [<offset>, <offset> + <length>) lies inside the mapping
+             */
+            bool contains(off_t offset, size_t length) const;
+
+            /**
+             * Advise the kernel about how the region starting at <offset> will be accessed. A <length> of 0
+             * extends the region up to the end of the file. Failures are ignored as advices are only hints.
+             * @param access
+             * @param offset
+             * @param length
+             */
+            void advise(Access access, off_t offset = 0, size_t length = 0) const;
+
+        private:
+            char* address = nullptr;
+            size_t length = 0;
+        };
+    }
+}
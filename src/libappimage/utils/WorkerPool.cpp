@@ -0,0 +1,62 @@
+// system
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// local
+#include "WorkerPool.h"
+
+namespace appimage {
+    namespace utils {
+        WorkerPool::WorkerPool(unsigned int threads) : threads(threads) {
+            if (this->threads == 0)
+                this->threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        unsigned int WorkerPool::size() const {
+            return threads;
+        }
+
+        void WorkerPool::run(size_t jobsCount, const std::function<void(unsigned int, size_t)>& job) const {
+            std::atomic<size_t> nextJob{0};
+            std::atomic<bool> failed{false};
+            std::exception_ptr error;
+            std::mutex errorMutex;
+
+            auto work = [&](unsigned int worker) {
+                size_t jobId;
+                while (!failed && (jobId = nextJob++) < jobsCount) {
+                    try {
+                        job(worker, jobId);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        if (!error)
+                            error = std::current_exception();
+
+                        failed = true;
+                    }
+                }
+            };
+
+            // don't spawn threads that would have nothing to do
+            const auto workersCount = (unsigned int) std::min<size_t>(threads, jobsCount);
+
+            std::vector<std::thread> workers;
+            for (unsigned int i = 1; i < workersCount; ++i)
+                workers.emplace_back(work, i);
+
+            // the calling thread is used as the first worker
+            if (workersCount > 0)
+                work(0);
+
+            for (auto& worker : workers)
+                worker.join();
+
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+}
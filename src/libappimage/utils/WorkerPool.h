@@ -0,0 +1,43 @@
+#pragma once
+
+// system
+#include <cstddef>
+#include <functional>
+
+namespace appimage {
+    namespace utils {
+        /**
+         * Runs a batch of independent jobs over a fixed number of threads.
+         *
+         * Jobs are identified by their index and picked in ascending order, so the caller controls the
+         * execution order by sorting its jobs list. Each thread is identified by a worker index, which
+         * allows to keep per thread state (i.e.: file descriptors or decoder contexts) in a plain vector.
+         */
+        class WorkerPool {
+        public:
+            /**
+             * @param threads number of threads, 0 means one per available core
+             */
+            explicit WorkerPool(unsigned int threads = 0);
+
+            /**
+             * @return number of threads used to run the jobs
+             */
+            unsigned int size() const;
+
+            /**
+             * Run <job> for every index in [0, <jobsCount>). Blocks until all the jobs are completed.
+             *
+             * Once a job fails the remaining ones are skipped and the first error is rethrown on the
+             * calling thread.
+             *
+             * @param jobsCount
+             * @param job function receiving the worker index and the job index
+             */
+            void run(size_t jobsCount, const std::function<void(unsigned int worker, size_t job)>& job) const;
+
+        private:
+            unsigned int threads;
+        };
+    }
+}
@@ -1,4 +1,5 @@
 // system
+#include <algorithm>
 #include <cstring>
 #include <vector>
 #include <sstream>
@@ -16,21 +17,31 @@ namespace appimage {
     namespace utils {
         namespace hashlib {
 
-            std::vector<uint8_t> md5(std::istream& data) {
-                Md5Context md5_context;
-                Md5Initialise(&md5_context);
+            struct Md5::Context {
+                Md5Context md5Context;
+            };
 
-                // uint32_t type used to ensure that it's the maximum value
-                static const uint32_t chunk_size = 4096;
-                std::vector<char> buf(chunk_size);
+            Md5::Md5() : context(new Context()) {
+                Md5Initialise(&context->md5Context);
+            }
+
+            Md5::~Md5() = default;
 
-                uint32_t readCount;
-                while (data.read(buf.data(), buf.size()) || (readCount = static_cast<uint32_t>(data.gcount())) != 0)
-                    Md5Update(&md5_context, buf.data(), readCount); // feed buffer into checksum calculation
+            void Md5::update(const char* data, size_t size) {
+                // Md5Update takes at most an uint32_t worth of bytes per call
+                while (size > 0) {
+                    const auto chunkSize = static_cast<uint32_t>(std::min<size_t>(size, UINT32_MAX));
+                    Md5Update(&context->md5Context, data, chunkSize);
 
+                    data += chunkSize;
+                    size -= chunkSize;
+                }
+            }
+
+            std::vector<uint8_t> Md5::finish() {
                 // Finalise computation
                 MD5_HASH checksum;
-                Md5Finalise(&md5_context, &checksum);
+                Md5Finalise(&context->md5Context, &checksum);
 
                 // Extract digest string
                 std::vector<uint8_t> digest(16);
@@ -39,6 +50,19 @@ namespace appimage {
                 return digest;
             }
 
+            std::vector<uint8_t> md5(std::istream& data) {
+                Md5 md5;
+
+                static const size_t chunk_size = 4096;
+                std::vector<char> buf(chunk_size);
+
+                // the last chunk is usually incomplete, read() fails on it but gcount() reports its size
+                while (data.read(buf.data(), buf.size()) || data.gcount() != 0)
+                    md5.update(buf.data(), static_cast<size_t>(data.gcount())); // feed buffer into checksum calculation
+
+                return md5.finish();
+            }
+
             std::vector<uint8_t> md5(const std::string& data) {
                 std::stringstream ss(data);
                 return md5(ss);
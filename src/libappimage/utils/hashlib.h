@@ -1,8 +1,11 @@
 #pragma once
 
 // system
+#include <cstddef>
 #include <cstdint>
 #include <istream>
+#include <memory>
+#include <string>
 #include <vector>
 
 
@@ -12,6 +15,40 @@ namespace appimage {
          * C++ wrapper around the bare C hashing algorithms implementations
          */
         namespace hashlib {
+            /**
+             * Incremental md5 computation, for data that is produced in chunks (i.e.: while it's being
+             * decompressed or written)
+             */
+            class Md5 {
+            public:
+                Md5();
+
+                ~Md5();
+
+                // Creating copies of this object is not allowed
+                Md5(Md5& other) = delete;
+
+                // Creating copies of this object is not allowed
+                Md5& operator=(Md5& other) = delete;
+
+                /**
+                 * Feed <size> bytes at <data> into the sum
+                 * @param data
+                 * @param size
+                 */
+                void update(const char* data, size_t size);
+
+                /**
+                 * Complete the computation, no more data can be fed afterwards
+                 * @return md5 sum of the data fed so far
+                 */
+                std::vector<uint8_t> finish();
+
+            private:
+                struct Context;
+                std::unique_ptr<Context> context;
+            };
+
             /**
              * Convenience function to compute md5 sums from a std::istream
              * @param data
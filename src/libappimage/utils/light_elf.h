@@ -102,6 +102,38 @@ typedef struct elf64_shdr {
     Elf64_Xword sh_entsize; /* Entry size if section holds table */
 } Elf64_Shdr;
 
+typedef struct elf32_phdr {
+    Elf32_Word p_type;
+    Elf32_Off p_offset;
+    Elf32_Addr p_vaddr;
+    Elf32_Addr p_paddr;
+    Elf32_Word p_filesz;
+    Elf32_Word p_memsz;
+    Elf32_Word p_flags;
+    Elf32_Word p_align;
+} Elf32_Phdr;
+
+typedef struct elf64_phdr {
+    Elf64_Word p_type;
+    Elf64_Word p_flags;
+    Elf64_Off p_offset; /* Segment file offset */
+    Elf64_Addr p_vaddr; /* Segment virtual address */
+    Elf64_Addr p_paddr; /* Segment physical address */
+    Elf64_Xword p_filesz; /* Segment size in file */
+    Elf64_Xword p_memsz; /* Segment size in memory */
+    Elf64_Xword p_align; /* Segment alignment, file & memory */
+} Elf64_Phdr;
+
+typedef struct {
+    int32_t d_tag;
+    Elf32_Word d_val;
+} Elf32_Dyn;
+
+typedef struct {
+    int64_t d_tag; /* entry tag value */
+    Elf64_Xword d_val;
+} Elf64_Dyn;
+
 /* Note header in a PT_NOTE section */
 typedef struct elf32_note {
     Elf32_Word n_namesz; /* Name size */
@@ -109,6 +141,18 @@ typedef struct elf32_note {
     Elf32_Word n_type; /* Content type */
 } Elf32_Nhdr;
 
+#define PT_LOAD     1
+#define PT_DYNAMIC  2
+#define PT_NOTE     4
+
+#define DT_NULL     0
+#define DT_NEEDED   1
+#define DT_STRTAB   5
+#define DT_STRSZ    10
+#define DT_SONAME   14
+
+#define NT_GNU_BUILD_ID 3
+
 #define ELFCLASS32  1
 #define ELFDATA2LSB 1
 #define ELFDATA2MSB 2
@@ -116,6 +160,9 @@ typedef struct elf32_note {
 #define EI_CLASS    4
 #define EI_DATA     5
 
+#define ELFMAG      "\177ELF"
+#define SELFMAG     4
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,5 +33,22 @@ namespace appimage {
 
             return md5Str;
         }
+
+        std::string toDirPrefix(const std::string& path) {
+            std::string prefix;
+            std::string::size_type begin = 0;
+            while (begin < path.size()) {
+                auto end = path.find('/', begin);
+                if (end == std::string::npos)
+                    end = path.size();
+
+                if (end > begin && path.compare(begin, end - begin, ".") != 0)
+                    prefix.append(path, begin, end - begin).append("/");
+
+                begin = end + 1;
+            }
+
+            return prefix;
+        }
     }
 }
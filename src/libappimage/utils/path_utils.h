@@ -25,5 +25,13 @@ namespace appimage {
          * @return file hash
          */
         std::string hashPath(const std::filesystem::path& path);
+
+        /**
+         * Turn a relative directory <path> into the prefix shared by the paths of its entries. Empty and "."
+         * components are dropped and a single "/" is appended, "usr//share/" becomes "usr/share/".
+         * @param path
+         * @return directory prefix or an empty string if <path> points to the root
+         */
+        std::string toDirPrefix(const std::string& path);
     }
 }
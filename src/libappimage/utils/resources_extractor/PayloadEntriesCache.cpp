@@ -1,4 +1,5 @@
 // local
+#include <appimage/core/PayloadIndexCache.h>
 #include "PayloadEntriesCache.h"
 
 namespace appimage {
@@ -9,18 +10,19 @@ namespace appimage {
 
         std::vector<std::string> PayloadEntriesCache::getEntriesPaths() const {
             std::vector<std::string> paths;
-            for (const auto& item: entriesCache)
-                paths.emplace_back(item.first);
+            paths.reserve(entriesIndex->size());
+            for (size_t i = 0; i < entriesIndex->size(); ++i)
+                paths.emplace_back((*entriesIndex)[i].path);
 
             return paths;
         }
 
         appimage::core::PayloadEntryType PayloadEntriesCache::getEntryType(const std::string& path) const {
-            auto itr = entriesCache.find(path);
-            if (itr == entriesCache.end())
+            core::PayloadIndex::Entry entry;
+            if (!entriesIndex->find(path, entry))
                 throw core::PayloadIteratorError("Entry doesn't exists: " + path);
 
-            return itr->second;
+            return entry.type;
         }
 
         std::string PayloadEntriesCache::getEntryLinkTarget(const std::string& path) const {
@@ -35,7 +37,8 @@ namespace appimage {
         }
 
         void PayloadEntriesCache::buildCache() {
-            readAllEntries();
+            entriesIndex.reset(new core::PayloadIndex(appImage, core::PayloadIndexCache::isEnabled()));
+            readAllLinks();
             resolveLinks();
         }
 
@@ -59,12 +62,12 @@ namespace appimage {
             }
         }
 
-        void PayloadEntriesCache::readAllEntries() {
-            for (auto fileItr = appImage.files(); fileItr != fileItr.end(); ++fileItr) {
-                entriesCache[fileItr.path()] = fileItr.type();
+        void PayloadEntriesCache::readAllLinks() {
+            for (size_t i = 0; i < entriesIndex->size(); ++i) {
+                const auto entry = (*entriesIndex)[i];
 
-                if (fileItr.type() == core::PayloadEntryType::LINK)
-                    linksCache[fileItr.path()] = fileItr.linkTarget();
+                if (entry.type == core::PayloadEntryType::LINK)
+                    linksCache[std::string(entry.path)] = std::string(entry.linkTarget);
             }
         }
 
@@ -1,11 +1,13 @@
 #pragma once
 // system
 #include <map>
+#include <memory>
 #include <string>
 
 // local
 #include <appimage/core/AppImage.h>
 #include <appimage/core/exceptions.h>
+#include "core/PayloadIndex.h"
 
 
 namespace appimage {
@@ -14,6 +16,9 @@ namespace appimage {
          * Builds a cache of the entries contained in the AppImage payload. Include the entries path,
          * type and in case of a link link entry the link target. Solve links chains in order to ease
          * the lookup.
+         *
+         * The entries are read from a PayloadIndex. When the PayloadIndexCache is enabled the index is persistent,
+         * so the payload is only traversed the first time a given AppImage file is seen.
          */
         class PayloadEntriesCache {
         public:
@@ -46,18 +51,17 @@ namespace appimage {
         private:
             core::AppImage appImage;
             std::map<std::string, std::string> linksCache;
-            std::map<std::string, appimage::core::PayloadEntryType> entriesCache;
+            std::unique_ptr<core::PayloadIndex> entriesIndex;
 
             /**
-             * Iterate over all the entries in the AppImage and store all the link type entries
-             * and their targets inside linksCache.
+             * Load the payload index and store all the link type entries and their targets inside linksCache.
              */
             void buildCache();
 
             /**
              * Fill linksCache with the link file paths and their target
              */
-            void readAllEntries();
+            void readAllLinks();
 
             /**
              * Resolve links chains to ease the link target lookup.
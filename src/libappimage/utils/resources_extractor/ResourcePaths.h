@@ -0,0 +1,38 @@
+#pragma once
+
+// system
+#include <string>
+
+namespace appimage {
+    namespace utils {
+        /**
+         * Criteria used to identify the integration resources inside the AppImage payload
+         */
+        namespace resource_paths {
+            inline bool isIconFile(const std::string& fileName) {
+                return (fileName.find("usr/share/icons") != std::string::npos);
+            }
+
+            inline bool isMainDesktopFile(const std::string& fileName) {
+                return fileName.find(".desktop") != std::string::npos &&
+                       fileName.find('/') == std::string::npos;
+            }
+
+            inline bool hasPrefixAndSuffix(const std::string& fileName, const std::string& prefix,
+                                           const std::string& suffix) {
+                return fileName.size() > (prefix.size() + suffix.size()) &&
+                       !fileName.compare(0, prefix.size(), prefix) &&
+                       !fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix);
+            }
+
+            inline bool isMimeFile(const std::string& fileName) {
+                return hasPrefixAndSuffix(fileName, "usr/share/mime/packages/", ".xml");
+            }
+
+            inline bool isAppStreamMetainfoFile(const std::string& fileName) {
+                return hasPrefixAndSuffix(fileName, "usr/share/metainfo/", ".xml") ||
+                       hasPrefixAndSuffix(fileName, "usr/share/appdata/", ".xml");
+            }
+        }
+    }
+}
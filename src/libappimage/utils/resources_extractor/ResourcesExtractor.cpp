@@ -3,14 +3,18 @@
 #include <set>
 #include <fstream>
 #include <filesystem>
+#include <iostream>
+#include <optional>
 
 // libraries
 #include <XdgUtils/DesktopEntry/DesktopEntry.h>
 
 // local
+#include <appimage/core/exceptions.h>
 #include <appimage/core/PayloadEntryType.h>
 #include <appimage/desktop_integration/exceptions.h>
 #include "PayloadEntriesCache.h"
+#include "ResourcePaths.h"
 #include <appimage/utils/ResourcesExtractor.h>
 
 
@@ -29,29 +33,37 @@ namespace appimage {
             PayloadEntriesCache entriesCache;
 
             static bool isIconFile(const std::string& fileName) {
-                return (fileName.find("usr/share/icons") != std::string::npos);
+                return resource_paths::isIconFile(fileName);
             }
 
             static bool isMainDesktopFile(const std::string& fileName) {
-                return fileName.find(".desktop") != std::string::npos &&
-                       fileName.find('/') == std::string::npos;
+                return resource_paths::isMainDesktopFile(fileName);
             }
 
             static bool isMimeFile(const std::string& fileName) {
-                const std::string prefix = "usr/share/mime/packages/";
-                const std::string suffix = ".xml";
+                return resource_paths::isMimeFile(fileName);
+            }
+
+            /**
+             * Read the whole contents of <entry> into a buffer allocated once from the entry size
+             */
+            template<typename Buffer>
+            static Buffer readEntry(PayloadEntry& entry) {
+                Buffer buffer(entry.size(), '\0');
+
+                auto& istream = entry.read();
+                istream.read(buffer.data(), (std::streamsize) buffer.size());
+                buffer.resize((size_t) istream.gcount());
 
-                return !fileName.compare(0, prefix.size(), prefix) &&
-                       !fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) &&
-                       fileName.size() > (prefix.size() + suffix.size());
+                return buffer;
             }
 
-            static std::vector<char> readDataFile(std::istream& istream) {
-                return {std::istreambuf_iterator<char>(istream), std::istreambuf_iterator<char>()};
+            static std::vector<char> readDataFile(PayloadEntry& entry) {
+                return readEntry<std::vector<char>>(entry);
             }
 
-            static std::string readTextFile(std::istream& istream) {
-                return {std::istreambuf_iterator<char>(istream), std::istreambuf_iterator<char>()};
+            static std::string readTextFile(PayloadEntry& entry) {
+                return readEntry<std::string>(entry);
             }
         };
 
@@ -95,20 +107,24 @@ namespace appimage {
                 }
             }
 
-            // we need to iterate over all file paths in the AppImage
-            for (auto sourceFileItr = d->appImage.files(); sourceFileItr != sourceFileItr.end(); ++sourceFileItr) {
-                // check if we have to extract the file by looking into the real targets map
-                const auto targetsMapEntry = realTargetsMap.find(sourceFileItr.path());
-
-                // if the file isn't relevant for us, we can skip it
-                if (targetsMapEntry == realTargetsMap.end()) {
+            for (const auto& target : realTargetsMap) {
+                // look up the entry directly instead of traversing the whole payload, links may point to missing
+                // files or outside of the payload, those targets are skipped
+                std::optional<PayloadEntry> lookedUpEntry;
+                try {
+                    lookedUpEntry.emplace(d->appImage.lookup(target.first));
+                } catch (const PayloadIteratorError&) {
                     continue;
                 }
 
+                auto& entry = *lookedUpEntry;
+                if (entry.type() != PayloadEntryType::REGULAR)
+                    continue;
+
                 // begin extraction
-                std::filesystem::path targetPath(targetsMapEntry->second);
+                std::filesystem::path targetPath(target.second);
 
-                std::cout << "Extracting " << sourceFileItr.path() << " to " << targetPath << std::endl;
+                std::cout << "Extracting " << entry.path() << " to " << targetPath << std::endl;
 
                 // create parent dirs
                 const auto parentDirPath = targetPath.parent_path();
@@ -116,7 +132,7 @@ namespace appimage {
 
                 // write file contents
                 std::ofstream file(targetPath.string());
-                file << sourceFileItr.read().rdbuf();
+                file << entry.read().rdbuf();
 
                 file.close();
             }
@@ -128,12 +144,8 @@ namespace appimage {
             if (d->entriesCache.getEntryType(path) == PayloadEntryType::LINK)
                 regularEntryPath = d->entriesCache.getEntryLinkTarget(path);
 
-            for (auto fileItr = d->appImage.files(); fileItr != fileItr.end(); ++fileItr) {
-                if (fileItr.path() == regularEntryPath)
-                    return d->readDataFile(fileItr.read());
-            }
-
-            throw core::PayloadIteratorError("Entry doesn't exists: " + path);
+            auto entry = d->appImage.lookup(regularEntryPath);
+            return d->readDataFile(entry);
         }
 
         std::map<std::string, std::vector<char>>
@@ -147,12 +159,11 @@ namespace appimage {
                     reverseLinks[path] = path;
 
             std::map<std::string, std::vector<char>> result;
-            for (auto fileItr = d->appImage.files(); fileItr != fileItr.end(); ++fileItr) {
-                auto itr = reverseLinks.find(fileItr.path());
+            for (const auto& itr : reverseLinks) {
+                auto entry = d->appImage.lookup(itr.first);
 
                 // extract the file data and store it using the original path
-                if (itr != reverseLinks.end())
-                    result[itr->second] = d->readDataFile(fileItr.read());
+                result[itr.second] = d->readDataFile(entry);
             }
 
             return result;
@@ -165,20 +176,21 @@ namespace appimage {
             if (d->entriesCache.getEntryType(path) == PayloadEntryType::LINK)
                 regularEntryPath = d->entriesCache.getEntryLinkTarget(path);
 
-            for (auto fileItr = d->appImage.files(); fileItr != fileItr.end(); ++fileItr) {
-                if (fileItr.path() == regularEntryPath)
-                    return d->readTextFile(fileItr.read());
-            }
-
-            throw core::PayloadIteratorError("Entry doesn't exists: " + path);
+            auto entry = d->appImage.lookup(regularEntryPath);
+            return d->readTextFile(entry);
         }
 
         std::string ResourcesExtractor::getDesktopEntryPath() const {
-            for (auto fileItr = d->appImage.files(); fileItr != fileItr.end(); ++fileItr)
-                if (d->isMainDesktopFile(fileItr.path()))
-                    return fileItr.path();
+            // the entries index is already built, no need to traverse the payload again
+            for (const auto& filePath: d->entriesCache.getEntriesPaths())
+                if (d->isMainDesktopFile(filePath))
+                    return filePath;
 
             throw AppImageError("Missing Desktop Entry");
         }
+
+        std::vector<std::string> ResourcesExtractor::getEntriesPaths() const {
+            return d->entriesCache.getEntriesPaths();
+        }
     }
 }
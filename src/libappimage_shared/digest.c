@@ -7,17 +7,14 @@
 
 bool appimage_type2_digest_md5(const char* path, char* digest) {
     // skip digest, signature and key sections in digest calculation
-    unsigned long digest_md5_offset = 0, digest_md5_length = 0;
-    if (!appimage_get_elf_section_offset_and_length(path, ".digest_md5", &digest_md5_offset, &digest_md5_length))
+    static const char* const section_names[] = {".digest_md5", ".sha256_sig", ".sig_key"};
+    unsigned long offsets[3] = {0, 0, 0}, lengths[3] = {0, 0, 0};
+    if (!appimage_get_elf_sections_offset_and_length(path, section_names, 3, offsets, lengths))
         return false;
 
-    unsigned long signature_offset = 0, signature_length = 0;
-    if (!appimage_get_elf_section_offset_and_length(path, ".sha256_sig", &signature_offset, &signature_length))
-        return false;
-
-    unsigned long sig_key_offset = 0, sig_key_length = 0;
-    if (!appimage_get_elf_section_offset_and_length(path, ".sig_key", &sig_key_offset, &sig_key_length))
-        return false;
+    const unsigned long digest_md5_offset = offsets[0], digest_md5_length = lengths[0];
+    const unsigned long signature_offset = offsets[1], signature_length = lengths[1];
+    const unsigned long sig_key_offset = offsets[2], sig_key_length = lengths[2];
 
     Md5Context md5_context;
     Md5Initialise(&md5_context);
@@ -118,57 +118,142 @@ static off_t read_elf64(FILE* fd)
 }
 
 
-/* Return the offset, and the length of an ELF section with a given name in a given ELF file */
-bool appimage_get_elf_section_offset_and_length(const char* fname, const char* section_name, unsigned long* offset, unsigned long* length) {
-	uint8_t* data;
-	int i;
-	int fd = open(fname, O_RDONLY);
-	size_t map_size = (size_t) lseek(fd, 0, SEEK_END);
+static uint16_t data16_to_cpu(bool swap, uint16_t val)
+{
+	return swap ? bswap_16(val) : val;
+}
 
-	data = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
-	close(fd);
+static uint32_t data32_to_cpu(bool swap, uint32_t val)
+{
+	return swap ? bswap_32(val) : val;
+}
+
+static uint64_t data64_to_cpu(bool swap, uint64_t val)
+{
+	return swap ? bswap_64(val) : val;
+}
+
+/* Look up <count> sections by name in the ELF file mapped at <data>, the section headers are walked once */
+static bool find_sections(const uint8_t* data, size_t size, const char* const* section_names, size_t count,
+                          unsigned long* offsets, unsigned long* lengths)
+{
+	uint64_t shoff, shentsize, shnum, shstrndx, strtab_offset, strtab_size, i;
+	size_t j;
+	bool swap;
+
+	if (size < EI_NIDENT || (data[EI_DATA] != ELFDATA2LSB && data[EI_DATA] != ELFDATA2MSB)) {
+		fprintf(stderr, "Invalid ELF header\n");
+		return false;
+	}
+	swap = data[EI_DATA] != ELFDATANATIVE;
 
 	// this trick works as both 32 and 64 bit ELF files start with the e_ident[EI_NINDENT] section
 	unsigned char class = data[EI_CLASS];
 
-	if (class == ELFCLASS32) {
-		Elf32_Ehdr* elf;
-		Elf32_Shdr* shdr;
+	if (class == ELFCLASS32 && size >= sizeof(Elf32_Ehdr)) {
+		const Elf32_Ehdr* elf = (const Elf32_Ehdr*) data;
+		shoff = data32_to_cpu(swap, elf->e_shoff);
+		shentsize = data16_to_cpu(swap, elf->e_shentsize);
+		shnum = data16_to_cpu(swap, elf->e_shnum);
+		shstrndx = data16_to_cpu(swap, elf->e_shstrndx);
+		if (shentsize < sizeof(Elf32_Shdr))
+			return false;
+	} else if (class == ELFCLASS64 && size >= sizeof(Elf64_Ehdr)) {
+		const Elf64_Ehdr* elf = (const Elf64_Ehdr*) data;
+		shoff = data64_to_cpu(swap, elf->e_shoff);
+		shentsize = data16_to_cpu(swap, elf->e_shentsize);
+		shnum = data16_to_cpu(swap, elf->e_shnum);
+		shstrndx = data16_to_cpu(swap, elf->e_shstrndx);
+		if (shentsize < sizeof(Elf64_Shdr))
+			return false;
+	} else {
+		fprintf(stderr, "Platforms other than 32-bit/64-bit are currently not supported!");
+		return false;
+	}
+
+	if (shoff > size || shentsize * shnum > size - shoff || shstrndx >= shnum) {
+		fprintf(stderr, "Invalid ELF section headers table\n");
+		return false;
+	}
 
-		elf = (Elf32_Ehdr*) data;
-		shdr = (Elf32_Shdr*) (data + ((Elf32_Ehdr*) elf)->e_shoff);
+	for (i = 0; i <= shnum; i++) {
+		// the string table is read first, then all the sections
+		uint64_t index = i == 0 ? shstrndx : i - 1;
+		uint64_t name, offset, length;
+
+		if (class == ELFCLASS32) {
+			const Elf32_Shdr* shdr = (const Elf32_Shdr*) (data + shoff + index * shentsize);
+			name = data32_to_cpu(swap, shdr->sh_name);
+			offset = data32_to_cpu(swap, shdr->sh_offset);
+			length = data32_to_cpu(swap, shdr->sh_size);
+		} else {
+			const Elf64_Shdr* shdr = (const Elf64_Shdr*) (data + shoff + index * shentsize);
+			name = data32_to_cpu(swap, shdr->sh_name);
+			offset = data64_to_cpu(swap, shdr->sh_offset);
+			length = data64_to_cpu(swap, shdr->sh_size);
+		}
 
-		char* strTab = (char*) (data + shdr[elf->e_shstrndx].sh_offset);
-		for (i = 0; i < elf->e_shnum; i++) {
-			if (strcmp(&strTab[shdr[i].sh_name], section_name) == 0) {
-				*offset = shdr[i].sh_offset;
-				*length = shdr[i].sh_size;
-			}
+		if (i == 0) {
+			if (offset > size || length > size - offset)
+				return false;
+
+			strtab_offset = offset;
+			strtab_size = length;
+			continue;
 		}
-	} else if (class == ELFCLASS64) {
-		Elf64_Ehdr* elf;
-		Elf64_Shdr* shdr;
-
-		elf = (Elf64_Ehdr*) data;
-		shdr = (Elf64_Shdr*) (data + elf->e_shoff);
-
-		char* strTab = (char*) (data + shdr[elf->e_shstrndx].sh_offset);
-		for (i = 0; i < elf->e_shnum; i++) {
-			if (strcmp(&strTab[shdr[i].sh_name], section_name) == 0) {
-				*offset = shdr[i].sh_offset;
-				*length = shdr[i].sh_size;
+
+		if (name >= strtab_size)
+			continue;
+
+		const char* section_name = (const char*) (data + strtab_offset + name);
+		size_t max_name_length = (size_t) (strtab_size - name);
+		for (j = 0; j < count; j++) {
+			size_t name_length = strlen(section_names[j]);
+			if (name_length < max_name_length && strncmp(section_name, section_names[j], name_length + 1) == 0) {
+				offsets[j] = offset;
+				lengths[j] = length;
 			}
 		}
-	} else {
-		fprintf(stderr, "Platforms other than 32-bit/64-bit are currently not supported!");
-		munmap(data, map_size);
-		return false;
 	}
 
-	munmap(data, map_size);
 	return true;
 }
 
+/* Return the offsets, and the lengths of several ELF sections in a given ELF file, mapping it only once */
+bool appimage_get_elf_sections_offset_and_length(const char* fname, const char* const* section_names, size_t count,
+                                                 unsigned long* offsets, unsigned long* lengths) {
+	int fd = open(fname, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		fprintf(stderr, "Cannot open %s: %s\n", fname, strerror(errno));
+		return false;
+	}
+
+	off_t map_size = lseek(fd, 0, SEEK_END);
+	if (map_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	// only the pages holding the headers and the section names are actually read
+	uint8_t* data = mmap(NULL, (size_t) map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "Cannot map %s: %s\n", fname, strerror(errno));
+		return false;
+	}
+
+	bool result = find_sections(data, (size_t) map_size, section_names, count, offsets, lengths);
+
+	munmap(data, (size_t) map_size);
+	return result;
+}
+
+/* Return the offset, and the length of an ELF section with a given name in a given ELF file */
+bool appimage_get_elf_section_offset_and_length(const char* fname, const char* section_name, unsigned long* offset, unsigned long* length) {
+	return appimage_get_elf_sections_offset_and_length(fname, &section_name, 1, offset, length);
+}
+
 char* read_file_offset_length(const char* fname, unsigned long offset, unsigned long length) {
 	FILE* f;
 	if ((f = fopen(fname, "r")) == NULL) {
@@ -1,7 +1,12 @@
 // system
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <vector>
 #include <fstream>
+#include <map>
 #include <random>
+#include <set>
 #include <string>
 
 // library
@@ -11,6 +16,7 @@
 // local
 #include <appimage/core/exceptions.h>
 #include <appimage/core/AppImage.h>
+#include <appimage/core/AppImageInfo.h>
 #include "TemporaryDirectory.h"
 
 using namespace appimage;
@@ -253,3 +259,410 @@ TEST_F(AppImageTests, extractEntryMultipleTimes) {
     ASSERT_THROW(itr.extractTo(tmpFilePath), core::PayloadIteratorError);
     std::filesystem::remove(tmpFilePath);
 }
+
+TEST_F(AppImageTests, type2Lookup) {
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    auto entry = appImage.lookup("usr/share/applications/echo.desktop");
+    ASSERT_EQ(entry.path(), "usr/share/applications/echo.desktop");
+    ASSERT_EQ(entry.type(), core::PayloadEntryType::REGULAR);
+    ASSERT_TRUE(S_ISREG(entry.mode()));
+
+    std::string content{std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+    ASSERT_EQ(content.size(), entry.size());
+
+    const auto& stat = entry.stat();
+    ASSERT_EQ(stat.size, entry.size());
+    ASSERT_EQ(stat.mode, entry.mode());
+    ASSERT_GT(stat.inode, 0u);
+    ASSERT_GT(stat.mtime.tv_sec, 0);
+    ASSERT_GE(stat.blocks * 512, stat.size);
+
+    // entries can be read more than once
+    std::string secondContent{std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+    ASSERT_EQ(content, secondContent);
+
+    // entries can be reopened from their id
+    auto reopenedEntry = appImage.openEntry(entry.id());
+    ASSERT_EQ(reopenedEntry.type(), core::PayloadEntryType::REGULAR);
+    ASSERT_EQ(reopenedEntry.size(), entry.size());
+
+    auto link = appImage.lookup(".DirIcon");
+    ASSERT_EQ(link.type(), core::PayloadEntryType::LINK);
+    ASSERT_EQ(link.linkTarget(), "utilities-terminal.svg");
+
+    ASSERT_EQ(appImage.lookup("usr/share").type(), core::PayloadEntryType::DIR);
+    ASSERT_THROW(appImage.lookup("usr/missing"), core::PayloadIteratorError);
+    ASSERT_THROW(appImage.lookup("AppRun/missing"), core::PayloadIteratorError);
+}
+
+TEST_F(AppImageTests, type1Lookup) {
+    const core::AppImage appImage(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage");
+
+    auto entry = appImage.lookup("AppImageExtract.desktop");
+    ASSERT_EQ(entry.type(), core::PayloadEntryType::REGULAR);
+
+    std::string content{std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+    ASSERT_FALSE(content.empty());
+    ASSERT_EQ(content.size(), entry.size());
+    ASSERT_EQ(entry.stat().size, entry.size());
+    ASSERT_TRUE(S_ISREG(entry.stat().mode));
+
+    auto reopenedEntry = appImage.openEntry(entry.id());
+    ASSERT_EQ(reopenedEntry.path(), entry.path());
+
+    ASSERT_THROW(appImage.lookup("missing"), core::PayloadIteratorError);
+}
+
+TEST_F(AppImageTests, readRange) {
+    for (const auto& item : {std::make_pair("/Echo-x86_64.AppImage", "usr/bin/echo"),
+                             std::make_pair("/AppImageExtract_6-x86_64.AppImage", "usr/bin/xorriso")}) {
+        const core::AppImage appImage(std::string(TEST_DATA_DIR) + item.first);
+
+        auto entry = appImage.lookup(item.second);
+        const std::string content{std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+        ASSERT_GT(content.size(), 4096u) << item.second;
+
+        // trailer, header and a range reaching the end of the file, in that order
+        for (const auto& range : {std::make_pair(content.size() - 4096, 4096), std::make_pair(0ul, 64),
+                                  std::make_pair(1000ul, 200000)}) {
+            std::vector<char> buffer(range.second);
+            const auto bytesRead = entry.readRange(range.first, buffer.data(), buffer.size());
+            ASSERT_EQ(bytesRead, std::min(buffer.size(), content.size() - range.first)) << item.second;
+            ASSERT_EQ(std::string(buffer.data(), bytesRead), content.substr(range.first, bytesRead)) << item.second;
+        }
+
+        char byte;
+        ASSERT_EQ(entry.readRange(content.size(), &byte, 1), 0u);
+
+        // the streams are seekable as well
+        auto& istream = entry.read();
+        istream.seekg(-16, std::ios_base::end);
+        const std::string tail{std::istreambuf_iterator<char>(istream), std::istreambuf_iterator<char>()};
+        ASSERT_EQ(tail, content.substr(content.size() - 16));
+
+        char buffer[8];
+        ASSERT_THROW(appImage.lookup("usr").readRange(0, buffer, sizeof(buffer)), core::PayloadIteratorError);
+    }
+}
+
+TEST_F(AppImageTests, readRangeAfterWholeBlocks) {
+    // squashfs block size of the test image
+    constexpr size_t BLOCK_SIZE = 128 * 1024;
+
+    const core::AppImage appImage(TEST_DATA_DIR "/appimagetool-x86_64.AppImage");
+
+    std::string largestPath;
+    uint64_t largestSize = 0;
+    for (auto itr = appImage.files(); itr != itr.end(); ++itr) {
+        if (itr.type() == core::PayloadEntryType::REGULAR && appImage.lookup(itr.path()).size() > largestSize) {
+            largestPath = itr.path();
+            largestSize = appImage.lookup(itr.path()).size();
+        }
+    }
+    ASSERT_GT(largestSize, 2 * BLOCK_SIZE);
+
+    auto entry = appImage.lookup(largestPath);
+    const std::string content{std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+
+    // a range ending at a block boundary is read partly from the get area and partly straight into the buffer,
+    // the next ranges start in the preceding blocks
+    std::vector<char> buffer(2 * BLOCK_SIZE - 10);
+    ASSERT_EQ(entry.readRange(10, buffer.data(), buffer.size()), buffer.size());
+    ASSERT_EQ(std::string(buffer.data(), buffer.size()), content.substr(10, buffer.size()));
+
+    for (const uint64_t offset : {BLOCK_SIZE + 5, BLOCK_SIZE - 1, 5ul}) {
+        char byte;
+        ASSERT_EQ(entry.readRange(offset, &byte, 1), 1u);
+        ASSERT_EQ(byte, content[offset]) << offset;
+    }
+}
+
+TEST_F(AppImageTests, lookupFromSeveralThreads) {
+    for (const auto& item : {std::make_pair("/Echo-x86_64.AppImage", "usr/bin/echo"),
+                             std::make_pair("/AppImageExtract_6-x86_64.AppImage", "usr/bin/xorriso")}) {
+        const core::AppImage appImage(std::string(TEST_DATA_DIR) + item.first);
+
+        auto entry = appImage.lookup(item.second);
+        const std::string expected{std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+
+        // each thread reads through its own payload reader, copies of the AppImage share them as well
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&, copy = appImage]() {
+                for (int j = 0; j < 10; ++j) {
+                    auto threadEntry = copy.lookup(item.second);
+                    const std::string content{std::istreambuf_iterator<char>(threadEntry.read()),
+                                              std::istreambuf_iterator<char>()};
+                    if (content != expected)
+                        ++mismatches;
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+            thread.join();
+
+        ASSERT_EQ(mismatches, 0) << item.second;
+    }
+}
+
+TEST_F(AppImageTests, entryUsedFromAnotherThread) {
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+    auto entry = appImage.lookup("usr/bin/echo");
+
+    // entries are bound to the reader of the thread that obtained them
+    EXPECT_DEBUG_DEATH(std::thread([&entry]() { entry.read(); }).join(), "another thread");
+}
+
+TEST_F(AppImageTests, type2SubdirTraversal) {
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    std::set<std::string> paths;
+    for (auto itr = appImage.files("usr/share"); itr != itr.end(); ++itr)
+        paths.insert(itr.path());
+
+    ASSERT_FALSE(paths.empty());
+    ASSERT_TRUE(paths.count("usr/share/applications/echo.desktop"));
+    for (const auto& path : paths)
+        ASSERT_EQ(path.compare(0, 10, "usr/share/"), 0) << path;
+
+    // leading and trailing slashes are ignored
+    auto itr = appImage.files("/usr/share/");
+    ASSERT_TRUE(itr != itr.end());
+    ASSERT_EQ(itr.path().compare(0, 10, "usr/share/"), 0);
+
+    ASSERT_THROW(appImage.files("usr/missing"), core::PayloadIteratorError);
+    ASSERT_THROW(appImage.files(".DirIcon"), core::PayloadIteratorError);
+}
+
+TEST_F(AppImageTests, type2ListDirectory) {
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    std::map<std::string, core::PayloadEntryType> rootEntries;
+    for (const auto& entry : appImage.listDirectory(""))
+        rootEntries[entry.path()] = entry.type();
+
+    ASSERT_EQ(rootEntries["echo.desktop"], core::PayloadEntryType::LINK);
+    ASSERT_EQ(rootEntries["usr"], core::PayloadEntryType::DIR);
+    ASSERT_EQ(rootEntries[".DirIcon"], core::PayloadEntryType::LINK);
+
+    auto entries = appImage.listDirectory("usr/share/applications");
+    ASSERT_EQ(entries.size(), 1u);
+    ASSERT_EQ(entries.front().path(), "usr/share/applications/echo.desktop");
+    ASSERT_EQ(entries.front().size(), appImage.lookup("usr/share/applications/echo.desktop").size());
+
+    ASSERT_THROW(appImage.listDirectory("usr/missing"), core::PayloadIteratorError);
+    ASSERT_THROW(appImage.listDirectory("echo.desktop"), core::PayloadIteratorError);
+}
+
+TEST_F(AppImageTests, type1ListDirectory) {
+    const core::AppImage appImage(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage");
+
+    std::set<std::string> rootPaths;
+    for (const auto& entry : appImage.listDirectory(""))
+        rootPaths.insert(entry.path());
+
+    ASSERT_TRUE(rootPaths.count("AppImageExtract.desktop"));
+    for (const auto& path : rootPaths)
+        ASSERT_EQ(path.find('/'), std::string::npos) << path;
+
+    ASSERT_THROW(appImage.listDirectory("missing"), core::PayloadIteratorError);
+    ASSERT_THROW(appImage.listDirectory("AppImageExtract.desktop"), core::PayloadIteratorError);
+}
+
+TEST_F(AppImageTests, iteratorEnd) {
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    auto itr = appImage.files();
+    ASSERT_TRUE(itr != itr.end());
+    ASSERT_TRUE(itr.end() != itr);
+
+    std::set<std::string> paths;
+    for (; itr != itr.end(); ++itr) {
+        ASSERT_EQ(itr.pathView(), itr.path());
+        ASSERT_EQ(itr.linkTargetView(), itr.linkTarget());
+        paths.insert(*itr);
+    }
+
+    ASSERT_TRUE(itr == itr.end());
+    ASSERT_TRUE(itr.path().empty());
+    ASSERT_TRUE(paths.find("usr/bin/echo") != paths.end());
+}
+
+TEST_F(AppImageTests, type2ExtractAll) {
+    const TemporaryDirectory tmpDir;
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    core::ExtractOptions options;
+    options.threads = 4;
+    ASSERT_NO_THROW(appImage.extractAll(tmpDir.path(), options));
+
+    for (auto itr = appImage.files(); itr != itr.end(); ++itr) {
+        const auto target = tmpDir.path() / itr.path();
+        switch (itr.type()) {
+            case core::PayloadEntryType::REGULAR:
+                ASSERT_TRUE(std::filesystem::is_regular_file(target)) << target;
+                ASSERT_EQ(std::filesystem::file_size(target), appImage.lookup(itr.path()).size()) << target;
+                break;
+            case core::PayloadEntryType::LINK:
+                ASSERT_EQ(std::filesystem::read_symlink(target), itr.linkTarget()) << target;
+                break;
+            case core::PayloadEntryType::DIR:
+                ASSERT_TRUE(std::filesystem::is_directory(target)) << target;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // file permissions are preserved
+    const auto perms = std::filesystem::status(tmpDir.path() / "AppRun").permissions();
+    ASSERT_NE(perms & std::filesystem::perms::owner_exec, std::filesystem::perms::none);
+
+    // extracting again overwrites the existing files, in payload order using a single thread
+    options.threads = 1;
+    options.order = core::ExtractOrder::PAYLOAD;
+    ASSERT_NO_THROW(appImage.extractAll(tmpDir.path(), options));
+
+    // small files written in the background get the same contents and permissions
+    const TemporaryDirectory asyncTmpDir;
+    options.asyncWrites = true;
+    ASSERT_NO_THROW(appImage.extractAll(asyncTmpDir.path(), options));
+
+    for (const auto& path : {"AppRun", "usr/bin/echo", "usr/share/applications/echo.desktop"}) {
+        ASSERT_EQ(std::filesystem::file_size(asyncTmpDir.path() / path),
+                  std::filesystem::file_size(tmpDir.path() / path));
+        ASSERT_EQ(std::filesystem::status(asyncTmpDir.path() / path).permissions(),
+                  std::filesystem::status(tmpDir.path() / path).permissions());
+    }
+}
+
+TEST_F(AppImageTests, type2ExtractAllContentStore) {
+    const TemporaryDirectory tmpDir;
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    const auto plainDir = tmpDir.path() / "plain";
+    ASSERT_NO_THROW(appImage.extractAll(plainDir));
+
+    core::ExtractOptions options;
+    options.contentStorePath = (tmpDir.path() / "store").string();
+    ASSERT_NO_THROW(appImage.extractAll(tmpDir.path() / "first", options));
+
+    // the second extraction links the files recorded by the first one
+    ASSERT_NO_THROW(appImage.extractAll(tmpDir.path() / "second", options));
+
+    // the files extracted one by one are stored as well
+    for (auto itr = appImage.files(); itr != itr.end(); ++itr)
+        itr.extractTo(tmpDir.path() / "iterator" / itr.path(), options);
+
+    for (const auto& path : {"AppRun", "usr/bin/echo", "usr/share/applications/echo.desktop"}) {
+        std::ifstream expected(plainDir / path, std::ios::binary);
+        const std::string expectedContents{std::istreambuf_iterator<char>(expected),
+                                           std::istreambuf_iterator<char>()};
+
+        for (const auto& dir : {"first", "second", "iterator"}) {
+            const auto target = tmpDir.path() / dir / path;
+            std::ifstream input(target, std::ios::binary);
+            ASSERT_EQ(std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()),
+                      expectedContents) << target;
+            ASSERT_EQ(std::filesystem::status(target).permissions(),
+                      std::filesystem::status(plainDir / path).permissions()) << target;
+        }
+
+        // every copy is a hard link of the stored object
+        ASSERT_TRUE(std::filesystem::equivalent(tmpDir.path() / "first" / path, tmpDir.path() / "second" / path));
+        ASSERT_TRUE(std::filesystem::equivalent(tmpDir.path() / "first" / path, tmpDir.path() / "iterator" / path));
+        ASSERT_GE(std::filesystem::hard_link_count(tmpDir.path() / "first" / path), 4u);
+    }
+}
+
+TEST_F(AppImageTests, type1ExtractAll) {
+    const TemporaryDirectory tmpDir;
+    const core::AppImage appImage(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage");
+
+    ASSERT_NO_THROW(appImage.extractAll(tmpDir.path()));
+
+    const auto desktopFile = tmpDir.path() / "AppImageExtract.desktop";
+    ASSERT_TRUE(std::filesystem::exists(desktopFile));
+    ASSERT_EQ(std::filesystem::file_size(desktopFile), appImage.lookup("AppImageExtract.desktop").size());
+
+    const TemporaryDirectory asyncTmpDir;
+    core::ExtractOptions options;
+    options.asyncWrites = true;
+    ASSERT_NO_THROW(appImage.extractAll(asyncTmpDir.path(), options));
+
+    for (const auto& path : {"AppImageExtract.desktop", "usr/bin/appimageextract", "usr/bin/xorriso"})
+        ASSERT_EQ(std::filesystem::file_size(asyncTmpDir.path() / path), appImage.lookup(path).size()) << path;
+}
+
+TEST_F(AppImageTests, memoryMappedBackend) {
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+    const core::AppImage mappedAppImage(TEST_DATA_DIR "/Echo-x86_64.AppImage", core::IoBackend::MEMORY_MAPPED);
+
+    ASSERT_EQ(mappedAppImage.getFormat(), core::AppImageFormat::TYPE_2);
+    ASSERT_EQ(mappedAppImage.getPayloadOffset(), appImage.getPayloadOffset());
+
+    for (const auto& path : {"usr/bin/echo", "usr/share/applications/echo.desktop"}) {
+        auto entry = appImage.lookup(path);
+        auto mappedEntry = mappedAppImage.lookup(path);
+
+        const std::string expected{std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+        const std::string actual{std::istreambuf_iterator<char>(mappedEntry.read()),
+                                 std::istreambuf_iterator<char>()};
+        ASSERT_EQ(actual, expected);
+    }
+
+    for (auto itr = mappedAppImage.files(); itr != itr.end(); ++itr) {
+        if (itr.path() == "usr/bin/echo") {
+            ASSERT_EQ(std::string(std::istreambuf_iterator<char>(itr.read()), std::istreambuf_iterator<char>()).size(),
+                      appImage.lookup("usr/bin/echo").size());
+        }
+    }
+
+    // the files tails are read from the fragment blocks, shared by the small files
+    for (auto itr = appImage.files(); itr != itr.end(); ++itr) {
+        if (itr.type() != core::PayloadEntryType::REGULAR)
+            continue;
+
+        const std::string expected{std::istreambuf_iterator<char>(itr.read()), std::istreambuf_iterator<char>()};
+        auto mappedEntry = mappedAppImage.lookup(itr.path());
+        const std::string actual{std::istreambuf_iterator<char>(mappedEntry.read()),
+                                 std::istreambuf_iterator<char>()};
+        ASSERT_EQ(actual, expected) << itr.path();
+    }
+
+    const TemporaryDirectory tmpDir;
+    ASSERT_NO_THROW(mappedAppImage.extractAll(tmpDir.path()));
+    ASSERT_EQ(std::filesystem::file_size(tmpDir.path() / "usr/bin/echo"), appImage.lookup("usr/bin/echo").size());
+
+    ASSERT_THROW(core::AppImage(TEST_DATA_DIR "/missing_file", core::IoBackend::MEMORY_MAPPED), core::IOError);
+}
+
+TEST_F(AppImageTests, type2Info) {
+    const core::AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+    const core::AppImageInfo info(appImage);
+
+    ASSERT_EQ(info.getFormat(), core::AppImageFormat::TYPE_2);
+    ASSERT_EQ(info.getPayloadOffset(), appImage.getPayloadOffset());
+    ASSERT_FALSE(info.getCompression().empty());
+    ASSERT_GT(info.getBlockSize(), 0u);
+
+    ASSERT_EQ(info.getDesktopEntryPath(), "echo.desktop");
+    ASSERT_NE(info.getDesktopEntry().find("Name=Echo"), std::string::npos);
+
+    const auto& icons = info.getIconPaths();
+    ASSERT_NE(std::find(icons.begin(), icons.end(), ".DirIcon"), icons.end());
+}
+
+TEST_F(AppImageTests, type1Info) {
+    const core::AppImage appImage(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage");
+    const core::AppImageInfo info(appImage);
+
+    ASSERT_EQ(info.getFormat(), core::AppImageFormat::TYPE_1);
+    ASSERT_TRUE(info.getCompression().empty());
+    ASSERT_EQ(info.getBlockSize(), 0u);
+    ASSERT_EQ(info.getDesktopEntryPath(), "AppImageExtract.desktop");
+    ASSERT_FALSE(info.getDesktopEntry().empty());
+}
@@ -0,0 +1,40 @@
+// system
+#include <string>
+#include <vector>
+
+// library
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/AppImage.h>
+#include <appimage/core/ElfInventory.h>
+
+using namespace appimage::core;
+
+TEST(TestElfInventory, type1) {
+    const AppImage appImage(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage");
+    const auto files = ElfInventory(ElfInventoryOptions{2}).list(appImage);
+
+    ASSERT_EQ(files.size(), 3u);
+    ASSERT_EQ(files[0].path, "usr/lib/libburn.so.4");
+    ASSERT_EQ(files[1].path, "usr/lib/libisoburn.so.1");
+    ASSERT_EQ(files[2].path, "usr/lib/libisofs.so.6");
+
+    const auto& libisoburn = files[1];
+    ASSERT_EQ(libisoburn.machine, 62); // EM_X86_64
+    ASSERT_TRUE(libisoburn.is64Bit);
+    ASSERT_TRUE(libisoburn.littleEndian);
+    ASSERT_EQ(libisoburn.soname, "libisoburn.so.1");
+    ASSERT_EQ(libisoburn.needed, std::vector<std::string>(
+        {"libisofs.so.6", "libburn.so.4", "libz.so.1", "libacl.so.1", "libc.so.6"}));
+    ASSERT_EQ(libisoburn.buildId, "c67a891456e406c2688de2273d3f18feb0c2b4ef");
+
+    ASSERT_EQ(files[0].soname, "libburn.so.4");
+    ASSERT_EQ(files[2].buildId, "3f612c74d81bbf33ae3811abd069154649ca313b");
+}
+
+TEST(TestElfInventory, withoutLibraries) {
+    // the only bundled ELF file lives in usr/bin
+    const AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+    ASSERT_TRUE(ElfInventory().list(appImage).empty());
+}
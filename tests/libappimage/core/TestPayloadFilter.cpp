@@ -0,0 +1,98 @@
+// system
+#include <set>
+#include <string>
+
+// library
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/AppImage.h>
+#include <appimage/core/PayloadFilter.h>
+
+using namespace appimage::core;
+
+TEST(TestPayloadFilter, empty) {
+    PayloadFilter filter;
+    ASSERT_TRUE(filter.isEmpty());
+    ASSERT_TRUE(filter.matches("usr/share/applications/echo.desktop", PayloadEntryType::REGULAR));
+    ASSERT_TRUE(filter.canDescend("usr/share"));
+}
+
+TEST(TestPayloadFilter, globs) {
+    PayloadFilter filter;
+    filter.addGlob("*.desktop").addGlob("usr/share/icons/*/apps/*.png");
+
+    ASSERT_TRUE(filter.matches("echo.desktop", PayloadEntryType::REGULAR));
+    ASSERT_FALSE(filter.matches("usr/share/applications/echo.desktop", PayloadEntryType::REGULAR));
+    ASSERT_TRUE(filter.matches("usr/share/icons/hicolor/apps/echo.png", PayloadEntryType::REGULAR));
+    ASSERT_FALSE(filter.matches("usr/share/icons/hicolor/48x48/apps/echo.png", PayloadEntryType::REGULAR));
+
+    ASSERT_TRUE(filter.canDescend("usr"));
+    ASSERT_TRUE(filter.canDescend("usr/share/icons/hicolor"));
+    ASSERT_TRUE(filter.canDescend("usr/share/icons/hicolor/apps"));
+    ASSERT_FALSE(filter.canDescend("usr/bin"));
+    ASSERT_FALSE(filter.canDescend("usr/share/icons/hicolor/48x48"));
+    ASSERT_FALSE(filter.canDescend("usr/share/icons/hicolor/apps/nested"));
+}
+
+TEST(TestPayloadFilter, prefixes) {
+    PayloadFilter filter;
+    filter.addPrefix("usr/share/mime/packages/");
+
+    ASSERT_TRUE(filter.matches("usr/share/mime/packages/echo.xml", PayloadEntryType::REGULAR));
+    ASSERT_FALSE(filter.matches("usr/share/mime/echo.xml", PayloadEntryType::REGULAR));
+
+    ASSERT_TRUE(filter.canDescend("usr/share"));
+    ASSERT_TRUE(filter.canDescend("usr/share/mime/packages/nested"));
+    ASSERT_FALSE(filter.canDescend("usr/share/mim"));
+    ASSERT_FALSE(filter.canDescend("opt"));
+}
+
+TEST(TestPayloadFilter, depthAndPredicates) {
+    PayloadFilter filter;
+    filter.setMaxDepth(2)
+        .setPredicate([](std::string_view, PayloadEntryType type) { return type == PayloadEntryType::REGULAR; })
+        .setDirectoryPredicate([](std::string_view dirPath) { return dirPath != "lib"; });
+
+    ASSERT_TRUE(filter.matches("usr/echo", PayloadEntryType::REGULAR));
+    ASSERT_FALSE(filter.matches("usr/bin/echo", PayloadEntryType::REGULAR));
+    ASSERT_FALSE(filter.matches("usr", PayloadEntryType::DIR));
+
+    ASSERT_TRUE(filter.canDescend("usr"));
+    ASSERT_FALSE(filter.canDescend("usr/bin"));
+    ASSERT_FALSE(filter.canDescend("lib"));
+
+    ASSERT_TRUE(filter.isReachable("usr/echo"));
+    ASSERT_FALSE(filter.isReachable("lib/echo"));
+}
+
+TEST(TestPayloadFilter, type2Traversal) {
+    AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    std::set<std::string> paths;
+    for (auto itr = appImage.files(PayloadFilter().setMaxDepth(1)); itr != itr.end(); ++itr)
+        paths.insert(itr.path());
+
+    ASSERT_TRUE(paths.count("echo.desktop"));
+    ASSERT_TRUE(paths.count("usr"));
+    for (const auto& path : paths)
+        ASSERT_EQ(path.find('/'), std::string::npos) << path;
+
+    paths.clear();
+    for (auto itr = appImage.files(PayloadFilter().addGlob("usr/share/*/*.desktop")); itr != itr.end(); ++itr)
+        paths.insert(itr.path());
+
+    ASSERT_EQ(paths, std::set<std::string>({"usr/share/applications/echo.desktop"}));
+}
+
+TEST(TestPayloadFilter, type1Traversal) {
+    AppImage appImage(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage");
+
+    std::set<std::string> paths;
+    for (auto itr = appImage.files(PayloadFilter().addPrefix("usr/bin/")); itr != itr.end(); ++itr)
+        paths.insert(itr.path());
+
+    ASSERT_TRUE(paths.count("usr/bin/appimageextract"));
+    for (const auto& path : paths)
+        ASSERT_EQ(path.compare(0, 8, "usr/bin/"), 0) << path;
+}
@@ -0,0 +1,187 @@
+// system
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// library
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/AppImage.h>
+#include <appimage/core/PayloadIndexCache.h>
+#include <core/PayloadIndex.h>
+#include "utils/resources_extractor/PayloadEntriesCache.h"
+#include "TemporaryDirectory.h"
+
+using namespace appimage::core;
+
+class TestPayloadIndex : public ::testing::Test {
+protected:
+    TemporaryDirectory tmpDir;
+    std::string oldXdgCacheHome;
+
+    void SetUp() override {
+        auto value = getenv("XDG_CACHE_HOME");
+        if (value != nullptr)
+            oldXdgCacheHome = value;
+
+        setenv("XDG_CACHE_HOME", (tmpDir.path() / "cache").c_str(), true);
+    }
+
+    void TearDown() override {
+        PayloadIndexCache::setEnabled(false);
+        PayloadIndexCache::setMaxFiles(256);
+
+        if (oldXdgCacheHome.empty())
+            unsetenv("XDG_CACHE_HOME");
+        else
+            setenv("XDG_CACHE_HOME", oldXdgCacheHome.c_str(), true);
+    }
+};
+
+TEST_F(TestPayloadIndex, matchesTraversal) {
+    const AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+    PayloadIndex index(appImage, false);
+    ASSERT_FALSE(index.isLoadedFromCache());
+
+    std::map<std::string, PayloadEntryType> expected;
+    for (auto itr = appImage.files(); itr != itr.end(); ++itr)
+        expected[itr.path()] = itr.type();
+
+    ASSERT_EQ(index.size(), expected.size());
+
+    auto expectedItr = expected.begin();
+    for (size_t i = 0; i < index.size(); ++i, ++expectedItr) {
+        ASSERT_EQ(index[i].path, expectedItr->first);
+        ASSERT_EQ(index[i].type, expectedItr->second);
+    }
+
+    PayloadIndex::Entry entry;
+    ASSERT_TRUE(index.find("usr/bin/echo", entry));
+    ASSERT_EQ(entry.type, PayloadEntryType::REGULAR);
+    ASSERT_EQ(entry.size, appImage.lookup("usr/bin/echo").size());
+    ASSERT_EQ(entry.id, appImage.lookup("usr/bin/echo").id());
+    ASSERT_TRUE(S_ISREG(entry.mode));
+
+    ASSERT_TRUE(index.find(".DirIcon", entry));
+    ASSERT_EQ(entry.type, PayloadEntryType::LINK);
+    ASSERT_EQ(entry.linkTarget, "utilities-terminal.svg");
+
+    ASSERT_FALSE(index.find("usr/bin/missing", entry));
+}
+
+TEST_F(TestPayloadIndex, persistence) {
+    const auto appImagePath = tmpDir.path() / "Echo-x86_64.AppImage";
+    std::filesystem::copy_file(TEST_DATA_DIR "/Echo-x86_64.AppImage", appImagePath);
+    const AppImage appImage(appImagePath);
+
+    ASSERT_FALSE(PayloadIndex(appImage, true).isLoadedFromCache());
+    ASSERT_TRUE(std::filesystem::exists(PayloadIndex::getCacheDir()));
+
+    PayloadIndex cachedIndex(appImage, true);
+    ASSERT_TRUE(cachedIndex.isLoadedFromCache());
+
+    PayloadIndex::Entry entry;
+    ASSERT_TRUE(cachedIndex.find("usr/share/applications/echo.desktop", entry));
+    ASSERT_EQ(entry.type, PayloadEntryType::REGULAR);
+
+    // modified files are indexed again
+    std::filesystem::last_write_time(appImagePath,
+                                     std::filesystem::last_write_time(appImagePath) + std::chrono::seconds(10));
+    ASSERT_FALSE(PayloadIndex(appImage, true).isLoadedFromCache());
+    ASSERT_TRUE(PayloadIndex(appImage, true).isLoadedFromCache());
+}
+
+TEST_F(TestPayloadIndex, concurrentStores) {
+    const auto appImagePath = tmpDir.path() / "Echo-x86_64.AppImage";
+    std::filesystem::copy_file(TEST_DATA_DIR "/Echo-x86_64.AppImage", appImagePath);
+    const size_t expectedSize = PayloadIndex(AppImage(appImagePath), false).size();
+
+    // every thread builds and stores the same index, each one writes its own temporary file
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i)
+        threads.emplace_back([&appImagePath]() { PayloadIndex index{AppImage(appImagePath), true}; });
+
+    for (auto& thread : threads)
+        thread.join();
+
+    PayloadIndex cachedIndex{AppImage(appImagePath), true};
+    ASSERT_TRUE(cachedIndex.isLoadedFromCache());
+    ASSERT_EQ(cachedIndex.size(), expectedSize);
+
+    for (const auto& file : std::filesystem::directory_iterator(PayloadIndex::getCacheDir()))
+        ASSERT_EQ(file.path().filename().string().find(".tmp."), std::string::npos) << file.path();
+}
+
+TEST_F(TestPayloadIndex, cacheDisabledByDefault) {
+    ASSERT_FALSE(PayloadIndexCache::isEnabled());
+
+    const AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+    appimage::utils::PayloadEntriesCache entriesCache(appImage);
+    ASSERT_FALSE(std::filesystem::exists(PayloadIndex::getCacheDir()));
+
+    PayloadIndexCache::setEnabled(true);
+    appimage::utils::PayloadEntriesCache cachedEntries(appImage);
+    ASSERT_TRUE(PayloadIndex(appImage, true).isLoadedFromCache());
+
+    PayloadIndexCache::clear();
+    ASSERT_TRUE(std::filesystem::is_empty(PayloadIndex::getCacheDir()));
+}
+
+TEST_F(TestPayloadIndex, eviction) {
+    PayloadIndexCache::setMaxFiles(2);
+
+    std::vector<std::filesystem::path> appImagePaths;
+    for (int i = 0; i < 3; ++i) {
+        appImagePaths.emplace_back(tmpDir.path() / ("Echo-" + std::to_string(i) + ".AppImage"));
+        std::filesystem::copy_file(TEST_DATA_DIR "/Echo-x86_64.AppImage", appImagePaths.back());
+    }
+
+    PayloadIndex(AppImage(appImagePaths[0]), true);
+    PayloadIndex(AppImage(appImagePaths[1]), true);
+
+    // loading an index makes it the most recently used one
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ASSERT_TRUE(PayloadIndex(AppImage(appImagePaths[0]), true).isLoadedFromCache());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    PayloadIndex(AppImage(appImagePaths[2]), true);
+
+    size_t count = 0;
+    for (const auto& file : std::filesystem::directory_iterator(PayloadIndex::getCacheDir()))
+        count += file.path().extension() == ".idx";
+    ASSERT_EQ(count, 2u);
+
+    ASSERT_TRUE(PayloadIndex(AppImage(appImagePaths[0]), true).isLoadedFromCache());
+    ASSERT_TRUE(PayloadIndex(AppImage(appImagePaths[2]), true).isLoadedFromCache());
+    ASSERT_FALSE(PayloadIndex(AppImage(appImagePaths[1]), true).isLoadedFromCache());
+}
+
+TEST_F(TestPayloadIndex, type1) {
+    const AppImage appImage(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage");
+    PayloadIndex index(appImage, false);
+
+    PayloadIndex::Entry entry;
+    ASSERT_TRUE(index.find("AppImageExtract.desktop", entry));
+    ASSERT_EQ(entry.type, PayloadEntryType::REGULAR);
+    ASSERT_EQ(entry.id, appImage.lookup("AppImageExtract.desktop").id());
+    ASSERT_EQ(entry.size, appImage.lookup("AppImageExtract.desktop").size());
+}
+
+TEST_F(TestPayloadIndex, type1Joliet) {
+    // without Rock Ridge extensions the entries are named after the Joliet records
+    const AppImage appImage(TEST_DATA_DIR "/AppImageExtract_6_joliet-x86_64.AppImage");
+    PayloadIndex index(appImage, false);
+
+    PayloadIndex::Entry entry;
+    ASSERT_TRUE(index.find(".DirIcon", entry));
+    ASSERT_EQ(entry.id, appImage.lookup(".DirIcon").id());
+
+    ASSERT_TRUE(index.find("usr/bin/appimageextract", entry));
+    ASSERT_EQ(entry.type, PayloadEntryType::REGULAR);
+    ASSERT_EQ(entry.size, appImage.lookup("usr/bin/appimageextract").size());
+}
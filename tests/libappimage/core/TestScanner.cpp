@@ -0,0 +1,71 @@
+// system
+#include <map>
+#include <string>
+#include <vector>
+
+// library
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/Scanner.h>
+#include <appimage/core/exceptions.h>
+
+using namespace appimage::core;
+
+TEST(TestScanner, scanDirectory) {
+    std::map<std::string, ScanResult> results;
+    Scanner(ScanOptions{2}).scanDirectory(TEST_DATA_DIR, [&results](const ScanResult& result) {
+        results[result.path] = result;
+    });
+
+    const auto& echo = results.at(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+    ASSERT_EQ(echo.format, AppImageFormat::TYPE_2);
+    ASSERT_EQ(echo.payloadOffset, 187784);
+    ASSERT_GT(echo.size, 0u);
+    ASSERT_GT(echo.mtime.tv_sec, 0);
+
+    ASSERT_EQ(results.at(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage").format, AppImageFormat::TYPE_1);
+    ASSERT_EQ(results.at(TEST_DATA_DIR "/AppImageExtract_6_no_magic_bytes-x86_64.AppImage").format,
+              AppImageFormat::TYPE_1);
+    ASSERT_EQ(results.at(TEST_DATA_DIR "/elffile").format, AppImageFormat::INVALID);
+    ASSERT_EQ(results.at(TEST_DATA_DIR "/elffile").payloadOffset, -1);
+    ASSERT_EQ(results.at(TEST_DATA_DIR "/Cura.desktop").format, AppImageFormat::INVALID);
+
+    // sub directories are not reported
+    ASSERT_EQ(results.count(TEST_DATA_DIR "/squashfs-root"), 0u);
+
+    ASSERT_THROW(Scanner().scanDirectory(TEST_DATA_DIR "/missing_dir", [](const ScanResult&) {}), FileSystemError);
+}
+
+TEST(TestScanner, scanFiles) {
+    const std::vector<std::string> paths = {
+        TEST_DATA_DIR "/appimaged-i686.AppImage",
+        TEST_DATA_DIR "/missing_file",
+        TEST_DATA_DIR "/squashfs-root",
+    };
+
+    std::map<std::string, ScanResult> results;
+    Scanner().scanFiles(paths, [&results](const ScanResult& result) {
+        results[result.path] = result;
+    });
+
+    ASSERT_EQ(results.size(), paths.size());
+    ASSERT_EQ(results.at(paths[0]).format, AppImageFormat::TYPE_2);
+    ASSERT_EQ(results.at(paths[0]).payloadOffset, 91148);
+    ASSERT_EQ(results.at(paths[1]).format, AppImageFormat::INVALID);
+    ASSERT_EQ(results.at(paths[2]).format, AppImageFormat::INVALID);
+}
+
+TEST(TestScanner, preFilter) {
+    ScanOptions options;
+    options.minimumSize = 1024 * 1024 * 1024;
+
+    std::vector<ScanResult> results;
+    Scanner(options).scanFiles({TEST_DATA_DIR "/Echo-x86_64.AppImage"}, [&results](const ScanResult& result) {
+        results.emplace_back(result);
+    });
+
+    ASSERT_EQ(results.size(), 1u);
+    ASSERT_EQ(results[0].format, AppImageFormat::INVALID);
+    ASSERT_GT(results[0].size, 0u);
+}
@@ -0,0 +1,99 @@
+// system
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+// library
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/AppImage.h>
+#include <appimage/core/PayloadBlockCache.h>
+#include <appimage/core/exceptions.h>
+#include <core/impl/BlockCache.h>
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+namespace {
+    BlockCache::Block makeBlock(size_t size) {
+        return std::make_shared<const std::vector<char>>(size, 'x');
+    }
+
+    BlockCache::Key makeKey(uint64_t offset) {
+        BlockCache::Key key;
+        key.image.device = 1;
+        key.image.inode = 2;
+        key.entryId = 3;
+        key.offset = offset;
+        return key;
+    }
+}
+
+TEST(TestBlockCache, getAndPut) {
+    BlockCache cache(1024 * 1024);
+
+    ASSERT_EQ(cache.get(makeKey(0)), nullptr);
+
+    auto block = makeBlock(128);
+    cache.put(makeKey(0), block);
+    ASSERT_EQ(cache.get(makeKey(0)), block);
+
+    auto statistics = cache.getStatistics();
+    ASSERT_EQ(statistics.hits, 1);
+    ASSERT_EQ(statistics.misses, 1);
+    ASSERT_EQ(statistics.size, 128);
+
+    // blocks from a modified image must not be served
+    auto modifiedKey = makeKey(0);
+    modifiedKey.image.mtime = 1;
+    ASSERT_EQ(cache.get(modifiedKey), nullptr);
+}
+
+TEST(TestBlockCache, budget) {
+    // every shard can hold up to 2 blocks of 64 bytes
+    BlockCache cache(16 * 128);
+
+    for (uint64_t i = 0; i < 1000; i++)
+        cache.put(makeKey(i), makeBlock(64));
+
+    auto statistics = cache.getStatistics();
+    ASSERT_LE(statistics.size, statistics.budget);
+    ASSERT_GT(statistics.evictions, 0);
+
+    // blocks larger than a shard budget are not stored
+    cache.put(makeKey(5000), makeBlock(4096));
+    ASSERT_EQ(cache.get(makeKey(5000)), nullptr);
+
+    cache.setBudget(0);
+    ASSERT_FALSE(cache.isEnabled());
+    ASSERT_EQ(cache.getStatistics().size, 0);
+}
+
+TEST(TestBlockCache, imageId) {
+    const int fd = open(TEST_DATA_DIR "/Echo-x86_64.AppImage", O_RDONLY);
+    ASSERT_NE(fd, -1);
+
+    const auto id = BlockCache::ImageId::fromFd(fd);
+    close(fd);
+    ASSERT_NE(id.inode, 0);
+
+    // unidentified images would share the same key
+    ASSERT_THROW(BlockCache::ImageId::fromFd(-1), IOError);
+}
+
+TEST(TestBlockCache, sharedAcrossReaders) {
+    PayloadBlockCache::clear();
+
+    for (int i = 0; i < 2; i++) {
+        const AppImage appImage(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+        auto entry = appImage.lookup("usr/share/applications/echo.desktop");
+        std::string content{std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+        ASSERT_FALSE(content.empty());
+    }
+
+    auto statistics = PayloadBlockCache::getStatistics();
+    ASSERT_EQ(statistics.misses, 1);
+    ASSERT_EQ(statistics.hits, 1);
+}
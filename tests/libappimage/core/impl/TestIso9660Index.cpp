@@ -0,0 +1,127 @@
+// system
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+
+// library
+#include <archive.h>
+#include <archive_entry.h>
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/exceptions.h>
+#include <core/impl/Iso9660Index.h>
+#include <core/impl/StreambufIso9660.h>
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+class TestIso9660Index : public ::testing::Test {
+protected:
+    std::shared_ptr<Iso9660Index> index;
+public:
+    TestIso9660Index() : index(new Iso9660Index(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage")) {}
+};
+
+TEST_F(TestIso9660Index, entries) {
+    std::map<std::string, PayloadEntryType> expectedEntries = {
+        std::make_pair("", PayloadEntryType::DIR),
+        std::make_pair("usr", PayloadEntryType::DIR),
+        std::make_pair("usr/lib", PayloadEntryType::DIR),
+        std::make_pair("usr/bin", PayloadEntryType::DIR),
+        std::make_pair("AppRun", PayloadEntryType::REGULAR),
+        std::make_pair("AppImageExtract.desktop", PayloadEntryType::REGULAR),
+        std::make_pair(".DirIcon", PayloadEntryType::REGULAR),
+        std::make_pair("AppImageExtract.png", PayloadEntryType::LINK),
+        std::make_pair("usr/bin/appimageextract", PayloadEntryType::REGULAR),
+        std::make_pair("usr/lib/libisoburn.so.1", PayloadEntryType::REGULAR),
+        std::make_pair("usr/bin/xorriso", PayloadEntryType::REGULAR),
+        std::make_pair("usr/lib/libburn.so.4", PayloadEntryType::REGULAR),
+        std::make_pair("usr/lib/libisofs.so.6", PayloadEntryType::REGULAR),
+    };
+
+    ASSERT_EQ(index->size(), expectedEntries.size());
+    for (PayloadEntryId id = 0; id < index->size(); ++id) {
+        const auto node = index->get(id);
+        ASSERT_NE(node, nullptr);
+        ASSERT_EQ(node->id, id);
+
+        auto itr = expectedEntries.find(node->path);
+        ASSERT_NE(itr, expectedEntries.end()) << node->path;
+        ASSERT_EQ(itr->second, node->type) << node->path;
+
+        expectedEntries.erase(itr);
+    }
+
+    ASSERT_TRUE(expectedEntries.empty());
+    ASSERT_EQ(index->get(index->size()), nullptr);
+}
+
+TEST_F(TestIso9660Index, find) {
+    const auto node = index->find("usr/bin/xorriso");
+    ASSERT_NE(node, nullptr);
+    ASSERT_EQ(node->path, "usr/bin/xorriso");
+    ASSERT_EQ(index->find("/usr/bin/xorriso"), node);
+    ASSERT_EQ(index->find("./usr/bin/xorriso"), node);
+    ASSERT_EQ(index->get(node->id), node);
+
+    const auto dir = index->find("usr/bin/");
+    ASSERT_NE(dir, nullptr);
+    ASSERT_EQ(dir->type, PayloadEntryType::DIR);
+    ASSERT_EQ(dir->children.size(), 2u);
+
+    const auto link = index->find("AppImageExtract.png");
+    ASSERT_NE(link, nullptr);
+    ASSERT_EQ(link->type, PayloadEntryType::LINK);
+    ASSERT_EQ(link->linkTarget, ".DirIcon");
+
+    ASSERT_EQ(index->find("missing"), nullptr);
+    ASSERT_EQ(index->find("usr/missing"), nullptr);
+}
+
+TEST_F(TestIso9660Index, read) {
+    // the contents decoded by libarchive are taken as reference
+    std::map<std::string, std::string> expectedContents;
+    archive* a = archive_read_new();
+    archive_read_support_format_iso9660(a);
+    ASSERT_EQ(archive_read_open_filename(a, TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage", 10240), ARCHIVE_OK);
+
+    archive_entry* entry;
+    while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
+        if (archive_entry_filetype(entry) != AE_IFREG || archive_entry_hardlink(entry) != nullptr)
+            continue;
+
+        std::string contents;
+        char buffer[10240];
+        la_ssize_t bytesRead;
+        while ((bytesRead = archive_read_data(a, buffer, sizeof(buffer))) > 0)
+            contents.append(buffer, bytesRead);
+
+        expectedContents[archive_entry_pathname(entry)] = contents;
+    }
+
+    archive_read_free(a);
+
+    ASSERT_FALSE(expectedContents.empty());
+    for (const auto& expected : expectedContents) {
+        const auto node = index->find(expected.first);
+        ASSERT_NE(node, nullptr) << expected.first;
+        ASSERT_EQ(node->stat.size, expected.second.size()) << expected.first;
+
+        StreambufIso9660 streambuf(index, *node);
+        const std::string contents{std::istreambuf_iterator<char>(&streambuf), std::istreambuf_iterator<char>()};
+        ASSERT_EQ(contents, expected.second) << expected.first;
+    }
+
+    // the test image holds zisofs compressed files
+    ASSERT_TRUE(index->find("usr/bin/xorriso")->zisofs);
+}
+
+TEST(TestIso9660IndexInvalid, invalidImage) {
+    ASSERT_THROW(Iso9660Index(TEST_DATA_DIR "/Echo-x86_64.AppImage"), IOError);
+    ASSERT_THROW(Iso9660Index(TEST_DATA_DIR "/missing"), IOError);
+
+    // libarchive reads the Joliet names of the images without Rock Ridge extensions
+    ASSERT_THROW(Iso9660Index(TEST_DATA_DIR "/AppImageExtract_6_joliet-x86_64.AppImage"), IOError);
+}
@@ -0,0 +1,214 @@
+// system
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// library
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/AppImage.h>
+#include <appimage/core/exceptions.h>
+#include <core/impl/SquashfsFileWriter.h>
+#include "TemporaryDirectory.h"
+
+using namespace appimage::core;
+using namespace appimage::core::impl;
+
+namespace {
+    // squashfs blocks of the fixture below
+    constexpr off_t BLOCK_SIZE = 128 * 1024;
+
+    /*
+     * Payload made with mksquashfs:
+     * - sparse.bin: compressed block, 2 sparse blocks, compressed block, 2 trailing sparse blocks
+     * - sparse-raw.bin: uncompressed block, sparse block, compressed block, trailing sparse tail
+     * - usr/bin/tool and tool-link: the same inode
+     */
+    const std::string SPARSE_HARDLINKS_APPIMAGE = TEST_DATA_DIR "/Sparse_Hardlinks-x86_64.AppImage";
+
+    /**
+     * @return true if the files system holding <dir> keeps the holes of sparse files
+     */
+    bool keepsHoles(const std::filesystem::path& dir) {
+        const auto path = dir / "holes-probe";
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1)
+            return false;
+
+        struct stat st = {};
+        const bool result = ftruncate(fd, 16 * BLOCK_SIZE) == 0 && fstat(fd, &st) == 0 && st.st_blocks == 0;
+        close(fd);
+        unlink(path.c_str());
+        return result;
+    }
+
+    std::string readFile(const std::filesystem::path& path) {
+        std::ifstream input(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    }
+
+    std::string readEntry(const AppImage& appImage, const std::string& path) {
+        auto entry = appImage.lookup(path);
+        return {std::istreambuf_iterator<char>(entry.read()), std::istreambuf_iterator<char>()};
+    }
+
+    /**
+     * Check that the extracted sparse files contents match the payload and that the sparse blocks are holes
+     */
+    void assertSparseFiles(const AppImage& appImage, const std::filesystem::path& dir) {
+        for (const std::string path : {"sparse.bin", "sparse-raw.bin"})
+            ASSERT_EQ(readFile(dir / path), readEntry(appImage, path)) << path;
+
+        struct stat st = {};
+        ASSERT_EQ(stat((dir / "sparse.bin").c_str(), &st), 0);
+        ASSERT_EQ(st.st_size, 6 * BLOCK_SIZE);
+        // only the 2 data blocks are allocated
+        ASSERT_LE(st.st_blocks * 512, 2 * BLOCK_SIZE);
+
+        int fd = open((dir / "sparse.bin").c_str(), O_RDONLY);
+        ASSERT_GE(fd, 0);
+        EXPECT_EQ(lseek(fd, 0, SEEK_HOLE), BLOCK_SIZE);
+        EXPECT_EQ(lseek(fd, BLOCK_SIZE, SEEK_DATA), 3 * BLOCK_SIZE);
+        EXPECT_EQ(lseek(fd, 3 * BLOCK_SIZE, SEEK_HOLE), 4 * BLOCK_SIZE);
+        close(fd);
+
+        ASSERT_EQ(stat((dir / "sparse-raw.bin").c_str(), &st), 0);
+        ASSERT_LE(st.st_blocks * 512, 2 * BLOCK_SIZE + 4096);
+
+        fd = open((dir / "sparse-raw.bin").c_str(), O_RDONLY);
+        ASSERT_GE(fd, 0);
+        EXPECT_EQ(lseek(fd, 0, SEEK_HOLE), BLOCK_SIZE);
+        EXPECT_EQ(lseek(fd, BLOCK_SIZE, SEEK_DATA), 2 * BLOCK_SIZE);
+        EXPECT_EQ(lseek(fd, 2 * BLOCK_SIZE, SEEK_HOLE), 3 * BLOCK_SIZE);
+        close(fd);
+    }
+
+    void assertHardLinks(const std::filesystem::path& dir) {
+        struct stat toolStat = {};
+        struct stat linkStat = {};
+        ASSERT_EQ(stat((dir / "usr/bin/tool").c_str(), &toolStat), 0);
+        ASSERT_EQ(stat((dir / "tool-link").c_str(), &linkStat), 0);
+        ASSERT_EQ(toolStat.st_ino, linkStat.st_ino);
+        ASSERT_EQ(toolStat.st_nlink, 2u);
+    }
+}
+
+TEST(TestSquashfsFileWriter, createHardLink) {
+    const TemporaryDirectory tmpDir;
+    const auto source = tmpDir.path() / "source";
+    const auto target = tmpDir.path() / "target";
+
+    std::ofstream(source.string()) << "contents";
+
+    // existing targets are replaced
+    std::ofstream(target.string()) << "old contents";
+
+    createHardLink(source.string(), target.string());
+
+    struct stat sourceStat = {};
+    struct stat targetStat = {};
+    ASSERT_EQ(stat(source.c_str(), &sourceStat), 0);
+    ASSERT_EQ(stat(target.c_str(), &targetStat), 0);
+    ASSERT_EQ(sourceStat.st_ino, targetStat.st_ino);
+    ASSERT_EQ(targetStat.st_nlink, 2u);
+}
+
+TEST(TestSquashfsFileWriter, createHardLinkMissingSource) {
+    const TemporaryDirectory tmpDir;
+    ASSERT_THROW(createHardLink((tmpDir.path() / "missing").string(), (tmpDir.path() / "target").string()),
+                 FileSystemError);
+}
+
+TEST(TestSquashfsFileWriter, copyFileRange) {
+    const TemporaryDirectory tmpDir;
+    const auto source = tmpDir.path() / "source";
+    const auto target = tmpDir.path() / "target";
+
+    std::ofstream(source.string()) << "0123456789";
+
+    int inFd = open(source.c_str(), O_RDONLY);
+    int outFd = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(inFd, 0);
+    ASSERT_GE(outFd, 0);
+
+    // the fallback buffer is smaller than the range to exercise the chunked copy
+    std::vector<char> buffer(3);
+    copyFileRange(inFd, 2, outFd, 4, 6, buffer, target.string());
+    copyFileRange(inFd, 0, outFd, 0, 4, buffer, target.string());
+
+    close(inFd);
+    close(outFd);
+
+    std::ifstream in(target.string());
+    std::stringstream contents;
+    contents << in.rdbuf();
+    ASSERT_EQ(contents.str(), "0123234567");
+}
+
+TEST(TestSquashfsFileWriter, copyFileRangePastEnd) {
+    const TemporaryDirectory tmpDir;
+    const auto source = tmpDir.path() / "source";
+    const auto target = tmpDir.path() / "target";
+
+    std::ofstream(source.string()) << "0123";
+
+    int inFd = open(source.c_str(), O_RDONLY);
+    int outFd = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    std::vector<char> buffer(16);
+    ASSERT_THROW(copyFileRange(inFd, 2, outFd, 0, 8, buffer, target.string()), IOError);
+
+    close(inFd);
+    close(outFd);
+}
+
+TEST(TestSquashfsFileWriter, extractAllSparseFiles) {
+    const TemporaryDirectory tmpDir;
+    if (!keepsHoles(tmpDir.path()))
+        GTEST_SKIP() << "The temporary files system doesn't keep holes";
+
+    const AppImage appImage(SPARSE_HARDLINKS_APPIMAGE);
+    appImage.extractAll((tmpDir.path() / "squashfs-root").string());
+    assertSparseFiles(appImage, tmpDir.path() / "squashfs-root");
+}
+
+TEST(TestSquashfsFileWriter, extractToSparseFiles) {
+    const TemporaryDirectory tmpDir;
+    if (!keepsHoles(tmpDir.path()))
+        GTEST_SKIP() << "The temporary files system doesn't keep holes";
+
+    const AppImage appImage(SPARSE_HARDLINKS_APPIMAGE);
+    for (auto itr = appImage.files(); itr != itr.end(); ++itr) {
+        if (itr.type() == PayloadEntryType::REGULAR)
+            itr.extractTo((tmpDir.path() / itr.path()).string());
+    }
+
+    assertSparseFiles(appImage, tmpDir.path());
+}
+
+TEST(TestSquashfsFileWriter, extractAllHardLinks) {
+    const TemporaryDirectory tmpDir;
+    const AppImage appImage(SPARSE_HARDLINKS_APPIMAGE);
+    appImage.extractAll((tmpDir.path() / "squashfs-root").string());
+
+    assertHardLinks(tmpDir.path() / "squashfs-root");
+    ASSERT_EQ(readFile(tmpDir.path() / "squashfs-root/tool-link"), readEntry(appImage, "usr/bin/tool"));
+}
+
+TEST(TestSquashfsFileWriter, extractToHardLinks) {
+    const TemporaryDirectory tmpDir;
+    const AppImage appImage(SPARSE_HARDLINKS_APPIMAGE);
+    for (auto itr = appImage.files(); itr != itr.end(); ++itr) {
+        if (itr.type() == PayloadEntryType::REGULAR)
+            itr.extractTo((tmpDir.path() / itr.path()).string());
+    }
+
+    assertHardLinks(tmpDir.path());
+    ASSERT_EQ(readFile(tmpDir.path() / "tool-link"), readEntry(appImage, "usr/bin/tool"));
+}
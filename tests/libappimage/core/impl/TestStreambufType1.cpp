@@ -0,0 +1,137 @@
+// system
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+// library
+#include <gtest/gtest.h>
+#include <archive.h>
+#include <archive_entry.h>
+
+// local
+#include <core/impl/StreambufType1.h>
+#include "TemporaryDirectory.h"
+
+using namespace appimage::core::impl;
+
+namespace {
+    std::string readStream(archive* a, int64_t) {
+        StreambufType1 streambuf(a);
+        return {std::istreambuf_iterator<char>(&streambuf), std::istreambuf_iterator<char>()};
+    }
+
+    // contents as TraversalType1::extract writes them, holes included
+    std::string readExtracted(archive* a, int64_t size, const std::filesystem::path& target) {
+        const int fd = open(target.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        EXPECT_NE(fd, -1);
+        EXPECT_EQ(archive_read_data_into_fd(a, fd), ARCHIVE_OK);
+        EXPECT_EQ(ftruncate(fd, size), 0);
+        close(fd);
+
+        std::ifstream file(target, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    /**
+     * Read the regular entries of <a>, with <reader>, until the end of the archive. <reader> is called with the
+     * archive and the entry size.
+     * @return contents by entry path
+     */
+    template<typename Reader>
+    std::map<std::string, std::string> readEntries(archive* a, Reader reader) {
+        std::map<std::string, std::string> contents;
+
+        archive_entry* entry;
+        while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
+            if (archive_entry_filetype(entry) == AE_IFREG)
+                contents[archive_entry_pathname(entry)] = reader(a, archive_entry_size(entry));
+        }
+
+        return contents;
+    }
+
+    archive* openImage(const std::string& path) {
+        archive* a = archive_read_new();
+        archive_read_support_format_iso9660(a);
+        EXPECT_EQ(archive_read_open_filename(a, path.c_str(), 10240), ARCHIVE_OK);
+        return a;
+    }
+
+    archive* openMemory(const std::vector<char>& data) {
+        archive* a = archive_read_new();
+        archive_read_support_format_tar(a);
+        EXPECT_EQ(archive_read_open_memory(a, data.data(), data.size()), ARCHIVE_OK);
+        return a;
+    }
+}
+
+TEST(TestStreambufType1, readEntries) {
+    const TemporaryDirectory tmpDir;
+
+    for (const auto& name : {"/AppImageExtract_6-x86_64.AppImage", "/AppImageExtract_6_joliet-x86_64.AppImage"}) {
+        const std::string path = std::string(TEST_DATA_DIR) + name;
+
+        archive* a = openImage(path);
+        const auto streamed = readEntries(a, readStream);
+        archive_read_free(a);
+
+        a = openImage(path);
+        const auto extracted = readEntries(a, [&](archive* a, int64_t size) {
+            return readExtracted(a, size, tmpDir.path() / "entry");
+        });
+        archive_read_free(a);
+
+        ASSERT_FALSE(streamed.empty()) << name;
+        ASSERT_EQ(streamed, extracted) << name;
+    }
+}
+
+TEST(TestStreambufType1, readHoles) {
+    // none of the type 1 fixtures holds sparse files, libarchive reports their holes the same way for sparse tars
+    // data, a hole larger than the zeros buffer, data and a trailing hole
+    std::string expected(400 * 1024, '\0');
+    expected.replace(0, 1000, 1000, 'x');
+    expected.replace(200 * 1024, 1000, 1000, 'y');
+
+    std::vector<char> tar(1024 * 1024);
+    size_t tarSize = 0;
+    archive* w = archive_write_new();
+    archive_write_set_format_pax_restricted(w);
+    ASSERT_EQ(archive_write_open_memory(w, tar.data(), tar.size(), &tarSize), ARCHIVE_OK);
+
+    archive_entry* entry = archive_entry_new();
+    archive_entry_set_pathname(entry, "sparse");
+    archive_entry_set_filetype(entry, AE_IFREG);
+    archive_entry_set_perm(entry, 0644);
+    archive_entry_set_size(entry, (la_int64_t) expected.size());
+    archive_entry_sparse_add_entry(entry, 0, 1000);
+    archive_entry_sparse_add_entry(entry, 200 * 1024, 1000);
+    ASSERT_EQ(archive_write_header(w, entry), ARCHIVE_OK);
+
+    // the writer skips the holes of the data
+    ASSERT_EQ(archive_write_data(w, expected.data(), expected.size()), (la_ssize_t) expected.size());
+    archive_entry_free(entry);
+    archive_write_close(w);
+    archive_write_free(w);
+    tar.resize(tarSize);
+
+    const TemporaryDirectory tmpDir;
+
+    archive* a = openMemory(tar);
+    const auto streamed = readEntries(a, readStream);
+    archive_read_free(a);
+
+    a = openMemory(tar);
+    const auto extracted = readEntries(a, [&](archive* a, int64_t size) {
+        return readExtracted(a, size, tmpDir.path() / "entry");
+    });
+    archive_read_free(a);
+
+    ASSERT_TRUE(streamed.at("sparse") == expected);
+    ASSERT_TRUE(streamed == extracted);
+}
@@ -1,12 +1,14 @@
 // system
 #include <fstream>
 #include <filesystem>
+#include <set>
 
 // library
 #include <gtest/gtest.h>
 
 // local
 #include <appimage/core/exceptions.h>
+#include <core/impl/PayloadReaderType1.h>
 #include <core/impl/TraversalType1.h>
 #include "TemporaryDirectory.h"
 
@@ -60,7 +62,7 @@ TEST_F(TestTraversalType1, extract) {
 
     while (!traversal.isCompleted()) {
         if (traversal.getEntryPath() == "AppImageExtract.desktop") {
-            traversal.extract(tmpFilePath);
+            traversal.extract(tmpFilePath, ExtractOptions());
             ASSERT_TRUE(std::filesystem::file_size(tmpFilePath) > 0);
             break;
         }
@@ -112,3 +114,112 @@ TEST_F(TestTraversalType1, getEntryLink) {
         traversal.next();
     }
 }
+
+TEST(TestTraversalType1Joliet, entryIds) {
+    // the image has no Rock Ridge extensions, libarchive reports the Joliet names
+    const std::string path = TEST_DATA_DIR "/AppImageExtract_6_joliet-x86_64.AppImage";
+    PayloadReaderType1 reader(path);
+
+    std::set<std::string> paths;
+    for (TraversalType1 traversal(path); !traversal.isCompleted(); traversal.next()) {
+        paths.insert(traversal.getEntryPath());
+
+        const auto entry = reader.open(traversal.getEntryId());
+        ASSERT_EQ(entry.path, traversal.getEntryPath());
+        ASSERT_EQ(entry.type, traversal.getEntryType()) << entry.path;
+        ASSERT_EQ(entry.linkTarget, traversal.getEntryLinkTarget()) << entry.path;
+    }
+
+    ASSERT_TRUE(paths.count(".DirIcon"));
+    ASSERT_TRUE(paths.count("AppImageExtract.desktop"));
+    ASSERT_TRUE(paths.count("usr/bin/appimageextract"));
+}
+
+TEST(TestTraversalType1Joliet, read) {
+    const std::string path = TEST_DATA_DIR "/AppImageExtract_6_joliet-x86_64.AppImage";
+    PayloadReaderType1 reader(path);
+
+    for (TraversalType1 traversal(path); !traversal.isCompleted(); traversal.next()) {
+        if (traversal.getEntryType() != PayloadEntryType::REGULAR)
+            continue;
+
+        PayloadReader::Entry entry;
+        ASSERT_TRUE(reader.lookup(traversal.getEntryPath(), entry));
+        auto streambuf = reader.read(entry);
+        const std::string expected{std::istreambuf_iterator<char>(streambuf.get()), std::istreambuf_iterator<char>()};
+
+        // reading the entry again continues where the previous read stopped
+        char head[16] = {};
+        traversal.read().read(head, sizeof(head));
+        const std::string content = std::string(head, traversal.read().gcount()) +
+                                    std::string{std::istreambuf_iterator<char>(traversal.read()),
+                                                std::istreambuf_iterator<char>()};
+
+        ASSERT_EQ(content, expected) << traversal.getEntryPath();
+    }
+}
+
+TEST(TestTraversalType1Reader, matchesPayloadReader) {
+    // both must report the same entries, whether the image is indexed or read by libarchive
+    for (const std::string path : {TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage",
+                                   TEST_DATA_DIR "/AppImageExtract_6_joliet-x86_64.AppImage"}) {
+        PayloadReaderType1 reader(path);
+
+        for (TraversalType1 traversal(path); !traversal.isCompleted(); traversal.next()) {
+            PayloadReader::Entry entry;
+            ASSERT_TRUE(reader.lookup(traversal.getEntryPath(), entry)) << traversal.getEntryPath();
+            ASSERT_EQ(entry.id, traversal.getEntryId()) << entry.path;
+            ASSERT_EQ(entry.type, traversal.getEntryType()) << entry.path;
+            ASSERT_EQ(entry.linkTarget, traversal.getEntryLinkTarget()) << entry.path;
+            ASSERT_EQ(entry.stat.size, traversal.getEntryStat().size) << entry.path;
+
+            if (entry.type != PayloadEntryType::REGULAR)
+                continue;
+
+            auto streambuf = reader.read(entry);
+            const std::string contents{std::istreambuf_iterator<char>(streambuf.get()),
+                                       std::istreambuf_iterator<char>()};
+            const std::string traversalContents{std::istreambuf_iterator<char>(traversal.read()),
+                                                std::istreambuf_iterator<char>()};
+            ASSERT_EQ(contents, traversalContents) << entry.path;
+        }
+    }
+}
+
+TEST(TestTraversalType1Copy, extractCopiesExtents) {
+    // plain files of indexed images are copied from their extents, zisofs compressed ones and the files of images
+    // read by libarchive are decompressed and written
+    for (const std::string path : {TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage",
+                                   TEST_DATA_DIR "/AppImageExtract_6_joliet-x86_64.AppImage"}) {
+        const bool indexed = path.find("joliet") == std::string::npos;
+        const TemporaryDirectory tmpDir;
+        PayloadReaderType1 reader(path);
+
+        size_t copiedFiles = 0;
+        for (TraversalType1 traversal(path); !traversal.isCompleted(); traversal.next()) {
+            if (traversal.getEntryType() != PayloadEntryType::REGULAR)
+                continue;
+
+            if (!indexed) {
+                ASSERT_FALSE(traversal.isEntryCopyable()) << traversal.getEntryPath();
+            }
+            copiedFiles += traversal.isEntryCopyable();
+
+            const auto target = tmpDir.path() / traversal.getEntryPath();
+            traversal.extract(target, ExtractOptions());
+
+            PayloadReader::Entry entry;
+            ASSERT_TRUE(reader.lookup(traversal.getEntryPath(), entry));
+            auto streambuf = reader.read(entry);
+            const std::string expected{std::istreambuf_iterator<char>(streambuf.get()),
+                                       std::istreambuf_iterator<char>()};
+
+            std::ifstream input(target, std::ios::binary);
+            const std::string contents{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+            ASSERT_EQ(contents, expected) << traversal.getEntryPath();
+        }
+
+        // .DirIcon, AppImageExtract.desktop and usr/bin/appimageextract are not compressed
+        ASSERT_EQ(copiedFiles, indexed ? 3u : 0u);
+    }
+}
@@ -63,7 +63,7 @@ TEST_F(TestTraversalType2, extract) {
     while (!traversal.isCompleted()) {
         // extract symlink
         if (traversal.getEntryPath() == ".DirIcon") {
-            traversal.extract(tmpFilePath);
+            traversal.extract(tmpFilePath, ExtractOptions());
 
             ASSERT_TRUE(std::filesystem::is_symlink(tmpFilePath));
 
@@ -76,7 +76,7 @@ TEST_F(TestTraversalType2, extract) {
 
         // extract dir
         if (traversal.getEntryPath() == "usr") {
-            traversal.extract(tmpFilePath);
+            traversal.extract(tmpFilePath, ExtractOptions());
 
             ASSERT_TRUE(std::filesystem::is_directory(tmpFilePath));
         }
@@ -117,3 +117,57 @@ TEST_F(TestTraversalType2, getEntryLink) {
         traversal.next();
     }
 }
+
+TEST_F(TestTraversalType2, entryDataOnDemand) {
+    while (!traversal.isCompleted()) {
+        // the path can be viewed without being copied
+        ASSERT_EQ(traversal.getEntryPathView(), traversal.getEntryPath());
+
+        if (traversal.getEntryPath() == "usr/bin/echo") {
+            ASSERT_GT(traversal.getEntrySize(), 0u);
+            ASSERT_TRUE(S_ISREG(traversal.getEntryMode()));
+
+            const auto stat = traversal.getEntryStat();
+            ASSERT_EQ(stat.size, traversal.getEntrySize());
+            ASSERT_EQ(stat.mode, traversal.getEntryMode());
+            ASSERT_GT(stat.nlink, 0u);
+        }
+
+        // links read their target only when requested
+        if (traversal.getEntryType() == PayloadEntryType::LINK)
+            ASSERT_FALSE(traversal.getEntryLinkTarget().empty());
+        else
+            ASSERT_TRUE(traversal.getEntryLinkTarget().empty());
+
+        traversal.next();
+    }
+
+    ASSERT_TRUE(traversal.getEntryPathView().empty());
+}
+
+TEST_F(TestTraversalType2, readInChunks) {
+    // read the entry char by char
+    std::string expected;
+    {
+        TraversalType2 otherTraversal(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+        while (!otherTraversal.isCompleted() && otherTraversal.getEntryPath() != "usr/bin/echo")
+            otherTraversal.next();
+
+        expected.assign(std::istreambuf_iterator<char>(otherTraversal.read()), std::istreambuf_iterator<char>());
+    }
+    ASSERT_FALSE(expected.empty());
+
+    while (!traversal.isCompleted() && traversal.getEntryPath() != "usr/bin/echo")
+        traversal.next();
+
+    // mix small reads served from the internal buffer with large reads copied straight into the target
+    auto& stream = traversal.read();
+    std::string content;
+    std::vector<char> buffer(expected.size() + 1);
+    for (std::streamsize chunkSize : {7, 300000, 13, 4096}) {
+        stream.read(buffer.data(), chunkSize);
+        content.append(buffer.data(), stream.gcount());
+    }
+
+    ASSERT_EQ(expected, content);
+}
@@ -3,7 +3,10 @@
 #include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <map>
 #include <memory>
+#include <set>
+#include <string>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -125,6 +128,52 @@ TEST_F(LibAppImageTest, appimage_extract_file_following_symlinks) {
     remove(target_path.c_str());
 }
 
+TEST_F(LibAppImageTest, appimage_extract_all) {
+    std::string target_dir = tempDir + "/test_libappimage_extract_all";
+    ASSERT_TRUE(appimage_extract_all(appImage_type_2_file_path.c_str(), target_dir.c_str(), 2));
+
+    std::string desktop_file_path = target_dir + "/echo.desktop";
+    ASSERT_TRUE(g_file_test(desktop_file_path.c_str(), G_FILE_TEST_EXISTS));
+
+    ASSERT_FALSE(appimage_extract_all(elf_file_path.c_str(), target_dir.c_str(), 2));
+}
+
+static void count_scan_results(const struct appimage_scan_result* result, void* user_data) {
+    auto types = static_cast<std::map<std::string, int>*>(user_data);
+    (*types)[result->path] = result->type;
+}
+
+TEST_F(LibAppImageTest, appimage_scan_files) {
+    const char* paths[] = {appImage_type_1_file_path.c_str(), appImage_type_2_file_path.c_str(),
+                           elf_file_path.c_str(), NULL};
+
+    std::map<std::string, int> types;
+    ASSERT_TRUE(appimage_scan_files(paths, 2, count_scan_results, &types));
+
+    ASSERT_EQ(types.size(), 3);
+    EXPECT_EQ(types[appImage_type_1_file_path], 1);
+    EXPECT_EQ(types[appImage_type_2_file_path], 2);
+    EXPECT_EQ(types[elf_file_path], -1);
+
+    ASSERT_FALSE(appimage_scan_directory("/missing_dir", 0, count_scan_results, &types));
+}
+
+TEST_F(LibAppImageTest, appimage_get_info) {
+    struct appimage_info* info = appimage_get_info(appImage_type_2_file_path.c_str());
+    ASSERT_NE(info, nullptr);
+
+    EXPECT_EQ(info->type, 2);
+    EXPECT_EQ(info->payload_offset, appimage_get_payload_offset(appImage_type_2_file_path.c_str()));
+    EXPECT_STREQ(info->desktop_entry_path, "echo.desktop");
+    EXPECT_NE(info->desktop_entry, nullptr);
+    EXPECT_NE(info->icon_paths, nullptr);
+    EXPECT_NE(info->icon_paths[0], nullptr);
+
+    appimage_info_free(info);
+
+    ASSERT_EQ(appimage_get_info(elf_file_path.c_str()), nullptr);
+}
+
 TEST_F(LibAppImageTest, appimage_extract_file_following_hardlinks_type_1) {
     const char target_file_path[] = "/tmp/appimage_tmp_file";
     appimage_extract_file_following_symlinks(appImage_type_1_file_path.c_str(),
@@ -290,6 +339,52 @@ TEST_F(LibAppImageTest, test_appimage_is_terminal_app) {
     EXPECT_EQ(appimage_is_terminal_app("/invalid/path"), -1);
 }
 
+TEST_F(LibAppImageTest, appimage_handle) {
+    ASSERT_EQ(appimage_open("/invalid/path"), nullptr);
+
+    struct appimage_handle* handle = appimage_open(appImage_type_2_terminal_file_path.c_str());
+    ASSERT_NE(handle, nullptr);
+
+    EXPECT_EQ(appimage_handle_get_type(handle), 2);
+    EXPECT_EQ(appimage_handle_get_payload_offset(handle),
+              appimage_get_payload_offset(appImage_type_2_terminal_file_path.c_str()));
+    EXPECT_EQ(appimage_handle_is_terminal_app(handle), 1);
+
+    // the same entries are listed from the handle index
+    char** files = appimage_handle_list_files(handle);
+    char** expectedFiles = appimage_list_files(appImage_type_2_terminal_file_path.c_str());
+    ASSERT_NE(files, nullptr);
+    EXPECT_NE(files[0], nullptr);
+
+    std::set<std::string> filesSet, expectedFilesSet;
+    for (char** ptr = files; *ptr != nullptr; ptr++)
+        filesSet.insert(*ptr);
+    for (char** ptr = expectedFiles; *ptr != nullptr; ptr++)
+        expectedFilesSet.insert(*ptr);
+    EXPECT_EQ(filesSet, expectedFilesSet);
+
+    appimage_string_list_free(files);
+    appimage_string_list_free(expectedFiles);
+
+    char* md5 = appimage_handle_get_md5(handle);
+    char* expectedMd5 = appimage_get_md5(appImage_type_2_terminal_file_path.c_str());
+    EXPECT_STREQ(md5, expectedMd5);
+    free(md5);
+    free(expectedMd5);
+
+    char* buffer = nullptr;
+    unsigned long bufferSize = 0;
+    EXPECT_TRUE(appimage_handle_read_file_into_buffer_following_symlinks(handle, "AppRun", &buffer, &bufferSize));
+    EXPECT_GT(bufferSize, 0);
+    free(buffer);
+
+    EXPECT_FALSE(appimage_handle_read_file_into_buffer_following_symlinks(handle, "missing_file", &buffer,
+                                                                          &bufferSize));
+    EXPECT_EQ(buffer, nullptr);
+
+    appimage_close(handle);
+}
+
 // compares whether the size first bytes of two given byte buffers are equal
 bool test_compare_bytes(const char* buf1, const char* buf2, int size) {
     for (int i = 0; i < size; i++) {
@@ -339,6 +434,31 @@ TEST_F(LibAppImageTest, appimage_is_registered_in_system) {
     appimage_unregister_in_system(appImage_type_2_file_path.c_str(), false);
 }
 
+TEST_F(LibAppImageTest, appimage_handle_registration) {
+    struct appimage_handle* handle = appimage_open(appImage_type_2_file_path.c_str());
+    ASSERT_NE(handle, nullptr);
+
+    appimage_handle_unregister_in_system(handle, false);
+    EXPECT_FALSE(appimage_handle_is_registered_in_system(handle));
+    EXPECT_EQ(appimage_handle_registered_desktop_file_path(handle, false), nullptr);
+
+    EXPECT_EQ(appimage_handle_register_in_system(handle, false), 0);
+    EXPECT_TRUE(appimage_handle_is_registered_in_system(handle));
+
+    char* desktop_file_path = appimage_handle_registered_desktop_file_path(handle, false);
+    char* expected_desktop_file_path = appimage_registered_desktop_file_path(appImage_type_2_file_path.c_str(),
+                                                                              NULL, false);
+    EXPECT_NE(desktop_file_path, nullptr);
+    EXPECT_STREQ(desktop_file_path, expected_desktop_file_path);
+    free(desktop_file_path);
+    free(expected_desktop_file_path);
+
+    EXPECT_EQ(appimage_handle_unregister_in_system(handle, false), 0);
+    EXPECT_FALSE(appimage_handle_is_registered_in_system(handle));
+
+    appimage_close(handle);
+}
+
 TEST_F(LibAppImageTest, test_appimage_registered_desktop_file_path_type1) {
     EXPECT_TRUE(appimage_type1_register_in_system(appImage_type_1_file_path.c_str(), false));
 
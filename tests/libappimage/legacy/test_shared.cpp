@@ -67,6 +67,27 @@ TEST_F(LibAppImageSharedTest, test_appimage_get_elf_section_offset_and_length) {
 }
 
 
+TEST_F(LibAppImageSharedTest, test_appimage_get_elf_sections_offset_and_length) {
+    std::string appImagePath = std::string(TEST_DATA_DIR) + "/appimaged-i686.AppImage";
+
+    const char* const sectionNames[] = {".upd_info", ".sha256_sig", ".missing_section"};
+    unsigned long offsets[3] = {0, 0, 0}, lengths[3] = {0, 0, 0};
+
+    ASSERT_TRUE(appimage_get_elf_sections_offset_and_length(appImagePath.c_str(), sectionNames, 3, offsets, lengths));
+
+    unsigned long offset, length;
+    ASSERT_TRUE(appimage_get_elf_section_offset_and_length(appImagePath.c_str(), ".upd_info", &offset, &length));
+    EXPECT_EQ(offsets[0], offset);
+    EXPECT_EQ(lengths[0], length);
+
+    EXPECT_GT(offsets[1], 0);
+    EXPECT_GT(lengths[1], 0);
+
+    EXPECT_EQ(offsets[2], 0);
+    EXPECT_EQ(lengths[2], 0);
+}
+
+
 TEST_F(LibAppImageSharedTest, test_print_binary) {
     std::string appImagePath = std::string(TEST_DATA_DIR) + "/appimaged-i686.AppImage";
 
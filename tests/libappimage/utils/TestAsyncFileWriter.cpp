@@ -0,0 +1,76 @@
+// system
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+// libraries
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/exceptions.h>
+#include "utils/AsyncFileWriter.h"
+#include "TemporaryDirectory.h"
+
+using namespace appimage::utils;
+
+namespace {
+    std::string readFile(const std::filesystem::path& path) {
+        std::ifstream input(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    }
+
+    void checkWrites(AsyncFileWriter::Backend backend) {
+        const TemporaryDirectory tmpDir;
+
+        // the pending contents limit is lower than the total size so the callers get blocked
+        AsyncFileWriter writer(backend, 2, 4096);
+        for (int i = 0; i < 200; ++i) {
+            std::vector<char> data(i * 7, char('a' + i % 26));
+            writer.write((tmpDir.path() / std::to_string(i)).string(), 0750, std::move(data));
+        }
+        writer.finish();
+
+        for (int i = 0; i < 200; ++i) {
+            const auto path = tmpDir.path() / std::to_string(i);
+            ASSERT_EQ(readFile(path), std::string(i * 7, char('a' + i % 26))) << path;
+
+            struct stat st = {};
+            ASSERT_EQ(stat(path.c_str(), &st), 0);
+            ASSERT_EQ(st.st_mode & 07777, 0750u) << path;
+        }
+
+        // requests fail as a whole, the next ones are rejected
+        writer.write((tmpDir.path() / "missing" / "file").string(), 0644, {'a'});
+        ASSERT_THROW(writer.finish(), appimage::core::FileSystemError);
+        ASSERT_THROW(writer.write((tmpDir.path() / "other").string(), 0644, {'a'}), appimage::core::FileSystemError);
+    }
+}
+
+TEST(TestAsyncFileWriter, threads) {
+    AsyncFileWriter writer(AsyncFileWriter::Backend::THREADS);
+    ASSERT_EQ(writer.backend(), AsyncFileWriter::Backend::THREADS);
+
+    checkWrites(AsyncFileWriter::Backend::THREADS);
+}
+
+TEST(TestAsyncFileWriter, ioUring) {
+    // falls back to the threads backend when io_uring is not available
+    AsyncFileWriter writer(AsyncFileWriter::Backend::IO_URING);
+    ASSERT_NE(writer.backend(), AsyncFileWriter::Backend::AUTO);
+
+    checkWrites(AsyncFileWriter::Backend::IO_URING);
+}
+
+TEST(TestAsyncFileWriter, overwrite) {
+    const TemporaryDirectory tmpDir;
+    const auto path = tmpDir.path() / "file";
+    std::ofstream(path.string()) << "previous longer contents";
+
+    AsyncFileWriter writer;
+    writer.write(path.string(), 0644, {'n', 'e', 'w'});
+    writer.finish();
+
+    ASSERT_EQ(readFile(path), "new");
+}
@@ -0,0 +1,85 @@
+// system
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// libraries
+#include <gtest/gtest.h>
+
+// local
+#include "utils/BlockPipeline.h"
+
+using namespace appimage::utils;
+
+TEST(TestBlockPipeline, blocksKeepTheirOrder) {
+    std::string input;
+    for (int i = 0; i < 10000; ++i)
+        input += std::to_string(i);
+
+    size_t position = 0;
+    std::string output;
+
+    BlockPipeline pipeline(2, 7);
+    pipeline.run([&](char* block, size_t capacity) {
+        const auto size = std::min(capacity, input.size() - position);
+        input.copy(block, size, position);
+        position += size;
+        return size;
+    }, [&](const char* data, size_t size) {
+        output.append(data, size);
+    });
+
+    ASSERT_EQ(output, input);
+}
+
+TEST(TestBlockPipeline, boundedQueue) {
+    const unsigned int depth = 2;
+    std::atomic<unsigned int> produced{0};
+    unsigned int producedWhileConsuming = 0;
+
+    BlockPipeline pipeline(depth, 16);
+    pipeline.run([&](char*, size_t capacity) {
+        return ++produced > 10 ? size_t(0) : capacity;
+    }, [&](const char*, size_t) {
+        // stall on the first block so the producer runs into the end of the pool
+        if (producedWhileConsuming == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            producedWhileConsuming = produced;
+        }
+    });
+
+    // the block being consumed plus at most <depth> waiting ones
+    ASSERT_LE(producedWhileConsuming, depth + 1);
+}
+
+TEST(TestBlockPipeline, emptyStream) {
+    bool consumed = false;
+
+    BlockPipeline pipeline(4, 16);
+    pipeline.run([](char*, size_t) { return size_t(0); }, [&](const char*, size_t) { consumed = true; });
+
+    ASSERT_FALSE(consumed);
+}
+
+TEST(TestBlockPipeline, producerError) {
+    int blocks = 0;
+
+    BlockPipeline pipeline(1, 16);
+    ASSERT_THROW(pipeline.run([&](char*, size_t capacity) {
+        if (++blocks == 5)
+            throw std::runtime_error("read error");
+
+        return capacity;
+    }, [](const char*, size_t) {}), std::runtime_error);
+}
+
+TEST(TestBlockPipeline, consumerError) {
+    // the producer never ends the stream, it must be stopped by the consumer failure
+    BlockPipeline pipeline(3, 16);
+    ASSERT_THROW(pipeline.run([](char*, size_t capacity) { return capacity; }, [](const char*, size_t) {
+        throw std::runtime_error("write error");
+    }), std::runtime_error);
+}
@@ -0,0 +1,148 @@
+// system
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+// libraries
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/exceptions.h>
+#include "utils/ContentStore.h"
+#include "TemporaryDirectory.h"
+
+using namespace appimage::utils;
+
+namespace {
+    std::string readFile(const std::filesystem::path& path) {
+        std::ifstream input(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    }
+
+    struct stat statFile(const std::filesystem::path& path) {
+        struct stat st = {};
+        stat(path.c_str(), &st);
+        return st;
+    }
+
+    void storeString(ContentStore& store, const std::string& source, uint64_t entryId, const std::string& data,
+                     mode_t mode, const std::filesystem::path& target) {
+        std::stringbuf streambuf(data);
+        store.store(source, entryId, data.size(), mode, streambuf, target.string());
+    }
+}
+
+TEST(TestContentStore, storeHardLinks) {
+    const TemporaryDirectory tmpDir;
+    const auto storePath = tmpDir.path() / "store";
+    ContentStore store(storePath.string());
+
+    storeString(store, "first", 1, "hello", 0755, tmpDir.path() / "a");
+    storeString(store, "second", 7, "hello", 0755, tmpDir.path() / "b");
+
+    // objects are named after the md5 sum, size and permissions of their contents
+    const auto objectPath = storePath / "objects" / "5d" / "41402abc4b2a76b9719d911017c592-5-755";
+    ASSERT_EQ(readFile(objectPath), "hello");
+    ASSERT_EQ(readFile(tmpDir.path() / "a"), "hello");
+    ASSERT_EQ(statFile(tmpDir.path() / "a").st_mode & 07777, 0755u);
+
+    // both targets are links of the same object
+    ASSERT_EQ(statFile(tmpDir.path() / "a").st_ino, statFile(objectPath).st_ino);
+    ASSERT_EQ(statFile(tmpDir.path() / "b").st_ino, statFile(objectPath).st_ino);
+
+    // other permissions make another object
+    storeString(store, "second", 8, "hello", 0644, tmpDir.path() / "c");
+    ASSERT_NE(statFile(tmpDir.path() / "c").st_ino, statFile(objectPath).st_ino);
+    ASSERT_EQ(statFile(tmpDir.path() / "c").st_mode & 07777, 0644u);
+
+    // empty files are stored as well
+    storeString(store, "second", 9, "", 0644, tmpDir.path() / "empty");
+    ASSERT_TRUE(std::filesystem::is_regular_file(tmpDir.path() / "empty"));
+    ASSERT_EQ(std::filesystem::file_size(tmpDir.path() / "empty"), 0u);
+
+    // nothing is left behind
+    ASSERT_TRUE(std::filesystem::is_empty(storePath / "tmp"));
+}
+
+TEST(TestContentStore, linkStored) {
+    const TemporaryDirectory tmpDir;
+    const auto storePath = tmpDir.path() / "store";
+
+    {
+        ContentStore store(storePath.string());
+        ASSERT_FALSE(store.linkStored("source", 1, 5, (tmpDir.path() / "a").string()));
+
+        storeString(store, "source", 1, "hello", 0644, tmpDir.path() / "a");
+        ASSERT_TRUE(store.linkStored("source", 1, 5, (tmpDir.path() / "b").string()));
+    }
+
+    // the records are saved when the store is closed
+    ContentStore store(storePath.string());
+    ASSERT_TRUE(store.linkStored("source", 1, 5, (tmpDir.path() / "c").string()));
+    ASSERT_EQ(readFile(tmpDir.path() / "c"), "hello");
+
+    // existing targets are replaced
+    std::ofstream(tmpDir.path() / "d") << "previous contents";
+    ASSERT_TRUE(store.linkStored("source", 1, 5, (tmpDir.path() / "d").string()));
+    ASSERT_EQ(readFile(tmpDir.path() / "d"), "hello");
+
+    // unknown entries, other sizes or removed objects must be stored again
+    ASSERT_FALSE(store.linkStored("source", 2, 5, (tmpDir.path() / "e").string()));
+    ASSERT_FALSE(store.linkStored("other", 1, 5, (tmpDir.path() / "e").string()));
+    ASSERT_FALSE(store.linkStored("source", 1, 6, (tmpDir.path() / "e").string()));
+
+    std::filesystem::remove_all(storePath / "objects");
+    ASSERT_FALSE(store.linkStored("source", 1, 5, (tmpDir.path() / "e").string()));
+    ASSERT_FALSE(std::filesystem::exists(tmpDir.path() / "e"));
+}
+
+TEST(TestContentStore, reflinks) {
+    const TemporaryDirectory tmpDir;
+    const auto storePath = tmpDir.path() / "store";
+    ContentStore store(storePath.string(), ContentStore::LinkMode::REFLINK);
+
+    storeString(store, "source", 1, "hello", 0644, tmpDir.path() / "a");
+
+    // targets are clones or copies, modifying them leaves the store untouched
+    const auto objectPath = storePath / "objects" / "5d" / "41402abc4b2a76b9719d911017c592-5-644";
+    ASSERT_NE(statFile(tmpDir.path() / "a").st_ino, statFile(objectPath).st_ino);
+    ASSERT_EQ(statFile(tmpDir.path() / "a").st_mode & 07777, 0644u);
+
+    std::ofstream(tmpDir.path() / "a") << "modified";
+    ASSERT_EQ(readFile(objectPath), "hello");
+
+    ASSERT_TRUE(store.linkStored("source", 1, 5, (tmpDir.path() / "a").string()));
+    ASSERT_EQ(readFile(tmpDir.path() / "a"), "hello");
+}
+
+TEST(TestContentStore, mismatchingObject) {
+    const TemporaryDirectory tmpDir;
+    const auto storePath = tmpDir.path() / "store";
+    ContentStore store(storePath.string());
+
+    // other contents under the name expected for "hello", as it would happen on a md5 collision
+    const auto objectDir = storePath / "objects" / "5d";
+    std::filesystem::create_directories(objectDir);
+    std::ofstream(objectDir / "41402abc4b2a76b9719d911017c592-5-644") << "world";
+
+    storeString(store, "source", 1, "hello", 0644, tmpDir.path() / "a");
+    ASSERT_EQ(readFile(tmpDir.path() / "a"), "hello");
+    ASSERT_EQ(readFile(objectDir / "41402abc4b2a76b9719d911017c592-5-644"), "world");
+
+    // the file was not stored
+    ASSERT_FALSE(store.linkStored("source", 1, 5, (tmpDir.path() / "b").string()));
+    ASSERT_TRUE(std::filesystem::is_empty(storePath / "tmp"));
+}
+
+TEST(TestContentStore, shortData) {
+    const TemporaryDirectory tmpDir;
+    ContentStore store((tmpDir.path() / "store").string());
+
+    std::stringbuf streambuf("hel");
+    ASSERT_THROW(store.store("source", 1, 5, 0644, streambuf, (tmpDir.path() / "a").string()),
+                 appimage::core::IOError);
+    ASSERT_FALSE(store.linkStored("source", 1, 5, (tmpDir.path() / "a").string()));
+    ASSERT_TRUE(std::filesystem::is_empty(tmpDir.path() / "store" / "tmp"));
+}
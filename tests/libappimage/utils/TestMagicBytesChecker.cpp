@@ -1,3 +1,9 @@
+// system
+#include <fstream>
+#include <iterator>
+#include <fcntl.h>
+#include <unistd.h>
+
 // libraries
 #include <gtest/gtest.h>
 
@@ -31,3 +37,30 @@ TEST(MagicBytesCheckerTests, hasAppImageType2Signature) {
     ASSERT_FALSE(MagicBytesChecker(TEST_DATA_DIR "/elffile").hasAppImageType2Signature());
     ASSERT_FALSE(MagicBytesChecker(TEST_DATA_DIR "/Cura.desktop").hasAppImageType2Signature());
 }
+
+TEST(MagicBytesCheckerTests, fileDescriptor) {
+    int fd = open(TEST_DATA_DIR "/AppImageExtract_6-x86_64.AppImage", O_RDONLY);
+    ASSERT_NE(fd, -1);
+
+    MagicBytesChecker checker(fd);
+    ASSERT_TRUE(checker.hasElfSignature());
+    ASSERT_TRUE(checker.hasAppImageType1Signature());
+    ASSERT_TRUE(checker.hasIso9660Signature());
+
+    // the file offset must be kept
+    ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 0);
+    close(fd);
+
+    ASSERT_FALSE(MagicBytesChecker(-1).hasElfSignature());
+}
+
+TEST(MagicBytesCheckerTests, buffer) {
+    std::ifstream input(TEST_DATA_DIR "/appimagetool-x86_64.AppImage", std::ios::binary);
+    const std::string contents{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+
+    ASSERT_TRUE(MagicBytesChecker(contents.data(), contents.size()).hasAppImageType2Signature());
+
+    // signatures that don't fit in the buffer are not matched
+    ASSERT_FALSE(MagicBytesChecker(contents.data(), 10).hasAppImageType2Signature());
+    ASSERT_TRUE(MagicBytesChecker(contents.data(), 10).hasElfSignature());
+}
@@ -0,0 +1,50 @@
+// system
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// libraries
+#include <gtest/gtest.h>
+
+// local
+#include <appimage/core/exceptions.h>
+#include "utils/MappedFile.h"
+#include "utils/ElfFile.h"
+#include "utils/MagicBytesChecker.h"
+
+using namespace appimage::utils;
+
+TEST(TestMappedFile, contents) {
+    const std::string path = TEST_DATA_DIR "/Echo-x86_64.AppImage";
+    std::ifstream input(path, std::ios::binary);
+    const std::string expected{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+
+    MappedFile mappedFile(path);
+    ASSERT_EQ(mappedFile.size(), expected.size());
+    ASSERT_EQ(std::string(mappedFile.data(), mappedFile.size()), expected);
+
+    ASSERT_TRUE(mappedFile.contains(0, mappedFile.size()));
+    ASSERT_FALSE(mappedFile.contains(1, mappedFile.size()));
+    ASSERT_FALSE(mappedFile.contains(-1, 1));
+
+    // advices are only hints, out of range values are ignored
+    mappedFile.advise(MappedFile::Access::RANDOM);
+    mappedFile.advise(MappedFile::Access::SEQUENTIAL, 4097, 10);
+    mappedFile.advise(MappedFile::Access::NORMAL, (off_t) mappedFile.size() + 1);
+}
+
+TEST(TestMappedFile, missingFile) {
+    ASSERT_THROW(MappedFile(TEST_DATA_DIR "/missing_file"), appimage::core::IOError);
+}
+
+TEST(TestMappedFile, readersOnMapping) {
+    MappedFile mappedFile(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    ASSERT_EQ(ElfFile(mappedFile.data(), mappedFile.size()).getSize(), 187784);
+
+    MagicBytesChecker magicBytesChecker(mappedFile.data(), mappedFile.size());
+    ASSERT_TRUE(magicBytesChecker.hasElfSignature());
+    ASSERT_TRUE(magicBytesChecker.hasAppImageType2Signature());
+    ASSERT_FALSE(magicBytesChecker.hasAppImageType1Signature());
+    ASSERT_FALSE(magicBytesChecker.hasIso9660Signature());
+}
@@ -49,6 +49,24 @@ TEST(TestResourcesExtractor, extractEntriesTo) {
     ASSERT_TRUE(std::filesystem::file_size(tmpFilePath) > 0);
 }
 
+TEST(TestResourcesExtractor, extractToSkipsMissingLinkTargets) {
+    // holds a dangling link and a link with a relative target next to the Echo files
+    const appimage::core::AppImage appImage(TEST_DATA_DIR "Echo-broken-links-x86_64.AppImage");
+    const ResourcesExtractor extractor(appImage);
+
+    const TemporaryDirectory tmpDir;
+    const std::map<std::string, std::string> map = {
+        {"dangling.png", tmpDir.path() / "dangling.png"},
+        {"usr/share/icons/hicolor/32x32/apps/relative.png", tmpDir.path() / "relative.png"},
+        {".DirIcon", tmpDir.path() / "DirIcon"},
+    };
+    ASSERT_NO_THROW(extractor.extractTo(map));
+
+    ASSERT_FALSE(std::filesystem::exists(tmpDir.path() / "dangling.png"));
+    ASSERT_FALSE(std::filesystem::exists(tmpDir.path() / "relative.png"));
+    ASSERT_TRUE(std::filesystem::file_size(tmpDir.path() / "DirIcon") > 0);
+}
+
 TEST(TestResourcesExtractor, extractOne) {
     const appimage::core::AppImage appImage(TEST_DATA_DIR "Echo-x86_64.AppImage");
     const ResourcesExtractor extractor(appImage);
@@ -1,3 +1,8 @@
+// system
+#include <fstream>
+#include <string>
+#include <vector>
+
 // libraries
 #include <gtest/gtest.h>
 
@@ -12,3 +17,66 @@ TEST(TestUtilsElf, getSize) {
     ASSERT_EQ(ElfFile(TEST_DATA_DIR "/Echo-x86_64.AppImage").getSize(), 187784);
     ASSERT_EQ(ElfFile(TEST_DATA_DIR "/appimaged-i686.AppImage").getSize(), 91148);
 }
+
+TEST(TestUtilsElf, findSection) {
+    const ElfFile elf(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+
+    ElfFile::Section section;
+    ASSERT_TRUE(elf.findSection(".upd_info", section));
+    ASSERT_EQ(section.offset, 0x2ac08u);
+    ASSERT_EQ(section.size, 0x400u);
+
+    ASSERT_TRUE(elf.findSection(".sha256_sig", section));
+    ASSERT_EQ(section.offset, 0x2b008u);
+
+    ASSERT_FALSE(elf.findSection(".missing_section", section));
+}
+
+TEST(TestUtilsElf, header) {
+    const ElfFile elf64(TEST_DATA_DIR "/Echo-x86_64.AppImage");
+    ASSERT_TRUE(elf64.isValid());
+    ASSERT_EQ(elf64.getMachine(), 62); // EM_X86_64
+    ASSERT_TRUE(elf64.isLittleEndian());
+
+    const ElfFile elf32(TEST_DATA_DIR "/appimaged-i686.AppImage");
+    ASSERT_TRUE(elf32.isValid());
+    ASSERT_EQ(elf32.getMachine(), 3); // EM_386
+
+    const ElfFile missing(TEST_DATA_DIR "/missing_file");
+    ASSERT_FALSE(missing.isValid());
+    ASSERT_EQ(missing.getSize(), -1);
+}
+
+namespace {
+    ElfFile::RangeReader fileReader(std::ifstream& file) {
+        return [&file](uint64_t offset, char* buffer, size_t size) {
+            file.clear();
+            file.seekg((std::streamoff) offset);
+            file.read(buffer, (std::streamsize) size);
+            return (size_t) file.gcount();
+        };
+    }
+}
+
+TEST(TestUtilsElf, readDynamicInfo) {
+    std::ifstream elf32(TEST_DATA_DIR "/appimaged-i686.AppImage", std::ios::binary);
+
+    ElfFile::DynamicInfo info;
+    ASSERT_TRUE(ElfFile::readDynamicInfo(fileReader(elf32), info));
+    ASSERT_EQ(info.machine, 3); // EM_386
+    ASSERT_EQ(info.elfClass, ELFCLASS32);
+    ASSERT_TRUE(info.littleEndian);
+    ASSERT_TRUE(info.soname.empty());
+    ASSERT_EQ(info.needed, std::vector<std::string>({"libpthread.so.0", "libz.so.1", "libdl.so.2", "libc.so.6"}));
+    ASSERT_EQ(info.buildId, "50f32526d8f4f60cff3deb51ab3465bc1e9861d8");
+
+    std::ifstream elf64(TEST_DATA_DIR "/elffile", std::ios::binary);
+    ASSERT_TRUE(ElfFile::readDynamicInfo(fileReader(elf64), info));
+    ASSERT_EQ(info.machine, 62); // EM_X86_64
+    ASSERT_EQ(info.elfClass, ELFCLASS64);
+    ASSERT_EQ(info.needed, std::vector<std::string>({"libc.so.6"}));
+    ASSERT_EQ(info.buildId, "7e6c65a1dd8312672a4296221867bdf1641b062c");
+
+    std::ifstream notElf(TEST_DATA_DIR "/Cura.desktop", std::ios::binary);
+    ASSERT_FALSE(ElfFile::readDynamicInfo(fileReader(notElf), info));
+}